@@ -0,0 +1,69 @@
+/**
+ * @file alloc_counter.cpp
+ * @brief Replaces the global operator new and delete to count heap allocations.
+ */
+
+#include "alloc_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocation_count{0};
+static std::atomic<size_t> allocated_bytes{0};
+
+namespace AllocCounter
+{
+    /**
+     * @brief Get the number of allocations made since the program started.
+     * @return The allocation count.
+     */
+    size_t allocations()
+    {
+        return allocation_count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the number of bytes requested since the program started.
+     * @return The requested byte count.
+     */
+    size_t bytes()
+    {
+        return allocated_bytes.load(std::memory_order_relaxed);
+    }
+}
+
+void *operator new(size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
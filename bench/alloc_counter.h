@@ -0,0 +1,17 @@
+/**
+ * @file alloc_counter.h
+ * @brief Counts heap allocations made through the global operator new.
+ *
+ * Linking alloc_counter.cpp into a program replaces the global allocation functions with versions
+ * that count every call before forwarding to malloc. Benchmarks read the counter before and after
+ * a measured section to report allocations per line.
+ */
+
+#pragma once
+#include <cstddef>
+
+namespace AllocCounter
+{
+    size_t allocations();
+    size_t bytes();
+}
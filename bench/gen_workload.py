@@ -0,0 +1,132 @@
+"""Deterministic generator of large mixed Witcher Tracker workloads.
+
+Writes one command per line to stdout. The same arguments always produce the same file, so
+benchmark numbers from different builds can be compared on identical input.
+
+The mix of commands is set with relative weights, and the number of distinct ingredients,
+potions, signs and monsters with --names. Potions get formulas of --recipe-size ingredients,
+so brews compete for the same ingredients the loots and trades provide.
+
+A share of the brews (--batch-brews) are batch brews, "Geralt brews <count> <potion>".
+
+Usage: python3 bench/gen_workload.py [--lines N] [--seed S] [--names K] [--recipe-size R] [--batch-brews P]
+                                     [--loot W] [--trade W] [--brew W] [--encounter W]
+                                     [--learn W] [--query W] [--invalid W]
+"""
+
+import argparse
+import random
+import sys
+
+SYLLABLES = ["al", "ba", "cor", "dru", "el", "fen", "gar", "hex", "is", "jor",
+             "ka", "lum", "mor", "nex", "or", "pra", "quen", "ru", "sil", "tor",
+             "ul", "ve", "wyr", "xa", "yen", "zer"]
+
+
+def make_name(index, salt):
+    """Returns a distinct alphabetical name for index, different for every salt."""
+    value = index * 7 + salt
+    parts = []
+    for _ in range(3):
+        parts.append(SYLLABLES[value % len(SYLLABLES)])
+        value //= len(SYLLABLES)
+    while value > 0:
+        parts.append(SYLLABLES[value % len(SYLLABLES)])
+        value //= len(SYLLABLES)
+    return "".join(parts).capitalize()
+
+
+class Workload:
+    def __init__(self, args):
+        self.rng = random.Random(args.seed)
+        self.recipe_size = args.recipe_size
+        self.batch_brews = args.batch_brews
+        k = args.names
+        self.ingredients = [make_name(i, 0) for i in range(k)]
+        self.monsters = [make_name(i, 1) for i in range(k)]
+        self.signs = [make_name(i, 2) for i in range(max(1, k // 8))]
+        # every fourth potion has a two-word name, like "Black Blood"
+        self.potions = [make_name(i, 3) + (" " + make_name(i, 4) if i % 4 == 0 else "") for i in range(k)]
+        self.kinds = ["loot", "trade", "brew", "encounter", "learn", "query", "invalid"]
+        self.weights = [args.loot, args.trade, args.brew, args.encounter, args.learn, args.query, args.invalid]
+
+    def items(self, names, low, high):
+        chosen = self.rng.sample(names, min(len(names), self.rng.randint(low, high)))
+        return ", ".join(f"{self.rng.randint(1, 9)} {name}" for name in chosen)
+
+    def loot(self):
+        return "Geralt loots " + self.items(self.ingredients, 1, 4)
+
+    def trade(self):
+        # "trophy" follows the whole trophy list, not each trophy
+        return ("Geralt trades " + self.items(self.monsters, 1, 2) + " trophy"
+                + " for " + self.items(self.ingredients, 1, 3))
+
+    def brew(self):
+        if self.rng.random() < self.batch_brews:
+            return f"Geralt brews {self.rng.randint(2, 20)} {self.rng.choice(self.potions)}"
+        return "Geralt brews " + self.rng.choice(self.potions)
+
+    def encounter(self):
+        return "Geralt encounters a " + self.rng.choice(self.monsters)
+
+    def learn(self):
+        r = self.rng.random()
+        if r < 0.4:
+            return (f"Geralt learns {self.rng.choice(self.potions)} potion consists of "
+                    + self.items(self.ingredients, 1, self.recipe_size))
+        if r < 0.7:
+            return f"Geralt learns {self.rng.choice(self.signs)} sign is effective against {self.rng.choice(self.monsters)}"
+        return f"Geralt learns {self.rng.choice(self.potions)} potion is effective against {self.rng.choice(self.monsters)}"
+
+    def query(self):
+        r = self.rng.randrange(8)
+        if r == 0:
+            return f"Total ingredient {self.rng.choice(self.ingredients)} ?"
+        if r == 1:
+            return "Total ingredient ?"
+        if r == 2:
+            return f"Total potion {self.rng.choice(self.potions)} ?"
+        if r == 3:
+            return "Total potion ?"
+        if r == 4:
+            return f"Total trophy {self.rng.choice(self.monsters)} ?"
+        if r == 5:
+            return "Total trophy ?"
+        if r == 6:
+            return f"What is effective against {self.rng.choice(self.monsters)} ?"
+        return f"What is in {self.rng.choice(self.potions)} ?"
+
+    def invalid(self):
+        # a valid line with one token damaged, so validation has to look at most of it
+        words = getattr(self, self.rng.choice(["loot", "trade", "learn", "query"]))().split(" ")
+        i = self.rng.randrange(len(words))
+        words[i] = self.rng.choice(["0", "-1", "x1", "", "trophies", "Geralt"])
+        return " ".join(words)
+
+    def line(self):
+        kind = self.rng.choices(self.kinds, self.weights)[0]
+        return getattr(self, kind)()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a deterministic Witcher Tracker workload.")
+    parser.add_argument("--lines", type=int, default=100000, help="number of command lines")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the random generator")
+    parser.add_argument("--names", type=int, default=200, help="distinct names of each kind")
+    parser.add_argument("--recipe-size", type=int, default=4, help="maximum ingredients per formula")
+    parser.add_argument("--batch-brews", type=float, default=0.2, help="share of brews that brew several potions")
+    for kind, weight in [("loot", 20), ("trade", 10), ("brew", 15), ("encounter", 15),
+                         ("learn", 10), ("query", 25), ("invalid", 5)]:
+        parser.add_argument("--" + kind, type=float, default=weight, help=f"relative weight of {kind} lines")
+    args = parser.parse_args()
+
+    workload = Workload(args)
+    out = sys.stdout
+    for _ in range(args.lines):
+        out.write(workload.line() + "\n")
+    out.write("Exit\n")
+
+
+if __name__ == "__main__":
+    main()
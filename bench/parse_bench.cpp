@@ -0,0 +1,81 @@
+/**
+ * @file parse_bench.cpp
+ * @brief Measures time and heap allocations of the parse path.
+ *
+ * Every line of the given files goes through Utils::Parser::parse, which tokenizes, classifies,
+ * validates and builds the typed command, and then through Utils::resolve_names, which maps its
+ * names to interned ids. The first pass warms up the reusable buffers and interns every name, the
+ * second pass is measured. In steady state the path is expected to make no heap allocations, and
+ * the program fails if it does.
+ *
+ * Usage: parse_bench <input_file>...
+ */
+
+#include "alloc_counter.h"
+#include "../src/Utils.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Runs the parse path over all lines once.
+ * @param parser The parser to parse with.
+ * @param symbols The table names are resolved in.
+ * @param lines The lines to parse.
+ * @return The sum of the command types, so the work can't be optimized away.
+ */
+static long parse_all(Utils::Parser &parser, SymbolTable &symbols, const std::vector<std::string> &lines)
+{
+    long checksum = 0;
+    for (const std::string &line : lines)
+    {
+        Command &command = parser.parse(line);
+        Utils::resolve_names(command, symbols);
+        checksum += (int)command.type;
+    }
+    return checksum;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: parse_bench <input_file>...\n";
+        return 1;
+    }
+
+    std::vector<std::string> lines;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream file(argv[i]);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            lines.push_back(line);
+        }
+    }
+    if (lines.empty())
+    {
+        std::cerr << "parse_bench: no input lines\n";
+        return 1;
+    }
+
+    Utils::Parser parser;
+    SymbolTable symbols;
+    long checksum = parse_all(parser, symbols, lines); // warm-up pass, also interns every name
+
+    size_t allocations_before = AllocCounter::allocations();
+    auto start = std::chrono::steady_clock::now();
+    checksum += parse_all(parser, symbols, lines);
+    auto end = std::chrono::steady_clock::now();
+    size_t allocations = AllocCounter::allocations() - allocations_before;
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "parse_bench: " << lines.size() << " lines, "
+              << (long)(lines.size() / seconds) << " lines/s, "
+              << (double)allocations / lines.size() << " allocations/line"
+              << " (checksum " << checksum << ")\n";
+    return allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+"""Compares the run time of witchertracker builds made with different profiles.
+
+Every binary executes the same inputs: the workload file through --input, and every test case
+through the standard input in the interactive mode, as the grader runs it. The runs of the
+binaries are interleaved and repeated, and the fastest run of each counts, so background load
+affects every binary alike. The responses of every binary must be identical to those of the
+first one, which is the baseline the speedups are reported against.
+
+Usage: python3 bench/profile_bench.py [--runs N] --workload <file> <binary>...
+"""
+
+import argparse
+import glob
+import os
+import subprocess
+import sys
+import time
+
+
+def run(binary, args, stdin_path):
+    """Runs a binary once and returns its wall time in seconds and its output."""
+    with open(stdin_path, "rb") if stdin_path else open(os.devnull, "rb") as stdin:
+        start = time.perf_counter()
+        result = subprocess.run([binary] + args, stdin=stdin, stdout=subprocess.PIPE, check=True)
+        return time.perf_counter() - start, result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--runs", type=int, default=5, help="runs of every input per binary")
+    parser.add_argument("--workload", required=True, help="workload file executed with --input")
+    parser.add_argument("--test-cases", default="test-cases", help="folder with the input*.txt test cases")
+    parser.add_argument("binaries", nargs="+", help="the binaries, the first one is the baseline")
+    args = parser.parse_args()
+
+    cases = sorted(glob.glob(os.path.join(args.test_cases, "input*.txt")))
+    inputs = [("workload", ["--input", args.workload], None)]
+    inputs += [(os.path.basename(case), [], case) for case in cases]
+
+    best = {(binary, name): float("inf") for binary in args.binaries for name, _, _ in inputs}
+    expected = {}
+    for _ in range(args.runs):
+        for name, binary_args, stdin_path in inputs:
+            for binary in args.binaries:
+                seconds, output = run(os.path.join(".", binary), binary_args, stdin_path)
+                if expected.setdefault(name, output) != output:
+                    sys.exit(f"{binary} answers {name} differently from {args.binaries[0]}")
+                best[(binary, name)] = min(best[(binary, name)], seconds)
+
+    def total(binary, names):
+        return sum(best[(binary, name)] for name in names)
+
+    base = args.binaries[0]
+    case_names = [name for name, _, _ in inputs[1:]]
+    print(f"{'binary':<32}{'workload s':>12}{'speedup':>10}{'test cases s':>14}{'speedup':>10}")
+    for binary in args.binaries:
+        workload = total(binary, ["workload"])
+        tests = total(binary, case_names)
+        print(f"{binary:<32}{workload:>12.3f}{total(base, ['workload']) / workload:>9.2f}x"
+              f"{tests:>14.3f}{total(base, case_names) / tests:>9.2f}x")
+
+
+if __name__ == "__main__":
+    main()
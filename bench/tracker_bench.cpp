@@ -0,0 +1,458 @@
+/**
+ * @file tracker_bench.cpp
+ * @brief Microbenchmark harness timing every stage of the tracker separately.
+ *
+ * The lines of the given files are replayed in two ways:
+ *
+ * - Stage by stage: every line is checked by the Utils::may_be_valid prefilter, tokenized with
+ *   Utils::Parser::split_line, classified with detect_type and detect_sentence_type or
+ *   detect_question_type, parsed into a Command, resolved to ids and executed by the matching
+ *   Inventory handler or query. Each call is timed on its own, and the cost of reading the clock
+ *   is measured once and subtracted.
+ * - End to end: the lines are executed by a Session without any timing inside the loop, which
+ *   gives the throughput a replay actually gets.
+ *
+ * A warm-up replay runs first, so the reusable buffers of the parser are already grown. Each
+ * replay then starts from an empty inventory, so every command sees the same state it would see
+ * in a normal run. Responses are written to /dev/null through the usual OutputSink.
+ *
+ * Finally the state the session reached is saved to a snapshot and restored into a new session,
+ * and the size of the snapshot and the time of both steps are reported. The lines are also
+ * journaled, and replaying the journal is timed against the end-to-end replay of the text, as is
+ * executing the text through a Pipeline with one parser thread per spare hardware thread.
+ *
+ * For every stage the report shows the number of calls, nanoseconds per call, calls per second,
+ * heap allocations per call and allocations per call served by the per-line LineArena instead of
+ * the heap. The stage replay resets its arena before every line, the same way a Session does.
+ *
+ * Usage: tracker_bench <input_file>...
+ */
+
+#include "alloc_counter.h"
+#include "../src/Inventory.h"
+#include "../src/Journal.h"
+#include "../src/LineArena.h"
+#include "../src/OutputSink.h"
+#include "../src/Pipeline.h"
+#include "../src/Session.h"
+#include "../src/Utils.h"
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Accumulated measurements of one stage.
+ */
+struct Stage
+{
+    const char *name;
+    long calls = 0;
+    double nanoseconds = 0;
+    size_t allocations = 0;
+    size_t arena_allocations = 0;
+};
+
+static double clock_overhead = 0; // nanoseconds an empty measurement takes, subtracted from every call
+static LineArena arena;           // per-line arena of the stage replay
+
+/**
+ * @brief Runs a call once and adds its time, heap allocations and arena allocations to a stage.
+ *
+ * @param stage The stage the call belongs to.
+ * @param call The call to measure.
+ */
+template <typename Call>
+static void measure(Stage &stage, Call &&call)
+{
+    size_t allocations_before = AllocCounter::allocations();
+    size_t arena_before = arena.allocations();
+    auto start = Clock::now();
+    call();
+    auto end = Clock::now();
+    stage.allocations += AllocCounter::allocations() - allocations_before;
+    stage.arena_allocations += arena.allocations() - arena_before;
+    stage.nanoseconds += std::chrono::duration<double, std::nano>(end - start).count() - clock_overhead;
+    stage.calls++;
+}
+
+/**
+ * @brief Measures how long timing an empty call takes.
+ * @return The overhead of measure, in nanoseconds per call.
+ */
+static double calibrate()
+{
+    Stage empty{"empty"};
+    for (int i = 0; i < 1000000; ++i)
+    {
+        measure(empty, [] {});
+    }
+    return empty.nanoseconds / empty.calls;
+}
+
+/**
+ * @brief The stages of the stage-by-stage replay, indexed by the constants below.
+ */
+enum StageIndex
+{
+    Prefilter,
+    SplitLine,
+    DetectType,
+    DetectSentenceType,
+    DetectQuestionType,
+    Parse,
+    ResolveNames,
+    HandleLoot,
+    HandleTrade,
+    HandleBrew,
+    HandleBrewBatch,
+    HandleSignKnowledge,
+    HandlePotionKnowledge,
+    HandlePotionRecipe,
+    HandleEncounter,
+    GetIngredientCount,
+    PrintIngredients,
+    GetPotionCount,
+    PrintPotions,
+    GetTrophyCount,
+    PrintTrophies,
+    PrintMonsterKnowledge,
+    PrintPotionFormula,
+    InvalidLine,
+    StageCount
+};
+
+static Stage stages[StageCount] = {
+    {"may_be_valid"}, {"split_line"}, {"detect_type"}, {"detect_sentence_type"}, {"detect_question_type"}, {"parse"},
+    {"resolve_names"}, {"handle_loot"}, {"handle_trade"}, {"handle_brew"}, {"handle_brew_batch"}, {"handle_sign_knowledge"},
+    {"handle_potion_knowledge"}, {"handle_potion_recipe"}, {"handle_encounter"}, {"get_ingredient_count"},
+    {"print_ingredients"}, {"get_potion_count"}, {"print_potions"}, {"get_trophy_count"},
+    {"print_trophies"}, {"print_monster_knowledge"}, {"print_potion_formula"}, {"invalid line"}};
+
+/**
+ * @brief Executes a parsed command on an inventory, timing the call under the stage of its type.
+ *
+ * @param command The parsed command, with its names resolved.
+ * @param inventory The inventory to execute the command on.
+ * @param out The sink the inventory writes to, also used for the counts printed here.
+ */
+static void execute_timed(const Command &command, Inventory &inventory, OutputSink &out)
+{
+    switch (command.type)
+    {
+    case CommandType::Loot:
+        measure(stages[HandleLoot], [&] { inventory.handle_loot(command.loot); });
+        break;
+    case CommandType::Trade:
+        measure(stages[HandleTrade], [&] { inventory.handle_trade(command.trade); });
+        break;
+    case CommandType::Brew:
+        measure(stages[HandleBrew], [&] { inventory.handle_brew(command.brew); });
+        break;
+    case CommandType::BrewBatch:
+        measure(stages[HandleBrewBatch], [&] { inventory.handle_brew_batch(command.brew); });
+        break;
+    case CommandType::SignKnowledge:
+        measure(stages[HandleSignKnowledge], [&] { inventory.handle_sign_knowledge(command.sign_knowledge); });
+        break;
+    case CommandType::PotionKnowledge:
+        measure(stages[HandlePotionKnowledge], [&] { inventory.handle_potion_knowledge(command.potion_knowledge); });
+        break;
+    case CommandType::PotionRecipe:
+        measure(stages[HandlePotionRecipe], [&] { inventory.handle_potion_recipe(command.potion_recipe); });
+        break;
+    case CommandType::Encounter:
+        measure(stages[HandleEncounter], [&] { inventory.handle_encounter(command.encounter); });
+        break;
+    case CommandType::IngredientCount:
+        measure(stages[GetIngredientCount], [&] { out << inventory.get_ingredient_count(command.query.id) << "\n"; });
+        break;
+    case CommandType::TotalIngredients:
+        measure(stages[PrintIngredients], [&] { inventory.print_ingredients(); });
+        break;
+    case CommandType::PotionCount:
+        measure(stages[GetPotionCount], [&] { out << inventory.get_potion_count(command.query.id) << "\n"; });
+        break;
+    case CommandType::TotalPotions:
+        measure(stages[PrintPotions], [&] { inventory.print_potions(); });
+        break;
+    case CommandType::TrophyCount:
+        measure(stages[GetTrophyCount], [&] { out << inventory.get_trophy_count(command.query.id) << "\n"; });
+        break;
+    case CommandType::TotalTrophies:
+        measure(stages[PrintTrophies], [&] { inventory.print_trophies(); });
+        break;
+    case CommandType::MonsterKnowledge:
+        measure(stages[PrintMonsterKnowledge], [&] { inventory.print_monster_knowledge(command.query); });
+        break;
+    case CommandType::PotionFormula:
+        measure(stages[PrintPotionFormula], [&] { inventory.print_potion_formula(command.query); });
+        break;
+    default:
+        measure(stages[InvalidLine], [&] { out << "INVALID\n"; });
+        break;
+    }
+}
+
+/**
+ * @brief Replays the lines stage by stage on a fresh inventory.
+ *
+ * @param lines The lines to replay, up to the first exit.
+ * @param parser The parser to parse with.
+ * @param symbols The table names are resolved in.
+ * @param out The sink responses are written to.
+ */
+static void replay_stages(const std::vector<std::string> &lines, Utils::Parser &parser, SymbolTable &symbols, OutputSink &out)
+{
+    Inventory inventory(symbols, out, &arena);
+    for (const std::string &line : lines)
+    {
+        arena.reset();
+        measure(stages[Prefilter], [&] { Utils::may_be_valid(line); });
+        measure(stages[SplitLine], [&] { parser.split_line(line); });
+        int type = 0;
+        measure(stages[DetectType], [&] { type = parser.detect_type(); });
+        if (type == 0)
+        {
+            measure(stages[DetectSentenceType], [&] { parser.detect_sentence_type(); });
+        }
+        else if (type == 1)
+        {
+            measure(stages[DetectQuestionType], [&] { parser.detect_question_type(); });
+        }
+
+        Command *command = nullptr;
+        measure(stages[Parse], [&] { command = &parser.parse(line); });
+        measure(stages[ResolveNames], [&] { Utils::resolve_names(*command, symbols); });
+        if (command->type == CommandType::Exit)
+        {
+            break;
+        }
+        execute_timed(*command, inventory, out);
+    }
+    out.flush();
+}
+
+/**
+ * @brief Replays the lines through a Session without timing individual calls.
+ *
+ * @param lines The lines to replay, up to the first exit.
+ * @param out The sink responses are written to.
+ * @return The number of lines executed.
+ */
+static long replay_session(const std::vector<std::string> &lines, OutputSink &out)
+{
+    Session session(out);
+    long executed = 0;
+    for (const std::string &line : lines)
+    {
+        executed++;
+        if (!session.execute_line(line))
+        {
+            break;
+        }
+    }
+    out.flush();
+    return executed;
+}
+
+/**
+ * @brief Replays the lines through a Session, then times saving and restoring its snapshot.
+ *
+ * @param lines The lines to replay, up to the first exit.
+ * @param out The sink responses are written to.
+ */
+static void measure_snapshot(const std::vector<std::string> &lines, OutputSink &out)
+{
+    Session session(out);
+    for (const std::string &line : lines)
+    {
+        if (!session.execute_line(line))
+        {
+            break;
+        }
+    }
+    out.flush();
+
+    std::string snapshot;
+    auto start = Clock::now();
+    session.save_snapshot(snapshot);
+    auto saved = Clock::now();
+    Session restored(out);
+    bool ok = restored.restore_snapshot(snapshot);
+    auto end = Clock::now();
+
+    std::printf("snapshot: %zu bytes, save %.3f ms, restore %.3f ms%s\n", snapshot.size(),
+                std::chrono::duration<double, std::milli>(saved - start).count(),
+                std::chrono::duration<double, std::milli>(end - saved).count(), ok ? "" : " (restore failed)");
+}
+
+/**
+ * @brief Journals a replay of the lines, then times replaying the journal into a new session.
+ *
+ * @param lines The lines to replay, up to the first exit.
+ * @param out The sink responses are written to.
+ * @param text_nanoseconds The time the end-to-end replay of the text took.
+ */
+static void measure_journal(const std::vector<std::string> &lines, OutputSink &out, double text_nanoseconds)
+{
+    std::string journaled;
+    uint64_t records = 0;
+    {
+        Session session(out);
+        Journal journal;
+        journal.open_in_memory(journaled);
+        session.set_journal(&journal);
+        for (const std::string &line : lines)
+        {
+            if (!session.execute_line(line))
+            {
+                break;
+            }
+        }
+        journal.commit();
+        records = journal.records();
+    }
+    out.flush();
+
+    Session replayed(out);
+    auto start = Clock::now();
+    bool ok = replayed.replay_journal(journaled);
+    out.flush();
+    auto end = Clock::now();
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+
+    std::printf("journal: %lu records, %zu bytes, replay %.3f ms (%.1fx faster than the text)%s\n",
+                (unsigned long)records, journaled.size(), nanoseconds * 1e-6, text_nanoseconds / nanoseconds,
+                ok ? "" : " (replay failed)");
+}
+
+/**
+ * @brief Times executing the lines through a pipeline.
+ *
+ * @param lines The lines to execute, up to the first exit.
+ * @param out The sink responses are written to.
+ * @param text_nanoseconds The time the end-to-end replay of the text took.
+ */
+static void measure_pipeline(const std::vector<std::string> &lines, OutputSink &out, double text_nanoseconds)
+{
+    std::string input;
+    for (const std::string &line : lines)
+    {
+        input += line;
+        input += '\n';
+    }
+    int hardware = (int)std::thread::hardware_concurrency();
+    int parsers = hardware > 3 ? hardware - 2 : 1;
+
+    std::string staged;
+    OutputSink staging(staged);
+    Session session(staging);
+    Pipeline pipeline(session, staging, staged, out, parsers);
+    auto start = Clock::now();
+    pipeline.run(input);
+    auto end = Clock::now();
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+
+    std::printf("pipeline: %d parser threads, %.0f lines/s (%.2fx the single-threaded replay)\n", parsers,
+                lines.size() / (nanoseconds * 1e-9), text_nanoseconds / nanoseconds);
+}
+
+/**
+ * @brief Prints one row of the report.
+ *
+ * @param name The name of the stage.
+ * @param calls The number of calls.
+ * @param nanoseconds The total time of the calls.
+ * @param allocations The total heap allocations of the calls.
+ * @param arena_allocations The total allocations the calls took from a LineArena, or -1 if the
+ *                          arena is not visible to the benchmark.
+ */
+static void print_row(const char *name, long calls, double nanoseconds, size_t allocations, long arena_allocations)
+{
+    double per_call = calls > 0 ? nanoseconds / calls : 0;
+    double per_second = nanoseconds > 0 ? calls / (nanoseconds * 1e-9) : 0;
+    std::printf("%-26s %10ld %12.1f %14.0f %12.3f", name, calls, per_call, per_second,
+                calls > 0 ? (double)allocations / calls : 0.0);
+    if (arena_allocations < 0)
+    {
+        std::printf(" %12s\n", "-");
+    }
+    else
+    {
+        std::printf(" %12.3f\n", calls > 0 ? (double)arena_allocations / calls : 0.0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: tracker_bench <input_file>...\n";
+        return 1;
+    }
+
+    std::vector<std::string> lines;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream file(argv[i]);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            lines.push_back(line);
+        }
+    }
+    if (lines.empty())
+    {
+        std::cerr << "tracker_bench: no input lines\n";
+        return 1;
+    }
+
+    int null_fd = ::open("/dev/null", O_WRONLY);
+    OutputSink out(null_fd);
+    clock_overhead = calibrate();
+
+    Utils::Parser parser;
+    SymbolTable symbols;
+    replay_stages(lines, parser, symbols, out); // warm-up pass, also interns every name
+    for (Stage &stage : stages)
+    {
+        stage = Stage{stage.name};
+    }
+    replay_stages(lines, parser, symbols, out);
+
+    replay_session(lines, out); // warm-up pass
+    size_t allocations_before = AllocCounter::allocations();
+    auto start = Clock::now();
+    long executed = replay_session(lines, out);
+    auto end = Clock::now();
+    size_t session_allocations = AllocCounter::allocations() - allocations_before;
+    double session_nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+
+    std::printf("tracker_bench: %zu lines, clock overhead %.1f ns subtracted per call\n", lines.size(), clock_overhead);
+    std::printf("%-26s %10s %12s %14s %12s %12s\n", "stage", "calls", "ns/call", "calls/s", "allocs/call",
+                "arena/call");
+    for (const Stage &stage : stages)
+    {
+        if (stage.calls > 0)
+        {
+            print_row(stage.name, stage.calls, stage.nanoseconds, stage.allocations, (long)stage.arena_allocations);
+        }
+    }
+    print_row("Session::execute_line", executed, session_nanoseconds, session_allocations, -1);
+    std::printf("end to end: %.0f lines/s, %.3f allocations/line\n",
+                executed / (session_nanoseconds * 1e-9), (double)session_allocations / executed);
+    measure_snapshot(lines, out);
+    measure_journal(lines, out, session_nanoseconds);
+    measure_pipeline(lines, out, session_nanoseconds);
+
+    ::close(null_fd);
+    return 0;
+}
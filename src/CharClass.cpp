@@ -0,0 +1,429 @@
+/**
+ * @file CharClass.cpp
+ * @brief Implements the character class kernels and picks the ones the CPU supports.
+ *
+ * Every vector kernel classifies full vectors from the start of the range and then one last
+ * vector that ends exactly at its end, overlapping the previous one, so no byte outside the range
+ * is loaded. The class tests are unsigned range checks, done on signed lanes by flipping the sign
+ * bit: `x - low < count` as unsigned is `(x - low) ^ 0x80 < count - 128` as signed. Two spaces in
+ * a row are found by comparing a vector with the same vector loaded one byte later.
+ */
+
+#include "CharClass.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define CHARCLASS_AVX2 1
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace CharClass
+{
+    /**
+     * @brief Builds the class bits of every byte.
+     */
+    static constexpr std::array<uint8_t, 256> build_table()
+    {
+        std::array<uint8_t, 256> bits{};
+        for (int c = 0; c < 256; ++c)
+        {
+            bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            bool digit = c >= '0' && c <= '9';
+            bool space = c == ' ' || (c >= '\t' && c <= '\r');
+            bits[c] = (alpha ? Alpha : 0) | (digit ? Digit : 0) | (space ? Space : 0);
+        }
+        return bits;
+    }
+
+    constexpr std::array<uint8_t, 256> table = build_table();
+
+    // scalar kernels, the fallback on every CPU
+
+    static bool scalar_all_alpha(const char *first, size_t length)
+    {
+        return all_in_class(first, length, Alpha);
+    }
+
+    static bool scalar_all_digit(const char *first, size_t length)
+    {
+        return all_in_class(first, length, Digit);
+    }
+
+    static bool scalar_is_name_span(const char *first, size_t length)
+    {
+        return name_span_in_table(first, length);
+    }
+
+    static const Kernels scalar_kernels = {"scalar", 1, scalar_all_alpha, scalar_all_digit, scalar_is_name_span};
+
+#if defined(__SSE2__)
+    // SSE2 kernels, 16 bytes at a time, part of the x86-64 baseline
+
+    /**
+     * @brief Marks the lanes holding a letter.
+     */
+    static inline __m128i sse2_alpha(__m128i v)
+    {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i shifted = _mm_add_epi8(lower, _mm_set1_epi8((char)(0x80 - 'a')));
+        return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    }
+
+    /**
+     * @brief Marks the lanes holding a digit.
+     */
+    static inline __m128i sse2_digit(__m128i v)
+    {
+        __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - '0')));
+        return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 10)));
+    }
+
+    /**
+     * @brief Marks the lanes holding whitespace.
+     */
+    static inline __m128i sse2_space(__m128i v)
+    {
+        __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - '\t')));
+        __m128i control = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 5)));
+        return _mm_or_si128(control, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    }
+
+    static inline __m128i sse2_load(const char *p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+
+    static bool sse2_all_alpha(const char *first, size_t length)
+    {
+        if (length < 16)
+        {
+            return all_in_class(first, length, Alpha);
+        }
+        for (size_t i = 0;; i += 16)
+        {
+            i = i + 16 > length ? length - 16 : i;
+            if (_mm_movemask_epi8(sse2_alpha(sse2_load(first + i))) != 0xFFFF)
+            {
+                return false;
+            }
+            if (i + 16 == length)
+            {
+                return true;
+            }
+        }
+    }
+
+    static bool sse2_all_digit(const char *first, size_t length)
+    {
+        if (length < 16)
+        {
+            return all_in_class(first, length, Digit);
+        }
+        for (size_t i = 0;; i += 16)
+        {
+            i = i + 16 > length ? length - 16 : i;
+            if (_mm_movemask_epi8(sse2_digit(sse2_load(first + i))) != 0xFFFF)
+            {
+                return false;
+            }
+            if (i + 16 == length)
+            {
+                return true;
+            }
+        }
+    }
+
+    static bool sse2_is_name_span(const char *first, size_t length)
+    {
+        // the pairs are checked on the bytes before the last one, each with the byte after it
+        if (length < 17)
+        {
+            return name_span_in_table(first, length);
+        }
+        const __m128i spaces = _mm_set1_epi8(' ');
+        for (size_t i = 0;; i += 16)
+        {
+            i = i + 17 > length ? length - 17 : i;
+            __m128i v = sse2_load(first + i);
+            __m128i next = sse2_load(first + i + 1);
+            __m128i allowed = _mm_or_si128(sse2_alpha(next), sse2_space(next));
+            __m128i doubled = _mm_and_si128(_mm_cmpeq_epi8(v, spaces), _mm_cmpeq_epi8(next, spaces));
+            if (_mm_movemask_epi8(_mm_andnot_si128(doubled, allowed)) != 0xFFFF)
+            {
+                return false;
+            }
+            if (i + 17 == length)
+            {
+                return (table[(unsigned char)first[0]] & (Alpha | Space)) != 0;
+            }
+        }
+    }
+
+    static const Kernels sse2_kernels = {"sse2", 16, sse2_all_alpha, sse2_all_digit, sse2_is_name_span};
+#endif
+
+#if defined(CHARCLASS_AVX2)
+    // AVX2 kernels, 32 bytes at a time, compiled for AVX2 whatever the build flags and only called if cpuid has it
+
+#define AVX2 __attribute__((target("avx2")))
+
+    AVX2 static inline __m256i avx2_alpha(__m256i v)
+    {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i shifted = _mm256_add_epi8(lower, _mm256_set1_epi8((char)(0x80 - 'a')));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+    }
+
+    AVX2 static inline __m256i avx2_digit(__m256i v)
+    {
+        __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - '0')));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 10)), shifted);
+    }
+
+    AVX2 static inline __m256i avx2_space(__m256i v)
+    {
+        __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - '\t')));
+        __m256i control = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 5)), shifted);
+        return _mm256_or_si256(control, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    }
+
+    AVX2 static inline __m256i avx2_load(const char *p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    AVX2 static bool avx2_all_alpha(const char *first, size_t length)
+    {
+        if (length < 32)
+        {
+            return sse2_all_alpha(first, length);
+        }
+        for (size_t i = 0;; i += 32)
+        {
+            i = i + 32 > length ? length - 32 : i;
+            if ((uint32_t)_mm256_movemask_epi8(avx2_alpha(avx2_load(first + i))) != 0xFFFFFFFFu)
+            {
+                return false;
+            }
+            if (i + 32 == length)
+            {
+                return true;
+            }
+        }
+    }
+
+    AVX2 static bool avx2_all_digit(const char *first, size_t length)
+    {
+        if (length < 32)
+        {
+            return sse2_all_digit(first, length);
+        }
+        for (size_t i = 0;; i += 32)
+        {
+            i = i + 32 > length ? length - 32 : i;
+            if ((uint32_t)_mm256_movemask_epi8(avx2_digit(avx2_load(first + i))) != 0xFFFFFFFFu)
+            {
+                return false;
+            }
+            if (i + 32 == length)
+            {
+                return true;
+            }
+        }
+    }
+
+    AVX2 static bool avx2_is_name_span(const char *first, size_t length)
+    {
+        if (length < 33)
+        {
+            return sse2_is_name_span(first, length);
+        }
+        const __m256i spaces = _mm256_set1_epi8(' ');
+        for (size_t i = 0;; i += 32)
+        {
+            i = i + 33 > length ? length - 33 : i;
+            __m256i v = avx2_load(first + i);
+            __m256i next = avx2_load(first + i + 1);
+            __m256i allowed = _mm256_or_si256(avx2_alpha(next), avx2_space(next));
+            __m256i doubled = _mm256_and_si256(_mm256_cmpeq_epi8(v, spaces), _mm256_cmpeq_epi8(next, spaces));
+            if ((uint32_t)_mm256_movemask_epi8(_mm256_andnot_si256(doubled, allowed)) != 0xFFFFFFFFu)
+            {
+                return false;
+            }
+            if (i + 33 == length)
+            {
+                return (table[(unsigned char)first[0]] & (Alpha | Space)) != 0;
+            }
+        }
+    }
+
+#undef AVX2
+
+    static const Kernels avx2_kernels = {"avx2", 32, avx2_all_alpha, avx2_all_digit, avx2_is_name_span};
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    // NEON kernels, 16 bytes at a time, part of the AArch64 baseline
+
+    static inline uint8x16_t neon_alpha(uint8x16_t v)
+    {
+        uint8x16_t lower = vorrq_u8(v, vdupq_n_u8(0x20));
+        return vcltq_u8(vsubq_u8(lower, vdupq_n_u8('a')), vdupq_n_u8(26));
+    }
+
+    static inline uint8x16_t neon_digit(uint8x16_t v)
+    {
+        return vcltq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(10));
+    }
+
+    static inline uint8x16_t neon_space(uint8x16_t v)
+    {
+        uint8x16_t control = vcltq_u8(vsubq_u8(v, vdupq_n_u8('\t')), vdupq_n_u8(5));
+        return vorrq_u8(control, vceqq_u8(v, vdupq_n_u8(' ')));
+    }
+
+    static inline uint8x16_t neon_load(const char *p)
+    {
+        return vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+    }
+
+    static bool neon_all_alpha(const char *first, size_t length)
+    {
+        if (length < 16)
+        {
+            return all_in_class(first, length, Alpha);
+        }
+        for (size_t i = 0;; i += 16)
+        {
+            i = i + 16 > length ? length - 16 : i;
+            if (vminvq_u8(neon_alpha(neon_load(first + i))) == 0)
+            {
+                return false;
+            }
+            if (i + 16 == length)
+            {
+                return true;
+            }
+        }
+    }
+
+    static bool neon_all_digit(const char *first, size_t length)
+    {
+        if (length < 16)
+        {
+            return all_in_class(first, length, Digit);
+        }
+        for (size_t i = 0;; i += 16)
+        {
+            i = i + 16 > length ? length - 16 : i;
+            if (vminvq_u8(neon_digit(neon_load(first + i))) == 0)
+            {
+                return false;
+            }
+            if (i + 16 == length)
+            {
+                return true;
+            }
+        }
+    }
+
+    static bool neon_is_name_span(const char *first, size_t length)
+    {
+        if (length < 17)
+        {
+            return name_span_in_table(first, length);
+        }
+        const uint8x16_t spaces = vdupq_n_u8(' ');
+        for (size_t i = 0;; i += 16)
+        {
+            i = i + 17 > length ? length - 17 : i;
+            uint8x16_t v = neon_load(first + i);
+            uint8x16_t next = neon_load(first + i + 1);
+            uint8x16_t allowed = vorrq_u8(neon_alpha(next), neon_space(next));
+            uint8x16_t doubled = vandq_u8(vceqq_u8(v, spaces), vceqq_u8(next, spaces));
+            if (vminvq_u8(vbicq_u8(allowed, doubled)) == 0)
+            {
+                return false;
+            }
+            if (i + 17 == length)
+            {
+                return (table[(unsigned char)first[0]] & (Alpha | Space)) != 0;
+            }
+        }
+    }
+
+    static const Kernels neon_kernels = {"neon", 16, neon_all_alpha, neon_all_digit, neon_is_name_span};
+#endif
+
+    // every kernel set compiled in, best first, with whether this CPU can run it
+    static const Kernels *const compiled[] = {
+#if defined(CHARCLASS_AVX2)
+        &avx2_kernels,
+#endif
+#if defined(__SSE2__)
+        &sse2_kernels,
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+        &neon_kernels,
+#endif
+        &scalar_kernels};
+
+    /**
+     * @brief Checks if the CPU can run a kernel set.
+     *
+     * @param kernels The kernel set, one of `compiled`.
+     * @return true if its instructions are available.
+     */
+    static bool cpu_supports(const Kernels *kernels)
+    {
+#if defined(CHARCLASS_AVX2)
+        if (kernels == &avx2_kernels)
+        {
+            __builtin_cpu_init(); // may run before the constructors that would otherwise call it
+            return __builtin_cpu_supports("avx2");
+        }
+#endif
+        (void)kernels;
+        return true;
+    }
+
+    /**
+     * @brief Gets the kernel sets this CPU can run, best first, the scalar ones last.
+     *
+     * @param count Set to the number of kernel sets.
+     * @return The kernel sets.
+     */
+    const Kernels *const *supported(size_t &count)
+    {
+        static const Kernels *runnable[sizeof(compiled) / sizeof(compiled[0])];
+        static const size_t runnable_count = []
+        {
+            size_t n = 0;
+            for (const Kernels *kernels : compiled)
+            {
+                if (cpu_supports(kernels))
+                {
+                    runnable[n++] = kernels;
+                }
+            }
+            return n;
+        }();
+        count = runnable_count;
+        return runnable;
+    }
+
+    /**
+     * @brief Picks the best kernel set the CPU supports.
+     */
+    static const Kernels *pick()
+    {
+        size_t count = 0;
+        return supported(count)[0];
+    }
+
+    const Kernels *const active = pick();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file CharClass.h
+ * @brief Character class checks over whole tokens and spans, vectorized with runtime dispatch.
+ *
+ * The validators ask three questions about the bytes of a line: is a token only letters, is it
+ * only digits, and is a span of the line a potion name, that is letters and whitespace without
+ * two spaces in a row. Each has a kernel per instruction set, which answers it 16 (SSE2, NEON)
+ * or 32 (AVX2) bytes at a time, and a scalar fallback that looks every byte up in a table. Letters,
+ * digits and whitespace are those of the default "C" locale, so, unlike isalpha and isdigit, the
+ * answer never depends on the locale of the process.
+ *
+ * The best kernel set the CPU supports is picked once at startup: AVX2 if cpuid reports it, SSE2
+ * on any other x86-64, NEON on AArch64, and the scalar kernels elsewhere. Most tokens are shorter
+ * than a vector, and for them the inline wrappers below use the table directly instead of paying
+ * for an indirect call. The kernels never read outside the range they are given, so they work on
+ * views into lines of any length without padding.
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace CharClass
+{
+    // class bits of a byte in `table`
+    enum : uint8_t
+    {
+        Alpha = 1, // 'a' to 'z' and 'A' to 'Z'
+        Digit = 2, // '0' to '9'
+        Space = 4  // ' ', '\t', '\n', '\v', '\f' and '\r'
+    };
+
+    extern const std::array<uint8_t, 256> table; // class bits of every byte
+
+    /**
+     * @brief One implementation of the checks, for one instruction set.
+     */
+    struct Kernels
+    {
+        const char *name;                              // "scalar", "sse2", "avx2" or "neon"
+        size_t width;                                  // bytes per vector, ranges shorter than it go through the table
+        bool (*all_alpha)(const char *, size_t);       // every byte is a letter
+        bool (*all_digit)(const char *, size_t);       // every byte is a digit
+        bool (*is_name_span)(const char *, size_t);    // letters and whitespace, no two spaces in a row
+    };
+
+    extern const Kernels *const active; // the kernels picked for this CPU
+
+    const Kernels *const *supported(size_t &count);
+
+    /**
+     * @brief Checks every byte of a short range against a class with the table.
+     *
+     * @param first The start of the range.
+     * @param length The number of bytes.
+     * @param bits The class bits a byte must have one of.
+     * @return true if every byte has one of the bits, also for an empty range.
+     */
+    inline bool all_in_class(const char *first, size_t length, uint8_t bits)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            if ((table[(unsigned char)first[i]] & bits) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Checks if a short range is a potion name span with the table.
+     *
+     * @param first The start of the range.
+     * @param length The number of bytes.
+     * @return true if every byte is a letter or whitespace and no space follows a space.
+     */
+    inline bool name_span_in_table(const char *first, size_t length)
+    {
+        bool after_space = false;
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint8_t bits = table[(unsigned char)first[i]];
+            bool space = first[i] == ' ';
+            if ((bits & (Alpha | Space)) == 0 || (space && after_space))
+            {
+                return false;
+            }
+            after_space = space;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Checks if a range holds only letters.
+     */
+    inline bool all_alpha(const char *first, size_t length)
+    {
+        return length < 16 ? all_in_class(first, length, Alpha) : active->all_alpha(first, length);
+    }
+
+    /**
+     * @brief Checks if a range holds only digits.
+     */
+    inline bool all_digit(const char *first, size_t length)
+    {
+        return length < 16 ? all_in_class(first, length, Digit) : active->all_digit(first, length);
+    }
+
+    /**
+     * @brief Checks if a range holds only letters and whitespace, without two spaces in a row.
+     */
+    inline bool is_name_span(const char *first, size_t length)
+    {
+        return length < 16 ? name_span_in_table(first, length) : active->is_name_span(first, length);
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file Command.h
+ * @brief Typed form of a parsed input line.
+ *
+ * Utils::Parser validates a line once and stores everything the Inventory needs to execute it
+ * in a Command: the kind of command, the integer counts and the names, with multi-word potion
+ * names as one view. The Inventory consumes these structs directly and never looks at the
+ * tokens of the line again.
+ *
+ * Names are views into the parsed line, a multi-word potion name the span of its words, or, for
+ * a potion name whose words the line separates by other whitespace than one space, into the
+ * parser's name buffer. A Command is therefore only valid until the parser parses the next
+ * line. The vectors keep their capacity between lines.
+ *
+ * Next to every name there is the id it has in the session's SymbolTable. The parser only fills
+ * the names; Utils::resolve_names then looks up the ids, once per line, before the command is
+ * executed. Names the command can introduce (looted ingredients, learned potions, ...) are
+ * interned, while names that are only looked up resolve to SymbolTable::none if unknown.
+ */
+
+#pragma once
+#include <string_view>
+#include <vector>
+#include "SymbolTable.h"
+
+/**
+ * @brief The kind of a parsed line.
+ */
+enum class CommandType
+{
+    Invalid,
+    Exit,
+    Loot,
+    Trade,
+    Brew,
+    BrewBatch,
+    SignKnowledge,
+    PotionKnowledge,
+    PotionRecipe,
+    Encounter,
+    IngredientCount,
+    TotalIngredients,
+    PotionCount,
+    TotalPotions,
+    TrophyCount,
+    TotalTrophies,
+    MonsterKnowledge,
+    PotionFormula
+};
+
+/**
+ * @brief A name with a count, e.g. "5 Rebis" in a loot list or "2 Harpy trophy" in a trade.
+ */
+struct Item
+{
+    std::string_view name;
+    int count;
+    Id id = SymbolTable::none;
+};
+
+// "Geralt loots <count> <ingredient>, ..."
+struct LootCmd
+{
+    std::vector<Item> ingredients;
+};
+
+// "Geralt trades <count> <trophy> trophy, ... for <count> <ingredient>, ..."
+struct TradeCmd
+{
+    std::vector<Item> trophies;
+    std::vector<Item> ingredients;
+};
+
+// "Geralt brews <potion>" or, for a BrewBatch, "Geralt brews <count> <potion>"
+struct BrewCmd
+{
+    std::string_view potion;
+    int count = 1; // how many to brew, always 1 for a single Brew
+    Id potion_id = SymbolTable::none;
+};
+
+// "Geralt learns <sign> sign is effective against <monster>"
+struct SignKnowledgeCmd
+{
+    std::string_view sign;
+    std::string_view monster;
+    Id sign_id = SymbolTable::none;
+    Id monster_id = SymbolTable::none;
+};
+
+// "Geralt learns <potion> potion is effective against <monster>"
+struct PotionKnowledgeCmd
+{
+    std::string_view potion;
+    std::string_view monster;
+    Id potion_id = SymbolTable::none;
+    Id monster_id = SymbolTable::none;
+};
+
+// "Geralt learns <potion> potion consists of <count> <ingredient>, ..."
+struct PotionRecipeCmd
+{
+    std::string_view potion;
+    std::vector<Item> ingredients;
+    Id potion_id = SymbolTable::none;
+};
+
+// "Geralt encounters a <monster>"
+struct EncounterCmd
+{
+    std::string_view monster;
+    Id monster_id = SymbolTable::none;
+};
+
+// questions about a single ingredient, potion, trophy or monster, e.g. "What is in <potion> ?"
+struct QueryCmd
+{
+    std::string_view name;
+    Id id = SymbolTable::none;
+};
+
+/**
+ * @brief A parsed line. Only the member matching `type` is meaningful.
+ *
+ * Every kind keeps its own member instead of sharing storage, so the vectors inside them
+ * keep their capacity from line to line and parsing does not allocate in steady state.
+ */
+struct Command
+{
+    CommandType type = CommandType::Invalid;
+    LootCmd loot;
+    TradeCmd trade;
+    BrewCmd brew;
+    SignKnowledgeCmd sign_knowledge;
+    PotionKnowledgeCmd potion_knowledge;
+    PotionRecipeCmd potion_recipe;
+    EncounterCmd encounter;
+    QueryCmd query;
+};
@@ -0,0 +1,315 @@
+/**
+ * @file CountStore.cpp
+ * @brief Implements the dense and hash count storage engines and their sorted index.
+ */
+
+#include "CountStore.h"
+#include <algorithm>
+
+/**
+ * @brief Marks the index as out of date, after an id was added or removed.
+ */
+void SortedIndex::invalidate()
+{
+    valid = false;
+}
+
+/**
+ * @brief Checks if the index still matches the set of present ids.
+ * @return true if no id was added or removed since the last rebuild.
+ */
+bool SortedIndex::is_valid() const
+{
+    return valid;
+}
+
+/**
+ * @brief Replaces the index with the given ids, sorted by name.
+ *
+ * @param present The ids currently present in the store, in any order.
+ * @param symbols The table the ids were interned in.
+ * @return The sorted ids.
+ */
+const std::vector<Id> &SortedIndex::rebuild(const std::vector<Id> &present, const SymbolTable &symbols)
+{
+    ids.assign(present.begin(), present.end());
+    std::sort(ids.begin(), ids.end(), [&symbols](Id a, Id b)
+              { return symbols.name(a) < symbols.name(b); });
+    valid = true;
+    return ids;
+}
+
+/**
+ * @brief Gets the sorted ids as of the last rebuild.
+ * @return The sorted ids.
+ */
+const std::vector<Id> &SortedIndex::get() const
+{
+    return ids;
+}
+
+/**
+ * @brief Gets the count of an id.
+ *
+ * @param id The id to look up, may be SymbolTable::none.
+ * @return The count, or 0 if the id is not present.
+ */
+int DenseCountStore::get(Id id) const
+{
+    return id < counts.size() ? counts[id] : 0;
+}
+
+/**
+ * @brief Adds to the count of an id, inserting or removing it as needed.
+ *
+ * A missing id is inserted if delta is positive and left missing otherwise. A present id whose
+ * count drops to zero or below is removed.
+ *
+ * @param id The id to update.
+ * @param delta The amount to add, negative to decrease the count.
+ *
+ * @note This method modifies the counts in place.
+ */
+void DenseCountStore::add(Id id, int delta)
+{
+    if (id == SymbolTable::none)
+    {
+        return;
+    }
+    if (id >= counts.size())
+    {
+        if (delta <= 0)
+        {
+            return;
+        }
+        counts.resize(id + 1, 0);
+        position.resize(id + 1, 0);
+    }
+
+    int &count = counts[id];
+    if (count == 0) // missing
+    {
+        if (delta > 0)
+        {
+            count = delta;
+            position[id] = keys.size();
+            keys.push_back(id);
+            index.invalidate();
+        }
+        return;
+    }
+
+    count += delta;
+    if (count <= 0)
+    {
+        count = 0;
+        // move the last key into the removed key's place
+        Id last = keys.back();
+        keys[position[id]] = last;
+        position[last] = position[id];
+        keys.pop_back();
+        index.invalidate();
+    }
+}
+
+/**
+ * @brief Gets the number of present ids.
+ * @return The number of ids with a positive count.
+ */
+size_t DenseCountStore::size() const
+{
+    return keys.size();
+}
+
+/**
+ * @brief Gets the present ids in alphabetical order of their names.
+ *
+ * @param symbols The table the ids were interned in.
+ * @return The sorted ids, valid until the store is modified.
+ */
+const std::vector<Id> &DenseCountStore::sorted_ids(const SymbolTable &symbols)
+{
+    if (index.is_valid())
+    {
+        return index.get();
+    }
+    return index.rebuild(keys, symbols);
+}
+
+/**
+ * @brief Creates an empty hash store.
+ */
+HashCountStore::HashCountStore() : slots(16)
+{
+}
+
+/**
+ * @brief Gets the slot an id's probe sequence starts at.
+ *
+ * Fibonacci hashing: the id is multiplied by 2^32 divided by the golden ratio and the top bits of
+ * the 32-bit product pick the slot, so every bit of the id affects it, not only the low ones.
+ *
+ * @param id The id.
+ * @return The index of the slot in slots.
+ */
+size_t HashCountStore::home_slot(Id id) const
+{
+    return (uint32_t)(id * 2654435761u) >> shift;
+}
+
+/**
+ * @brief Finds the slot holding an id, or the empty slot where it would be inserted.
+ *
+ * @param id The id to look for.
+ * @return The index of the slot in slots.
+ */
+size_t HashCountStore::find_slot(Id id) const
+{
+    size_t mask = slots.size() - 1;
+    size_t i = home_slot(id);
+    while (slots[i].id != SymbolTable::none && slots[i].id != id)
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * @brief Empties a slot and shifts later entries of its probe sequence back, so no tombstones are needed.
+ *
+ * @param i The index of the slot to empty.
+ *
+ * @note This method modifies the slots in place.
+ */
+void HashCountStore::erase_slot(size_t i)
+{
+    size_t mask = slots.size() - 1;
+    size_t j = i;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (slots[j].id == SymbolTable::none)
+        {
+            break;
+        }
+        size_t home = home_slot(slots[j].id);
+        // the entry at j can fill the hole at i only if its home slot is not cyclically in (i, j]
+        bool movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable)
+        {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i] = Slot();
+    used--;
+}
+
+/**
+ * @brief Doubles the number of slots and reinserts every entry.
+ *
+ * @note This method modifies the slots in place.
+ */
+void HashCountStore::grow()
+{
+    std::vector<Slot> larger(slots.size() * 2);
+    slots.swap(larger);
+    shift--;
+    for (const Slot &slot : larger)
+    {
+        if (slot.id != SymbolTable::none)
+        {
+            slots[find_slot(slot.id)] = slot;
+        }
+    }
+}
+
+/**
+ * @brief Gets the count of an id.
+ *
+ * @param id The id to look up, may be SymbolTable::none.
+ * @return The count, or 0 if the id is not present.
+ */
+int HashCountStore::get(Id id) const
+{
+    if (id == SymbolTable::none)
+    {
+        return 0;
+    }
+    return slots[find_slot(id)].count;
+}
+
+/**
+ * @brief Adds to the count of an id, inserting or removing it as needed.
+ *
+ * A missing id is inserted if delta is positive and left missing otherwise. A present id whose
+ * count drops to zero or below is removed.
+ *
+ * @param id The id to update.
+ * @param delta The amount to add, negative to decrease the count.
+ *
+ * @note This method modifies the counts in place.
+ */
+void HashCountStore::add(Id id, int delta)
+{
+    if (id == SymbolTable::none)
+    {
+        return;
+    }
+    size_t i = find_slot(id);
+    if (slots[i].id == SymbolTable::none) // missing
+    {
+        if (delta > 0)
+        {
+            slots[i].id = id;
+            slots[i].count = delta;
+            used++;
+            index.invalidate();
+            // keep the table at most half full, so probe sequences stay short
+            if (used * 2 > slots.size())
+            {
+                grow();
+            }
+        }
+        return;
+    }
+
+    slots[i].count += delta;
+    if (slots[i].count <= 0)
+    {
+        erase_slot(i);
+        index.invalidate();
+    }
+}
+
+/**
+ * @brief Gets the number of present ids.
+ * @return The number of ids with a positive count.
+ */
+size_t HashCountStore::size() const
+{
+    return used;
+}
+
+/**
+ * @brief Gets the present ids in alphabetical order of their names.
+ *
+ * @param symbols The table the ids were interned in.
+ * @return The sorted ids, valid until the store is modified.
+ */
+const std::vector<Id> &HashCountStore::sorted_ids(const SymbolTable &symbols)
+{
+    if (index.is_valid())
+    {
+        return index.get();
+    }
+    gathered.clear();
+    for (const Slot &slot : slots)
+    {
+        if (slot.id != SymbolTable::none)
+        {
+            gathered.push_back(slot.id);
+        }
+    }
+    return index.rebuild(gathered, symbols);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file CountStore.h
+ * @brief Storage engines for the ingredient, potion and trophy counts of the Inventory.
+ *
+ * A count store maps interned ids to positive counts. An id whose count drops to zero or below
+ * is removed, the same way the inventory used to erase entries from its maps. Two engines
+ * with the same interface are provided:
+ *
+ * - DenseCountStore keeps one int per interned id in a flat vector, so every update is a
+ *   single indexed access. It suits sessions where most names end up in the store.
+ * - HashCountStore keeps only the ids present in an open-addressing hash table with linear
+ *   probing, so its size follows the number of entries instead of the number of ids.
+ *
+ * The engine used by Inventory is chosen at build time: CountStore is HashCountStore when
+ * WITCHER_HASH_STORE is defined and DenseCountStore otherwise.
+ *
+ * Both engines serve ordered traversals from a SortedIndex, a list of the present ids sorted by
+ * name that is rebuilt lazily, only after the set of present ids changed.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "SymbolTable.h"
+
+/**
+ * @class SortedIndex
+ * @brief Ids of a store sorted by name, rebuilt only when the set of ids changes.
+ */
+class SortedIndex
+{
+public:
+    void invalidate();
+    bool is_valid() const;
+    const std::vector<Id> &rebuild(const std::vector<Id> &present, const SymbolTable &symbols);
+    const std::vector<Id> &get() const;
+
+private:
+    std::vector<Id> ids; // present ids in alphabetical order of their names
+    bool valid = true;   // false once an id was added or removed after the last rebuild
+};
+
+/**
+ * @class DenseCountStore
+ * @brief Counts in a vector indexed directly by id.
+ */
+class DenseCountStore
+{
+public:
+    int get(Id id) const;
+    void add(Id id, int delta);
+    size_t size() const;
+    const std::vector<Id> &sorted_ids(const SymbolTable &symbols);
+
+private:
+    std::vector<int> counts;        // count of every id, 0 for ids that are not present
+    std::vector<Id> keys;           // present ids in no particular order
+    std::vector<uint32_t> position; // position of each present id in keys
+    SortedIndex index;
+};
+
+/**
+ * @class HashCountStore
+ * @brief Counts in an open-addressing hash table keyed on id.
+ */
+class HashCountStore
+{
+public:
+    HashCountStore();
+    int get(Id id) const;
+    void add(Id id, int delta);
+    size_t size() const;
+    const std::vector<Id> &sorted_ids(const SymbolTable &symbols);
+
+private:
+    struct Slot
+    {
+        Id id = SymbolTable::none; // SymbolTable::none marks an empty slot
+        int count = 0;
+    };
+    std::vector<Slot> slots;  // its size is always a power of two
+    unsigned shift = 28;      // 32 minus the log2 of the number of slots
+    size_t used = 0;          // number of occupied slots
+    std::vector<Id> gathered; // reusable buffer for the present ids when the index is rebuilt
+    SortedIndex index;
+
+    size_t home_slot(Id id) const;
+    size_t find_slot(Id id) const;
+    void erase_slot(size_t i);
+    void grow();
+};
+
+#ifdef WITCHER_HASH_STORE
+using CountStore = HashCountStore;
+#else
+using CountStore = DenseCountStore;
+#endif
@@ -7,10 +7,19 @@
  */
 
 #include "Inventory.h"
-#include "Utils.h"
 #include <string>
-#include <map>
-#include <set>
+
+/**
+ * @brief Creates an empty inventory.
+ *
+ * @param symbols The table the ids of the commands given to this inventory were interned in.
+ * @param out The sink every response of this inventory is written to.
+ * @param scratch The resource temporaries of a single command are allocated from.
+ */
+Inventory::Inventory(const SymbolTable &symbols, OutputSink &out, std::pmr::memory_resource *scratch)
+    : symbols(symbols), out(out), scratch(scratch), ingredient_totals(symbols), potion_totals(symbols), trophy_totals(symbols)
+{
+}
 
 /**
  * @brief Handles the loot command by adding ingredients to the inventory.
@@ -19,123 +28,139 @@
  * to the inventory. It expects the command to be well-formed and does not
  * perform extensive error checking.
  *
+ * @param cmd The parsed command.
+ *
  * @note This method modifies the ingredients in place.
  */
-void Inventory::handle_loot()
+void Inventory::handle_loot(const LootCmd &cmd)
 {
-    int curr_index = 2;
-    while (curr_index < Utils::word_count - 1)
+    for (const Item &item : cmd.ingredients)
     {
-        int cnt = std::stoi(Utils::words[curr_index]);
-        std::string ing = Utils::words[curr_index + 1];
-        add_ingredient(ing, cnt);
-        curr_index += 3;
+        add_ingredient(item.id, item.count);
     }
-    std::cout << "Alchemy ingredients obtained\n";
+    out << "Alchemy ingredients obtained\n";
 }
 
 /**
  * @brief Increases amount of an ingredient or adds it to the inventory.
  *
- * @param name The name of the ingredient to add.
+ * @param name The id of the ingredient to add.
  * @param count The amount of the ingredient to add.
  *
- * @note This method modifies the ingredients in place.
+ * @note This method modifies the ingredients, the readiness index and the ingredient totals cache in place.
  */
-void Inventory::add_ingredient(std::string name, int count)
+void Inventory::add_ingredient(Id name, int count)
 {
-    if (ingredients.find(name) != ingredients.end())
-    {
-        ingredients[name] += count;
-    }
-    else
+    int before = ingredients.get(name);
+    ingredients.add(name, count);
+    int after = ingredients.get(name);
+    readiness.stock_changed(name, before, after);
+    ingredient_totals.changed(name, before, after);
+    unpublished(ingredients_view.changed, name);
+}
+
+/**
+ * @brief Handles the trade command by exchanging trophies for ingredients.
+ *
+ * This method processes the trade command and updates the inventory accordingly. The trophies to be traded are
+ * merged into a TradeDelta, so a trophy named twice needs the sum of both counts, and the whole delta is checked
+ * against the trophies before anything changes. If the trade is valid, it removes the trophies from the inventory
+ * and adds the specified ingredients.
+ *
+ * @param cmd The parsed command.
+ *
+ * @note This method modifies the inventory and trophies in place.
+ */
+void Inventory::handle_trade(const TradeCmd &cmd)
+{
+    TradeDelta given(scratch);
+    apply_trade(cmd, given);
+}
+
+/**
+ * @brief Handles many trade commands in one call, as if each was handled in turn.
+ *
+ * Every trade is checked and applied as in handle_trade, in order, so a trade sees the trophies every earlier
+ * trade of the batch left, and the responses and the final state are those of handling the trades one by one.
+ * The batch reuses a single delta for all of its trades instead of building one per call.
+ *
+ * @param trades The parsed commands, e.g. of a marketplace simulation.
+ * @return The number of successful trades.
+ *
+ * @note This method modifies the inventory and trophies in place.
+ */
+int Inventory::handle_trades(const std::vector<TradeCmd> &trades)
+{
+    TradeDelta given(scratch);
+    int successful = 0;
+    for (const TradeCmd &cmd : trades)
     {
-        ingredients[name] = count;
+        successful += apply_trade(cmd, given);
     }
+    return successful;
 }
 
 /**
- * @brief Handles the trade command by exchanging trophies for ingredients.
+ * @brief Checks a trade as one merged delta of its trophies and applies all of it or nothing.
  *
- * This method processes the trade command and updates the inventory accordingly. It first checks the trophies
- * to be traded to ensure that there are enough trophies available. If the trade is valid, it removes the trophies
- * from the inventory and adds the specified ingredients.
+ * @param cmd The parsed command.
+ * @param given The delta the trophies are merged into, its previous contents are replaced.
+ * @return true if the trade was successful, false if nothing changed.
  *
  * @note This method modifies the inventory and trophies in place.
  */
-void Inventory::handle_trade()
+bool Inventory::apply_trade(const TradeCmd &cmd, TradeDelta &given)
 {
-    int curr_index = 2;
-    std::map<std::string, int> trophies_to_trade;
-    while (true)
+    given.assign(cmd.trophies);
+    if (!given.covered_by(trophies))
     {
-        int cnt = std::stoi(Utils::words[curr_index]);
-        std::string trophy = Utils::words[curr_index + 1];
-        if (trophies.find(trophy) == trophies.end() || trophies[trophy] < cnt)
-        {
-            std::cout << "Not enough trophies\n";
-            return;
-        }
-        trophies_to_trade[trophy] = cnt;
-        if (Utils::words[curr_index + 3] == "for")
-        {
-            curr_index += 4;
-            break;
-        }
-        curr_index += 3;
+        out << "Not enough trophies\n";
+        return false;
     }
-    for (const auto &pair : trophies_to_trade)
+    for (const TradeDelta::Entry &entry : given.entries())
     {
-        decrease_trophy(pair.first, pair.second);
+        change_trophy_count(entry.id, -(int)entry.count); // covered, so it fits in an int
     }
-    while (curr_index < Utils::word_count - 1)
+    for (const Item &item : cmd.ingredients)
     {
-        int cnt = std::stoi(Utils::words[curr_index]);
-        std::string ing = Utils::words[curr_index + 1];
-        add_ingredient(ing, cnt);
-        curr_index += 3;
+        add_ingredient(item.id, item.count);
     }
-    std::cout << "Trade successful\n";
+    out << "Trade successful\n";
+    return true;
 }
 
 /**
- * @brief Decreases the count of a trophy in the inventory.
+ * @brief Changes the count of a trophy in the inventory.
  *
- * @param name The name of the trophy to decrease.
- * @param count The amount to decrease the trophy by.
+ * @param name The id of the trophy.
+ * @param delta The number of trophies gained, or minus the number given away.
  *
- * @note This method modifies the trophies in place.
+ * @note This method modifies the trophies and their totals cache in place.
  */
-void Inventory::decrease_trophy(std::string name, int count)
+void Inventory::change_trophy_count(Id name, int delta)
 {
-    if (trophies.find(name) != trophies.end())
-    {
-        trophies[name] -= count;
-        if (trophies[name] <= 0)
-        {
-            trophies.erase(name);
-        }
-    }
+    int before = trophies.get(name);
+    trophies.add(name, delta);
+    trophy_totals.changed(name, before, trophies.get(name));
+    unpublished(trophies_view.changed, name);
 }
 
 /**
  * @brief Uses a specified amount of an ingredient from the inventory.
  *
- * @param name The name of the ingredient to use.
+ * @param name The id of the ingredient to use.
  * @param count The amount of the ingredient to use.
  *
- * @note This method modifies the ingredients in place.
+ * @note This method modifies the ingredients, the readiness index and the ingredient totals cache in place.
  */
-void Inventory::use_ingredient(std::string name, int count)
+void Inventory::use_ingredient(Id name, int count)
 {
-    if (ingredients.find(name) != ingredients.end())
-    {
-        ingredients[name] -= count;
-        if (ingredients[name] <= 0)
-        {
-            ingredients.erase(name);
-        }
-    }
+    int before = ingredients.get(name);
+    ingredients.add(name, -count);
+    int after = ingredients.get(name);
+    readiness.stock_changed(name, before, after);
+    ingredient_totals.changed(name, before, after);
+    unpublished(ingredients_view.changed, name);
 }
 
 /**
@@ -144,50 +169,95 @@ void Inventory::use_ingredient(std::string name, int count)
  * This method checks if the player has the necessary ingredients to brew a potion.
  * If the ingredients are sufficient, the potion is created and added to the inventory.
  *
+ * @param cmd The parsed command.
+ *
  * @note This method modifies the ingredients and potions in place.
  */
-void Inventory::handle_brew()
+void Inventory::handle_brew(const BrewCmd &cmd)
 {
-    // first we construct the potion name, since it can be multiple words
-    // we need to start from the 2nd word and go until the last word, since the first two words are "brew" and "potion"
-    std::string potion_name = "";
-    for (int i = 2; i <= Utils::word_count - 1; ++i)
+    std::string_view potion_name = cmd.potion;
+    // if we don't know the potion formula, we can't brew it
+    auto potion = potions.find(cmd.potion_id);
+    if (potion == potions.end())
     {
-        potion_name += Utils::words[i];
-        if (i <= Utils::word_count - 2)
-        {
-            potion_name += " ";
-        }
+        out << "No formula for " << potion_name << "\n";
+        return;
     }
-    // if we don't know the potion formula, we can't brew it
-    if (potions.find(potion_name) == potions.end())
+    // the readiness index knows if every ingredient is in stock, without going through the formula
+    if (!readiness.is_brewable(cmd.potion_id))
     {
-        std::cout << "No formula for " << potion_name << "\n";
+        out << "Not enough ingredients\n";
         return;
     }
-    std::vector<std::pair<std::string, int>> ingredients_needed = potions[potion_name].get_ingredients();
-    // now we need to check if we have all ingredients, we will brew after making sure we have all necessary ingredients
-    for (const auto &pair : ingredients_needed)
+    // if we reached here, we have all ingredients, we can brew the potion
+    brew_up_to(cmd.potion_id, potion->second, 1);
+    out << "Alchemy item created: " << potion_name << "\n";
+}
+
+/**
+ * @brief Handles the brewing of several potions of the same kind at once.
+ *
+ * Brews as many of the requested potions as the ingredients allow, the same number a series of
+ * single brews would create before running out, but deducts the ingredients in a single pass.
+ *
+ * @param cmd The parsed command, with the number of potions to brew.
+ * @return The number of potions brewed, 0 if the formula is unknown or nothing could be brewed.
+ *
+ * @note This method modifies the ingredients and potions in place.
+ */
+int Inventory::handle_brew_batch(const BrewCmd &cmd)
+{
+    std::string_view potion_name = cmd.potion;
+    auto potion = potions.find(cmd.potion_id);
+    if (potion == potions.end())
     {
-        const std::string &name = pair.first;
-        int count = pair.second;
-        if (ingredients.find(name) == ingredients.end() || ingredients[name] < count)
+        out << "No formula for " << potion_name << "\n";
+        return 0;
+    }
+    if (!readiness.is_brewable(cmd.potion_id))
+    {
+        out << "Not enough ingredients\n";
+        return 0;
+    }
+    int brewed = brew_up_to(cmd.potion_id, potion->second, cmd.count);
+    out << "Alchemy items created: " << brewed << " " << potion_name << "\n";
+    return brewed;
+}
+
+/**
+ * @brief Brews up to a number of potions, as many as the ingredients allow.
+ *
+ * The k-th brew of a series is possible while every ingredient still has its largest formula
+ * entry in stock after the k-1 brews before it, so each ingredient allows
+ * (stock - largest) / total + 1 brews. The smallest of these is brewed, and every ingredient is
+ * then reduced by total times that number.
+ *
+ * @param potion_id The id of the potion.
+ * @param potion The potion, with a known formula.
+ * @param wanted The largest number of potions to brew, at least 1.
+ * @return The number of potions brewed.
+ *
+ * @note This method modifies the ingredients and potions in place.
+ */
+int Inventory::brew_up_to(Id potion_id, const Potion &potion, int wanted)
+{
+    const Potion::Requirements &requirements = potion.get_requirements();
+    int brewed = wanted;
+    for (const Requirement &requirement : requirements)
+    {
+        int in_stock = ingredients.get(requirement.ingredient);
+        if (in_stock < requirement.largest)
         {
-            std::cout << "Not enough ingredients\n";
-            return;
+            return 0;
         }
+        brewed = std::min(brewed, (in_stock - requirement.largest) / requirement.total + 1);
     }
-    // if we reached here, we have all ingredients, we can brew the potion
-    for (const auto &pair : ingredients_needed)
+    for (const Requirement &requirement : requirements)
     {
-        const std::string &name = pair.first;
-        int count = pair.second;
-        use_ingredient(name, count);
+        use_ingredient(requirement.ingredient, requirement.total * brewed);
     }
-
-    // now we can add the potion to the inventory
-    potion_counts[potion_name]++;
-    std::cout << "Alchemy item created: " << potion_name << "\n";
+    change_potion_count(potion_id, brewed);
+    return brewed;
 }
 
 /**
@@ -195,37 +265,37 @@ void Inventory::handle_brew()
  *
  * This method updates the bestiary entry for a monster with a new sign.
  *
+ * @param cmd The parsed command.
+ *
  * @note This method modifies the monsters map in place.
  */
-void Inventory::handle_sign_knowledge()
+void Inventory::handle_sign_knowledge(const SignKnowledgeCmd &cmd)
 {
-    // we extract the sign and monster names from line structure with words index
-    std::string sign_name = Utils::words[2];
-    std::string monster_name = Utils::words[7];
+    std::string_view monster_name = cmd.monster;
 
     // if monster wasn't in our database before we create a new monster
-    if (monsters.find(monster_name) == monsters.end())
+    auto monster = monsters.find(cmd.monster_id);
+    if (monster == monsters.end())
     {
-        std::cout << "New bestiary entry added: " << monster_name << "\n";
-        Monster monster;
-        monster.add_sign(sign_name);
-        monsters[monster_name] = monster;
+        out << "New bestiary entry added: " << monster_name << "\n";
+        monsters[cmd.monster_id].add_sign(cmd.sign_id);
+        preparedness.sign_learned(cmd.monster_id);
+        knowledge_changed(cmd.monster_id);
     }
     else
     {
-        // if we saw the monster before, we get the information stored and move on from there
-        std::set<std::string> signs = monsters[monster_name].get_signs();
-
-        // if we don't know about the effectiveness of the sign against the monster, we add it to the bestiary
-        if (signs.find(sign_name) == signs.end())
+        // if we saw the monster before and didn't know about the effectiveness of the sign against it,
+        // adding the sign to the bestiary succeeds
+        if (monster->second.add_sign(cmd.sign_id))
         {
-            std::cout << "Bestiary entry updated: " << monster_name << "\n";
-            monsters[monster_name].add_sign(sign_name);
+            out << "Bestiary entry updated: " << monster_name << "\n";
+            preparedness.sign_learned(cmd.monster_id);
+            knowledge_changed(cmd.monster_id);
         }
         // if we already knew, than we do nothing
         else
         {
-            std::cout << "Already known effectiveness\n";
+            out << "Already known effectiveness\n";
         }
     }
 }
@@ -237,41 +307,32 @@ void Inventory::handle_sign_knowledge()
  * Uses the same logic as handle_sign_knowledge but for potions.
  * We can't use constant indices because of the potion name.
  *
+ * @param cmd The parsed command.
+ *
  * @note This method modifies the monsters map in place.
  */
-void Inventory::handle_potion_knowledge()
+void Inventory::handle_potion_knowledge(const PotionKnowledgeCmd &cmd)
 {
-    std::string potion_name = "";
-    int curr_index = 2;
-    while (Utils::words[curr_index] != "potion")
-    {
-        potion_name += Utils::words[curr_index];
-        if (Utils::words[curr_index + 1] != "potion")
-        {
-            potion_name += " ";
-        }
-        curr_index++;
-    }
-
-    std::string monster_name = Utils::words[curr_index + 4];
-    if (monsters.find(monster_name) == monsters.end())
+    std::string_view monster_name = cmd.monster;
+    auto monster = monsters.find(cmd.monster_id);
+    if (monster == monsters.end())
     {
-        std::cout << "New bestiary entry added: " << monster_name << "\n";
-        Monster monster;
-        monster.add_potion(potion_name);
-        monsters[monster_name] = monster;
+        out << "New bestiary entry added: " << monster_name << "\n";
+        monsters[cmd.monster_id].add_potion(cmd.potion_id);
+        preparedness.potion_learned(cmd.monster_id, cmd.potion_id, potion_counts);
+        knowledge_changed(cmd.monster_id);
     }
     else
     {
-        std::set<std::string> m_potions = monsters[monster_name].get_potions();
-        if (m_potions.find(potion_name) == m_potions.end())
+        if (monster->second.add_potion(cmd.potion_id))
         {
-            std::cout << "Bestiary entry updated: " << monster_name << "\n";
-            monsters[monster_name].add_potion(potion_name);
+            out << "Bestiary entry updated: " << monster_name << "\n";
+            preparedness.potion_learned(cmd.monster_id, cmd.potion_id, potion_counts);
+            knowledge_changed(cmd.monster_id);
         }
         else
         {
-            std::cout << "Already known effectiveness\n";
+            out << "Already known effectiveness\n";
         }
     }
 }
@@ -281,74 +342,68 @@ void Inventory::handle_potion_knowledge()
  *
  * This method adds given potion recipe to the related potion in the inventory.
  *
+ * @param cmd The parsed command.
+ *
  * @note This method modifies the potions map in place.
  */
-void Inventory::handle_potion_recipe()
+void Inventory::handle_potion_recipe(const PotionRecipeCmd &cmd)
 {
-    // similar potion name extraction as before
-    std::string potion_name = "";
-    int curr_index = 2;
-    while (Utils::words[curr_index] != "potion")
-    {
-        potion_name += Utils::words[curr_index];
-        if (Utils::words[curr_index + 1] != "potion")
-        {
-            potion_name += " ";
-        }
-        curr_index++;
-    }
-    if (potions.find(potion_name) != potions.end() && potions[potion_name].get_ingredients().size() > 0)
+    std::string_view potion_name = cmd.potion;
+    auto potion = potions.find(cmd.potion_id);
+    if (potion != potions.end() && !potion->second.get_ingredients().empty())
     {
-        std::cout << "Already known formula\n";
+        out << "Already known formula\n";
     }
     // if we encounter the formula for the first time, we need to add this new information
     else
     {
-        std::vector<std::pair<std::string, int>> formula_ingredients;
-        curr_index += 3;
-        while (curr_index < Utils::word_count - 1)
+        std::vector<std::pair<Id, int>> formula_ingredients;
+        formula_ingredients.reserve(cmd.ingredients.size());
+        for (const Item &item : cmd.ingredients)
         {
-            int cnt = std::stoi(Utils::words[curr_index]);
-            std::string ing = Utils::words[curr_index + 1];
-            formula_ingredients.push_back({ing, cnt});
-            curr_index += 3;
+            formula_ingredients.push_back({item.id, item.count});
         }
-        if (potions.find(potion_name) == potions.end())
-        {
-            Potion potion;
-            potion.set_ingredients(formula_ingredients);
-            potions[potion_name] = potion;
-        }
-        else
-        {
-            potions[potion_name].set_ingredients(formula_ingredients);
-        }
-        std::cout << "New alchemy formula obtained: " << potion_name << "\n";
+        Potion &known = potion == potions.end() ? potions[cmd.potion_id] : potion->second;
+        known.set_ingredients(std::move(formula_ingredients), symbols);
+        readiness.add_formula(cmd.potion_id, known.get_ingredients(), ingredients);
+        formula_changed(cmd.potion_id);
+        out << "New alchemy formula obtained: " << potion_name << "\n";
     }
 }
 
 /**
  * @brief Uses one potion of each type on the specified monster.
  *
- * @param monster_name The name of the monster to use potions on.
+ * @param monster The monster to use potions on.
  *
- * @note This method modifies the potion_counts map in place.
+ * @note This method modifies the potion_counts map and the preparedness index in place.
  */
-void Inventory::use_one_potion_each(std::string monster_name)
+void Inventory::use_one_potion_each(const Monster &monster)
 {
-    for (std::string potion : monsters[monster_name].get_potions())
+    for (Id potion : monster.get_potions())
     {
-        if (potion_counts.find(potion) != potion_counts.end() && potion_counts[potion] > 0)
-        {
-            potion_counts[potion]--;
-            if (potion_counts[potion] == 0)
-            {
-                potion_counts.erase(potion);
-            }
-        }
+        change_potion_count(potion, -1);
     }
 }
 
+/**
+ * @brief Changes the count of a potion and updates the monsters it is effective against.
+ *
+ * @param potion The id of the potion.
+ * @param delta The number of potions brewed, or minus the number used.
+ *
+ * @note This method modifies the potion_counts map, the preparedness index and the potion totals cache in place.
+ */
+void Inventory::change_potion_count(Id potion, int delta)
+{
+    int before = potion_counts.get(potion);
+    potion_counts.add(potion, delta);
+    int after = potion_counts.get(potion);
+    preparedness.stock_changed(potion, before, after);
+    potion_totals.changed(potion, before, after);
+    unpublished(potions_view.changed, potion);
+}
+
 /**
  * @brief Handles a monster encounter.
  *
@@ -357,290 +412,577 @@ void Inventory::use_one_potion_each(std::string monster_name)
  * there is at least one potion available that is known to be effective against the monster, then we survive,
  * use one potion for each effective potion available, or use the sign.
  *
+ * @param cmd The parsed command.
+ *
  * @note This method modifies the trophies map in place.
  */
-void Inventory::handle_encounter()
+void Inventory::handle_encounter(const EncounterCmd &cmd)
 {
-    // first we extract the monster name from the line
-    std::string monster_name = Utils::words[3];
+    std::string_view monster_name = cmd.monster;
 
-    // if we don't know the monster, or we don't know any sign or potion against it, we are unprepared
-    if (monsters.find(monster_name) == monsters.end() ||
-        (monsters[monster_name].get_signs().size() == 0 && monsters[monster_name].get_potions().size() == 0))
+    // if we don't know the monster, or we know neither a sign against it nor have any of its
+    // effective potions, we are unprepared; the preparedness index keeps track of both
+    if (!preparedness.is_prepared(cmd.monster_id))
     {
-        std::cout << "Geralt is unprepared and barely escapes with his life\n";
+        out << "Geralt is unprepared and barely escapes with his life\n";
         return;
     }
-    // if we know the monster, and have some knowledge
-    // if all we know is effective potions, we need to check if we have at least one of them
-    if (monsters[monster_name].get_signs().size() == 0)
-    {
-        bool found = false;
-        for (std::string potion : monsters[monster_name].get_potions())
-        {
-            if (potion_counts.find(potion) != potion_counts.end() && potion_counts[potion] > 0)
-            {
-                found = true;
-                break;
-            }
-        }
-        if (found)
-        {
-            use_one_potion_each(monster_name);
-        }
-        else
-        {
-            std::cout << "Geralt is unprepared and barely escapes with his life\n";
-            return;
-        }
-    }
-    else
+    // we use one of each effective potion we have, there is nothing to use if none are in stock
+    if (preparedness.potions_in_stock(cmd.monster_id) > 0)
     {
-        use_one_potion_each(monster_name);
+        use_one_potion_each(monsters.at(cmd.monster_id));
     }
-    std::cout << "Geralt defeats " << monster_name << "\n";
+    out << "Geralt defeats " << monster_name << "\n";
 
-    if (trophies.find(monster_name) == trophies.end())
-    {
-        trophies[monster_name] = 1;
-    }
-    else
-    {
-        trophies[monster_name]++;
-    }
+    change_trophy_count(cmd.monster_id, 1);
 }
 
 /**
  * @brief Gets the count of a specific ingredient in the inventory.
  *
- * @param name The name of the ingredient to check.
+ * @param name The id of the ingredient to check.
  * @return The count of the ingredient in the inventory, or 0 if it doesn't exist.
  *
  * @note This method does not modify the inventory.
  */
-int Inventory::get_ingredient_count(std::string name)
+int Inventory::get_ingredient_count(Id name)
 {
-    if (ingredients.find(name) != ingredients.end())
-    {
-        return ingredients[name];
-    }
-    return 0;
+    return ingredients.get(name);
 }
 
 /**
  * @brief Prints the ingredients in the inventory.
  *
- * This method is used when we encounter a total ingredient count question. It iterates through the ingredients,
- * and prints them one by one. Because we keep them in a map, we can simply iterate through the map and print them.
+ * This method is used when we encounter a total ingredient count question. It prints the ingredients in
+ * alphabetical order of their names, from a cache that only renders again what changed since the last question.
  *
- * @note This method does not modify the inventory.
+ * @note This method does not modify the inventory, only its totals cache.
  */
 void Inventory::print_ingredients()
 {
-    int ingredient_count = ingredients.size();
-    if (ingredient_count == 0)
+    ingredient_totals.write(out, ingredients);
+}
+
+/**
+ * @brief Gets the count of a specific potion in the inventory.
+ *
+ * @param name The id of the potion to check.
+ * @return The count of the potion in the inventory, or 0 if it doesn't exist.
+ *
+ * @note This method does not modify the inventory.
+ */
+int Inventory::get_potion_count(Id name)
+{
+    return potion_counts.get(name);
+}
+
+/**
+ * @brief Prints the potions in the inventory.
+ *
+ * This method is used when we encounter a total potion count question. It prints the potions in
+ * alphabetical order of their names, from a cache that only renders again what changed since the last question.
+ *
+ * @note This method does not modify the inventory, only its totals cache.
+ */
+void Inventory::print_potions()
+{
+    potion_totals.write(out, potion_counts);
+}
+
+/**
+ * @brief Gets the count of a specific trophy in the inventory.
+ *
+ * @param name The id of the trophy to check.
+ * @return The count of the trophy in the inventory, or 0 if it doesn't exist.
+ *
+ * @note This method does not modify the inventory.
+ */
+int Inventory::get_trophy_count(Id name)
+{
+    return trophies.get(name);
+}
+
+/**
+ * @brief Prints the trophies.
+ *
+ * This method is used when we encounter a total trophy count question. It prints the trophies in
+ * alphabetical order of their names, from a cache that only renders again what changed since the last question.
+ *
+ * @note This method does not modify the inventory, only its totals cache.
+ */
+void Inventory::print_trophies()
+{
+    trophy_totals.write(out, trophies);
+}
+
+/**
+ * @brief Prints the knowledge about a specific monster.
+ *
+ * This method is used when we encounter a monster knowledge question. It retrieves the sign and potion knowledge
+ * for the specified monster and prints them in a comma-separated format, in a merged alphabetical order. The
+ * formatted list is cached by the monster, so asking again without new knowledge is a single write.
+ *
+ * @param query The parsed question, naming the monster whose knowledge is to be printed.
+ *
+ * @note This method does not modify the inventory.
+ */
+void Inventory::print_monster_knowledge(const QueryCmd &query)
+{
+    std::string_view monster_name = query.name;
+    auto monster = monsters.find(query.id);
+    if (monster == monsters.end())
     {
-        std::cout << "None\n";
+        out << "No knowledge of " << monster_name << "\n";
         return;
     }
-
-    int i = 0;
-    for (const auto &pair : ingredients)
+    if (monster->second.get_signs().empty() && monster->second.get_potions().empty())
     {
-        std::cout << pair.second << " " << pair.first;
-        if (i < ingredient_count - 1)
-        {
-            std::cout << ", ";
-        }
-        i++;
+        out << "No knowledge of " << monster_name << "\n";
+        return;
     }
-    std::cout << "\n";
+
+    // the monster keeps the formatted list until its knowledge changes
+    out << monster->second.get_knowledge_line(symbols, scratch);
 }
 
 /**
- * @brief Gets the count of a specific potion in the inventory.
+ * @brief Prints a potion formula.
  *
- * @return The count of the potion in the inventory, or 0 if it doesn't exist.
+ * This method is used when we encounter a potion formula question. It retrieves the ingredients for the specified
+ * potion and prints them in a comma-separated format. It prints them in a descending order of the count, if equal
+ * it prints them in alphabetical order. The formatted formula is cached by the potion.
+ *
+ * @param query The parsed question, naming the potion whose formula is to be printed.
  *
  * @note This method does not modify the inventory.
  */
-int Inventory::get_potion_count()
+void Inventory::print_potion_formula(const QueryCmd &query)
 {
-    std::string name = "";
-    for (int i = 2; i < Utils::word_count - 1; ++i)
+    std::string_view potion_name = query.name;
+    auto potion = potions.find(query.id);
+    if (potion == potions.end())
     {
-        name += Utils::words[i];
-        if (i < Utils::word_count - 2)
-        {
-            name += " ";
-        }
+        out << "No formula for " << potion_name << "\n";
+        return;
     }
-    if (potion_counts.find(name) != potion_counts.end())
+
+    if (potion->second.get_ingredients().empty())
     {
-        return potion_counts[name];
+        out << "No formula for " << potion_name << "\n";
+        return;
     }
-    return 0;
+
+    // the potion keeps the formatted formula, which never changes once known
+    out << potion->second.get_formula_line(symbols);
 }
 
 /**
- * @brief Prints the potions in the inventory.
+ * @brief Registers a function to be called whenever a known potion becomes brewable.
  *
- * This method is used when we encounter a total potion count question. It iterates through the potions,
- * and prints them one by one. Because we keep them in a map, we can simply iterate through the map and print them.
+ * A potion becomes brewable when its formula is learned while all its ingredients are in stock,
+ * or when an ingredient arrives that completes its formula.
  *
- * @note This method does not modify the inventory.
+ * @param listener The function to call with the id of the potion, or an empty function to stop reporting.
+ *
+ * @note The listener must not modify the inventory.
  */
-void Inventory::print_potions()
+void Inventory::set_brewable_listener(std::function<void(Id)> listener)
 {
-    int potion_count = potion_counts.size();
-    if (potion_count == 0)
+    readiness.set_listener(std::move(listener));
+}
+
+/**
+ * @brief Publishes a view of everything the questions read, as of now.
+ *
+ * The first view takes every part of the inventory. Later ones share the parts that didn't change
+ * with the previous view, and take the others from the paged copies the inventory keeps, after
+ * setting the entries of the ids recorded as changed since; only the pages holding those entries
+ * are copied. The names interned since are added to the copy of the names the same way.
+ *
+ * @param epoch The number of lines executed so far, returned by the epoch of the view.
+ * @return The view, which doesn't change as the inventory does.
+ */
+std::shared_ptr<const InventoryView> Inventory::publish(uint64_t epoch)
+{
+    auto view = std::make_shared<InventoryView>();
+    view->lines = epoch;
+    const InventoryView *previous = published.get();
+    bool all = previous == nullptr;
+    if (all || published_names.size < symbols.size())
     {
-        std::cout << "None\n";
-        return;
+        for (Id id = (Id)published_names.size; id < symbols.size(); ++id)
+        {
+            published_names.add(symbols.name(id));
+        }
+        view->symbols = std::make_shared<const InventoryView::Names>(published_names);
     }
+    else
+    {
+        view->symbols = previous->symbols;
+    }
+
+    view->ingredients = take_counts(ingredients, ingredient_totals, ingredients_view,
+                                    all ? nullptr : &previous->ingredients);
+    view->potions = take_counts(potion_counts, potion_totals, potions_view, all ? nullptr : &previous->potions);
+    view->trophies = take_counts(trophies, trophy_totals, trophies_view, all ? nullptr : &previous->trophies);
 
-    int i = 0;
-    for (auto &pair : potion_counts)
+    if (all || !knowledge_view.changed.empty())
     {
-        std::cout << pair.second << " " << pair.first;
-        if (i < potion_count - 1)
+        auto take_line = [&](Id id, const Monster &monster)
+        {
+            if (!monster.get_signs().empty() || !monster.get_potions().empty())
+            {
+                const std::string &line = monster.get_knowledge_line(symbols, scratch);
+                knowledge_view.entries.set(id, std::make_shared<const std::string>(line));
+            }
+        };
+        if (all)
         {
-            std::cout << ", ";
+            for (const auto &monster : monsters)
+            {
+                take_line(monster.first, monster.second);
+            }
+        }
+        for (Id id : knowledge_view.changed)
+        {
+            take_line(id, monsters.at(id));
         }
-        i++;
+        knowledge_view.changed.clear();
+        view->knowledge = std::make_shared<const InventoryView::Lines>(knowledge_view.entries);
     }
-    std::cout << "\n";
+    else
+    {
+        view->knowledge = previous->knowledge;
+    }
+
+    if (all || !formulas_view.changed.empty())
+    {
+        auto take_line = [&](Id id, const Potion &potion)
+        {
+            if (!potion.get_ingredients().empty())
+            {
+                const std::string &line = potion.get_formula_line(symbols);
+                formulas_view.entries.set(id, std::make_shared<const std::string>(line));
+            }
+        };
+        if (all)
+        {
+            for (const auto &potion : potions)
+            {
+                take_line(potion.first, potion.second);
+            }
+        }
+        for (Id id : formulas_view.changed)
+        {
+            take_line(id, potions.at(id));
+        }
+        formulas_view.changed.clear();
+        view->formulas = std::make_shared<const InventoryView::Lines>(formulas_view.entries);
+    }
+    else
+    {
+        view->formulas = previous->formulas;
+    }
+
+    published = view;
+    return view;
 }
 
 /**
- * @brief Gets the count of a specific trophy in the inventory.
+ * @brief Records that an entry changed, for the next view to publish.
  *
- * @param name The name of the trophy to check.
- * @return The count of the trophy in the inventory, or 0 if it doesn't exist.
+ * Before the first view nothing is recorded, as it takes every entry anyway.
  *
- * @note This method does not modify the inventory.
+ * @param changed The ids changed since the last view, of the part the entry belongs to.
+ * @param id The id of the entry.
  */
-int Inventory::get_trophy_count(std::string name)
+void Inventory::unpublished(std::vector<Id> &changed, Id id)
 {
-    if (trophies.find(name) != trophies.end())
+    if (published != nullptr)
     {
-        return trophies[name];
+        changed.push_back(id);
     }
-    return 0;
 }
 
 /**
- * @brief Prints the trophies.
+ * @brief Records that the knowledge about a monster changed, for the next view to publish.
  *
- * This method is used when we encounter a total trophy count question. It iterates through the trophies,
- * and prints them one by one. Because we keep them in a map, we can simply iterate through the map and print them.
+ * @param monster The id of the monster.
+ */
+void Inventory::knowledge_changed(Id monster)
+{
+    unpublished(knowledge_view.changed, monster);
+}
+
+/**
+ * @brief Records that the formula of a potion was learned, for the next view to publish.
  *
- * @note This method does not modify the inventory.
+ * @param potion The id of the potion.
  */
-void Inventory::print_trophies()
+void Inventory::formula_changed(Id potion)
 {
-    int trophy_count = trophies.size();
-    if (trophy_count == 0)
+    unpublished(formulas_view.changed, potion);
+}
+
+/**
+ * @brief Takes the counts of a store and the blocks of its totals answer, for a view.
+ *
+ * @param store The store.
+ * @param totals The totals cache of the store.
+ * @param part The paged copy of the counts and the ids changed since the last view.
+ * @param previous The part of the last view, or null for the first view, which takes every count.
+ * @return The counts part, the previous one if no count changed.
+ */
+std::shared_ptr<const InventoryView::Counts> Inventory::take_counts(const CountStore &store, TotalsCache &totals,
+                                                                    ViewPart<int> &part,
+                                                                    const std::shared_ptr<const InventoryView::Counts> *previous)
+{
+    if (previous != nullptr && part.changed.empty())
     {
-        std::cout << "None\n";
-        return;
+        return *previous;
     }
-    int i = 0;
-    for (const auto &pair : trophies)
+    if (previous == nullptr)
     {
-        std::cout << pair.second << " " << pair.first;
-        if (i < trophy_count - 1)
+        for (Id id = 0; id < symbols.size(); ++id)
         {
-            std::cout << ", ";
+            if (int count = store.get(id))
+            {
+                part.entries.set(id, count);
+            }
         }
-        i++;
     }
-    std::cout << "\n";
+    for (Id id : part.changed)
+    {
+        part.entries.set(id, store.get(id));
+    }
+    part.changed.clear();
+
+    auto counts = std::make_shared<InventoryView::Counts>();
+    counts->by_id = part.entries;
+    totals.publish(counts->totals, store);
+    return counts;
 }
 
 /**
- * @brief Prints the knowledge about a specific monster.
+ * @brief Writes the counts of a store, in the order of their names.
  *
- * This method is used when we encounter a monster knowledge question. It retrieves the sign and potion knowledge
- * for the specified monster and prints them in a comma-separated format, in a merged alphabetical order.
- *
- * @param monster_name The name of the monster whose knowledge is to be printed.
- *
- * @note This method does not modify the inventory.
+ * @param writer The snapshot being written.
+ * @param store The store to write.
+ * @param symbols The table the ids of the store were interned in.
  */
-void Inventory::print_monster_knowledge(std::string monster_name)
+static void save_counts(SnapshotWriter &writer, CountStore &store, const SymbolTable &symbols)
 {
-    if (monsters.find(monster_name) == monsters.end())
+    const std::vector<Id> &ids = store.sorted_ids(symbols);
+    writer.u32((uint32_t)ids.size());
+    for (Id id : ids)
     {
-        std::cout << "No knowledge of " << monster_name << "\n";
-        return;
+        writer.u32(id);
+        writer.u32((uint32_t)store.get(id));
     }
-    std::set<std::string> signs = monsters[monster_name].get_signs();
-    std::set<std::string> m_potions = monsters[monster_name].get_potions();
+}
 
-    if (signs.empty() && m_potions.empty())
+/**
+ * @brief Sorts the keys of a map, so a snapshot doesn't depend on the order of a hash table.
+ *
+ * @param map The map to get the keys of.
+ * @return The keys in increasing order.
+ */
+template <typename Value>
+static std::vector<Id> sorted_keys(const std::unordered_map<Id, Value> &map)
+{
+    std::vector<Id> keys;
+    keys.reserve(map.size());
+    for (const auto &pair : map)
     {
-        std::cout << "No knowledge of " << monster_name << "\n";
-        return;
+        keys.push_back(pair.first);
     }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+/**
+ * @brief Writes the whole state of the inventory to a snapshot.
+ *
+ * The counts, the potion formulas and the bestiary are written with the ids they are keyed on.
+ * The indexes and cached answers are not written, restore rebuilds them from this state.
+ * Entries are written in a fixed order, so the same state always gives the same bytes.
+ *
+ * @param writer The snapshot being written.
+ *
+ * @note The state is not modified, but the sorted indexes of the stores may be rebuilt.
+ */
+void Inventory::save(SnapshotWriter &writer)
+{
+    save_counts(writer, ingredients, symbols);
+    save_counts(writer, trophies, symbols);
+    save_counts(writer, potion_counts, symbols);
 
-    std::vector<std::string> merged;
-    merged.reserve(signs.size() + m_potions.size());
-    std::merge(signs.begin(), signs.end(), m_potions.begin(), m_potions.end(), std::back_inserter(merged));
+    writer.u32((uint32_t)potions.size());
+    for (Id id : sorted_keys(potions))
+    {
+        const Formula &formula = potions.at(id).get_ingredients();
+        writer.u32(id);
+        writer.u32((uint32_t)formula.size());
+        for (const auto &entry : formula)
+        {
+            writer.u32(entry.first);
+            writer.u32((uint32_t)entry.second);
+        }
+    }
 
-    for (size_t i = 0; i < merged.size(); ++i)
+    writer.u32((uint32_t)monsters.size());
+    for (Id id : sorted_keys(monsters))
     {
-        std::cout << merged[i];
-        if (i < merged.size() - 1)
+        const Monster &monster = monsters.at(id);
+        writer.u32(id);
+        writer.u32((uint32_t)monster.get_signs().size());
+        for (Id sign : monster.get_signs())
+        {
+            writer.u32(sign);
+        }
+        writer.u32((uint32_t)monster.get_potions().size());
+        for (Id potion : monster.get_potions())
         {
-            std::cout << ", ";
+            writer.u32(potion);
         }
     }
-    std::cout << "\n";
 }
 
 /**
- * @brief Prints a potion formula.
+ * @brief Reads an id and checks that it was interned.
  *
- * This method is used when we encounter a potion formula question. It retrieves the ingredients for the specified
- * potion and prints them in a comma-separated format. It prints them in a descending order of the count, if equal
- * it prints them in alphabetical order.
+ * @param reader The snapshot being read.
+ * @param symbols The table the id must belong to.
+ * @param id Set to the id read.
+ * @return false if the snapshot ends or the id is unknown, true otherwise.
+ */
+static bool read_id(SnapshotReader &reader, const SymbolTable &symbols, Id &id)
+{
+    return reader.u32(id) && id < symbols.size();
+}
+
+/**
+ * @brief Reads a count and checks that it is positive, as every count kept in the inventory is.
  *
- * @note This method does not modify the inventory.
+ * @param reader The snapshot being read.
+ * @param count Set to the count read.
+ * @return false if the snapshot ends or the count is out of range, true otherwise.
  */
-void Inventory::print_potion_formula()
+static bool read_count(SnapshotReader &reader, int &count)
 {
-    std::string potion_name = "";
-    for (int i = 3; i < Utils::word_count - 1; ++i)
+    uint32_t value = 0;
+    if (!reader.u32(value) || value == 0 || value > INT32_MAX)
     {
-        potion_name += Utils::words[i];
-        if (i < Utils::word_count - 2)
+        return false;
+    }
+    count = (int)value;
+    return true;
+}
+
+/**
+ * @brief Reads the state written by save into an empty inventory.
+ *
+ * Every entry goes through the same update as the command that created it, so the readiness
+ * and preparedness indexes and the totals caches are rebuilt along with the state.
+ *
+ * @param reader The snapshot being read, positioned where save started writing.
+ * @return false if the snapshot is malformed, true otherwise. After a failure the inventory holds
+ *         part of the snapshot and should be discarded.
+ */
+bool Inventory::restore(SnapshotReader &reader)
+{
+    uint32_t entries = 0;
+    Id id = 0;
+    int count = 0;
+
+    for (int store = 0; store < 3; ++store)
+    {
+        if (!reader.u32(entries))
         {
-            potion_name += " ";
+            return false;
+        }
+        for (uint32_t i = 0; i < entries; ++i)
+        {
+            if (!read_id(reader, symbols, id) || !read_count(reader, count))
+            {
+                return false;
+            }
+            if (store == 0)
+            {
+                add_ingredient(id, count);
+            }
+            else if (store == 1)
+            {
+                change_trophy_count(id, count);
+            }
+            else
+            {
+                change_potion_count(id, count);
+            }
         }
     }
-    if (potions.find(potion_name) == potions.end())
+
+    if (!reader.u32(entries))
     {
-        std::cout << "No formula for " << potion_name << "\n";
-        return;
+        return false;
+    }
+    for (uint32_t i = 0; i < entries; ++i)
+    {
+        uint32_t size = 0;
+        if (!read_id(reader, symbols, id) || !reader.u32(size) || size == 0 || size > reader.remaining() / 8)
+        {
+            return false;
+        }
+        std::vector<std::pair<Id, int>> formula(size);
+        for (auto &entry : formula)
+        {
+            if (!read_id(reader, symbols, entry.first) || !read_count(reader, entry.second))
+            {
+                return false;
+            }
+        }
+        Potion &known = potions[id];
+        known.set_ingredients(std::move(formula), symbols);
+        readiness.add_formula(id, known.get_ingredients(), ingredients);
+        formula_changed(id);
     }
 
-    std::vector<std::pair<std::string, int>> ingredients = potions[potion_name].get_ingredients();
-    if (ingredients.empty())
+    if (!reader.u32(entries))
     {
-        std::cout << "No formula for " << potion_name << "\n";
-        return;
+        return false;
     }
-    int ingredient_count = ingredients.size();
-    int i = 0;
-    for (const auto &pair : ingredients)
+    for (uint32_t i = 0; i < entries; ++i)
     {
-        std::cout << pair.second << " " << pair.first;
-        if (i < ingredient_count - 1)
+        uint32_t size = 0;
+        if (!read_id(reader, symbols, id))
+        {
+            return false;
+        }
+        Id monster_id = id;
+        Monster &monster = monsters[monster_id];
+        knowledge_changed(monster_id);
+        for (int kind = 0; kind < 2; ++kind)
         {
-            std::cout << ", ";
+            if (!reader.u32(size))
+            {
+                return false;
+            }
+            for (uint32_t k = 0; k < size; ++k)
+            {
+                if (!read_id(reader, symbols, id))
+                {
+                    return false;
+                }
+                if (kind == 0 && monster.add_sign(id))
+                {
+                    preparedness.sign_learned(monster_id);
+                }
+                else if (kind == 1 && monster.add_potion(id))
+                {
+                    preparedness.potion_learned(monster_id, id, potion_counts);
+                }
+            }
         }
-        i++;
     }
-    std::cout << "\n";
+    return true;
 }
@@ -11,46 +11,123 @@
  * Internal state is fully encapsulated, and updates are only allowed through class methods
  * to maintain data consistency.
  *
+ * Whether a potion can be brewed is kept up to date in a ReadinessIndex as ingredients come and
+ * go, so a brew attempt is rejected without looking at its formula. In the same way a
+ * PreparednessIndex follows, for every monster, whether a sign is known against it and how many of
+ * its effective potions are in stock, so an encounter is decided without looking at the bestiary.
+ * The answers to the totals questions are kept rendered in a TotalsCache per kind, and only the
+ * parts that changed since the last question are rendered again. A trade is checked and applied
+ * as one merged TradeDelta of its trophies, and handle_trades applies a whole batch of them.
+ *
+ * publish copies what the questions read into an immutable InventoryView, so other threads can
+ * answer questions while this one executes more lines. Once a view was published, the inventory
+ * records the ids whose counts, knowledge or formula changed, and the next view copies only the
+ * pages of those entries and shares the rest, so publishing takes time in proportion to what
+ * changed since the last view, not to the size of the inventory.
+ *
+ * The state can be written to a binary snapshot with save and read back into an empty inventory
+ * with restore, which rebuilds the indexes and caches as the entries are added.
+ *
+ * Handlers take the typed Command that Utils::Parser produced for an already validated line,
+ * and write their responses to the OutputSink given at construction. Containers that only live
+ * while a line is handled are allocated from the scratch memory resource given at construction,
+ * which the Session resets between lines. Each instance is independent, so separate sessions can
+ * run on separate threads.
+ *
  * @note This class assumes all input commands are syntactically and semantically valid.
  *       No input validation is performed internally.
  */
 
 #pragma once
-#include <map>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
-#include <iostream>
 #include <algorithm>
+#include <functional>
+#include <memory>
 #include "Potion.h"
 #include "Monster.h"
+#include "Command.h"
+#include "SymbolTable.h"
+#include "CountStore.h"
+#include "InventoryView.h"
+#include "OutputSink.h"
+#include "PreparednessIndex.h"
+#include "ReadinessIndex.h"
+#include "Snapshot.h"
+#include "TotalsCache.h"
+#include "TradeDelta.h"
 
 class Inventory
 {
 public:
-    void handle_loot();
-    void handle_trade();
-    void handle_brew();
-    void handle_sign_knowledge();
-    void handle_potion_knowledge();
-    void handle_potion_recipe();
-    void handle_encounter();
-    int get_ingredient_count(std::string name);
+    Inventory(const SymbolTable &symbols, OutputSink &out,
+              std::pmr::memory_resource *scratch = std::pmr::get_default_resource());
+    void handle_loot(const LootCmd &cmd);
+    void handle_trade(const TradeCmd &cmd);
+    int handle_trades(const std::vector<TradeCmd> &trades);
+    void handle_brew(const BrewCmd &cmd);
+    int handle_brew_batch(const BrewCmd &cmd);
+    void handle_sign_knowledge(const SignKnowledgeCmd &cmd);
+    void handle_potion_knowledge(const PotionKnowledgeCmd &cmd);
+    void handle_potion_recipe(const PotionRecipeCmd &cmd);
+    void handle_encounter(const EncounterCmd &cmd);
+    int get_ingredient_count(Id name);
     void print_ingredients();
-    int get_potion_count();
+    int get_potion_count(Id name);
     void print_potions();
-    int get_trophy_count(std::string name);
+    int get_trophy_count(Id name);
     void print_trophies();
-    void print_monster_knowledge(std::string monster_name);
-    void print_potion_formula();
+    void print_monster_knowledge(const QueryCmd &query);
+    void print_potion_formula(const QueryCmd &query);
+    void set_brewable_listener(std::function<void(Id)> listener);
+    std::shared_ptr<const InventoryView> publish(uint64_t epoch);
+    void save(SnapshotWriter &writer);
+    bool restore(SnapshotReader &reader);
 
 private:
-    std::map<std::string, int> ingredients;   // a map to keep count of ingredients in alphabetical order
-    std::map<std::string, int> trophies;      // a map to keep count of trophies in alphabetical order
-    std::map<std::string, int> potion_counts; // a map to keep count of potions in alphabetical order
-    std::map<std::string, Potion> potions;    // a map to keep count of potions in alphabetical order
-    std::map<std::string, Monster> monsters;  // a map to keep count of monsters in alphabetical order
-    void add_ingredient(std::string name, int count);
-    void decrease_trophy(std::string name, int count);
-    void use_ingredient(std::string name, int count);
-    void use_one_potion_each(std::string monster_name);
+    const SymbolTable &symbols; // names of the ids used as keys below
+    OutputSink &out;            // where responses are written
+    std::pmr::memory_resource *scratch; // memory for temporaries of the line being handled
+
+    // all containers are keyed on ids interned in symbols, names are only looked up when printing
+    CountStore ingredients;                   // a store to keep count of ingredients
+    CountStore trophies;                      // a store to keep count of trophies
+    CountStore potion_counts;                 // a store to keep count of potions
+    std::unordered_map<Id, Potion> potions;   // a map to keep the formulas of known potions
+    std::unordered_map<Id, Monster> monsters; // a map to keep the bestiary entries of monsters
+    ReadinessIndex readiness;                 // which known potions the ingredients suffice for
+    PreparednessIndex preparedness;           // which monsters Geralt is prepared to fight
+    TotalsCache ingredient_totals;            // rendered answer to "Total ingredient ?"
+    TotalsCache potion_totals;                // rendered answer to "Total potion ?"
+    TotalsCache trophy_totals;                // rendered answer to "Total trophy ?"
+
+    template <typename T>
+    struct ViewPart
+    {
+        PagedArray<T> entries;   // the entries of the last view, sharing its pages until the next one is taken
+        std::vector<Id> changed; // ids whose entry changed since the last view, recorded once there is one
+    };
+    std::shared_ptr<const InventoryView> published; // the last view published, if any
+    InventoryView::Names published_names;     // the names of the last view, the next one adds the new ones
+    ViewPart<int> ingredients_view;           // ingredient counts
+    ViewPart<int> potions_view;               // potion counts
+    ViewPart<int> trophies_view;              // trophy counts
+    ViewPart<std::shared_ptr<const std::string>> knowledge_view; // monster knowledge lines, by monster
+    ViewPart<std::shared_ptr<const std::string>> formulas_view;  // formula lines, by potion
+    void add_ingredient(Id name, int count);
+    void change_trophy_count(Id name, int delta);
+    bool apply_trade(const TradeCmd &cmd, TradeDelta &given);
+    void use_ingredient(Id name, int count);
+    int brew_up_to(Id potion_id, const Potion &potion, int wanted);
+    void use_one_potion_each(const Monster &monster);
+    void change_potion_count(Id potion, int delta);
+    void unpublished(std::vector<Id> &changed, Id id);
+    void knowledge_changed(Id monster);
+    void formula_changed(Id potion);
+    std::shared_ptr<const InventoryView::Counts> take_counts(const CountStore &store, TotalsCache &totals,
+                                                             ViewPart<int> &part,
+                                                             const std::shared_ptr<const InventoryView::Counts> *previous);
 };
\ No newline at end of file
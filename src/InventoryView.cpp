@@ -0,0 +1,252 @@
+/**
+ * @file InventoryView.cpp
+ * @brief Implements the answers to questions from a published view of an inventory.
+ */
+
+#include "InventoryView.h"
+
+/**
+ * @brief Checks if a view can answer a line, i.e. if the line leaves the state alone.
+ *
+ * @param type The type of the parsed line.
+ * @return true for questions and invalid lines, false for lines the writer has to execute.
+ */
+bool InventoryView::answers(CommandType type)
+{
+    switch (type)
+    {
+    case CommandType::Invalid:
+    case CommandType::IngredientCount:
+    case CommandType::TotalIngredients:
+    case CommandType::PotionCount:
+    case CommandType::TotalPotions:
+    case CommandType::TrophyCount:
+    case CommandType::TotalTrophies:
+    case CommandType::MonsterKnowledge:
+    case CommandType::PotionFormula:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Writes the answer to a line, as the session would have written it at the epoch of the view.
+ *
+ * The names of the command are looked up in the view, so the command doesn't need to be resolved
+ * and the calling thread never touches the session.
+ *
+ * @param command A parsed line for which answers is true.
+ * @param out Where the answer is written.
+ */
+void InventoryView::answer(const Command &command, OutputSink &out) const
+{
+    std::string_view name = command.query.name;
+    switch (command.type)
+    {
+    case CommandType::IngredientCount:
+        out << ingredient_count(name) << "\n";
+        break;
+    case CommandType::TotalIngredients:
+        write_totals(*ingredients, out);
+        break;
+    case CommandType::PotionCount:
+        out << potion_count(name) << "\n";
+        break;
+    case CommandType::TotalPotions:
+        write_totals(*potions, out);
+        break;
+    case CommandType::TrophyCount:
+        out << trophy_count(name) << "\n";
+        break;
+    case CommandType::TotalTrophies:
+        write_totals(*trophies, out);
+        break;
+    case CommandType::MonsterKnowledge:
+        if (const std::string *known = line(*knowledge, symbols->find(name)))
+        {
+            out << *known;
+        }
+        else
+        {
+            out << "No knowledge of " << name << "\n";
+        }
+        break;
+    case CommandType::PotionFormula:
+        if (const std::string *known = line(*formulas, symbols->find(name)))
+        {
+            out << *known;
+        }
+        else
+        {
+            out << "No formula for " << name << "\n";
+        }
+        break;
+    default:
+        out << "INVALID\n";
+        break;
+    }
+}
+
+/**
+ * @brief Gets the count of an ingredient.
+ *
+ * @param name The name of the ingredient.
+ * @return The count at the epoch of the view, or 0 if there was none.
+ */
+int InventoryView::ingredient_count(std::string_view name) const
+{
+    return count(*ingredients, symbols->find(name));
+}
+
+/**
+ * @brief Gets the count of a potion.
+ *
+ * @param name The name of the potion.
+ * @return The count at the epoch of the view, or 0 if there was none.
+ */
+int InventoryView::potion_count(std::string_view name) const
+{
+    return count(*potions, symbols->find(name));
+}
+
+/**
+ * @brief Gets the count of a trophy.
+ *
+ * @param name The name of the monster the trophy is from.
+ * @return The count at the epoch of the view, or 0 if there was none.
+ */
+int InventoryView::trophy_count(std::string_view name) const
+{
+    return count(*trophies, symbols->find(name));
+}
+
+/**
+ * @brief Gets the epoch of the view.
+ * @return The number of lines the session had executed when the view was published.
+ */
+uint64_t InventoryView::epoch() const
+{
+    return lines;
+}
+
+/**
+ * @brief Gets a count from a counts part.
+ *
+ * @param counts The part.
+ * @param id The id, or SymbolTable::none.
+ * @return The count, 0 for ids the part doesn't hold.
+ */
+int InventoryView::count(const Counts &counts, Id id)
+{
+    return id == SymbolTable::none ? 0 : counts.by_id.get(id);
+}
+
+/**
+ * @brief Gets an answer line from a lines part.
+ *
+ * @param lines The part.
+ * @param id The id, or SymbolTable::none.
+ * @return The answer, or null if the part holds none for the id.
+ */
+const std::string *InventoryView::line(const Lines &lines, Id id)
+{
+    return id == SymbolTable::none ? nullptr : lines.get(id).get();
+}
+
+/**
+ * @brief Writes a totals answer from the segments of a counts part.
+ *
+ * @param counts The part.
+ * @param out Where the answer is written.
+ */
+void InventoryView::write_totals(const Counts &counts, OutputSink &out)
+{
+    if (counts.totals.empty())
+    {
+        out << "None\n";
+        return;
+    }
+    bool first = true;
+    for (const std::shared_ptr<const TotalsCache::Run> &run : counts.totals)
+    {
+        for (const std::shared_ptr<const std::string> &segment : *run)
+        {
+            if (!first)
+            {
+                out << ", ";
+            }
+            out << *segment;
+            first = false;
+        }
+    }
+    out << "\n";
+}
+
+/**
+ * @brief Names the next id, as the symbol table of the inventory did.
+ *
+ * The table is kept at most half full; when a name would fill it past that, it is built again at
+ * twice the size.
+ *
+ * @param name The name of the id, the one after the last named.
+ */
+void InventoryView::Names::add(const std::string &name)
+{
+    Id id = (Id)size++;
+    by_id.set(id, std::make_shared<const std::string>(name));
+    if (size * 2 <= slot_count)
+    {
+        insert(id);
+        return;
+    }
+    slot_count = slot_count == 0 ? 64 : slot_count * 2;
+    slots = PagedArray<Id>();
+    for (Id named = 0; named < size; ++named)
+    {
+        insert(named);
+    }
+}
+
+/**
+ * @brief Puts an id into the first free slot of its probe sequence.
+ *
+ * @param id A named id that is not in the table.
+ */
+void InventoryView::Names::insert(Id id)
+{
+    size_t mask = slot_count - 1;
+    size_t i = SymbolTable::hash(*by_id.get(id)) & mask;
+    while (slots.get(i) != 0)
+    {
+        i = (i + 1) & mask;
+    }
+    slots.set(i, id + 1);
+}
+
+/**
+ * @brief Gets the id of a name.
+ *
+ * @param name The name to look for.
+ * @return The id of the name, or SymbolTable::none if it had no id when the view was published.
+ */
+Id InventoryView::Names::find(std::string_view name) const
+{
+    if (slot_count == 0)
+    {
+        return SymbolTable::none;
+    }
+    size_t mask = slot_count - 1;
+    for (size_t i = SymbolTable::hash(name) & mask;; i = (i + 1) & mask)
+    {
+        Id slot = slots.get(i);
+        if (slot == 0)
+        {
+            return SymbolTable::none;
+        }
+        if (*by_id.get(slot - 1) == name)
+        {
+            return slot - 1;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * @class InventoryView
+ * @brief An immutable copy of everything the questions about an Inventory read, for reader threads.
+ *
+ * Questions never change the inventory, so they don't have to wait for the loot, trade, brew
+ * and encounter lines executed before them. The writer publishes a view of the inventory as of
+ * some line (its epoch) with Inventory::publish, and any number of threads answer questions from
+ * it with answer, while the writer carries on executing lines that change the state. A view never
+ * changes once published, so reading it takes no lock, and it lives as long as a thread holds it.
+ *
+ * A view is made of parts: the names, the counts and rendered totals of each kind, the monster
+ * knowledge lines and the formula lines. A part that didn't change since the previous view of the
+ * same inventory is that view's part. A part that changed is a new one, but its entries are kept
+ * in PagedArrays, which share every page with the previous view's part except the pages whose
+ * entries changed, so publishing after a loot copies the pages of the looted ingredients and, in
+ * the ingredient totals, the blocks of their TotalsCache, whatever the size of the inventory.
+ * Answers are written exactly as Inventory writes them.
+ *
+ * Names are looked up in the view's own index of the names, an open-addressing table whose slots
+ * are a PagedArray, so a new name copies only the pages it touches. When the table fills up it is
+ * built again at twice the size, which copies every name's slot once, as often as the names double.
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Command.h"
+#include "OutputSink.h"
+#include "PagedArray.h"
+#include "SymbolTable.h"
+#include "TotalsCache.h"
+
+class InventoryView
+{
+public:
+    static bool answers(CommandType type);
+    void answer(const Command &command, OutputSink &out) const;
+    int ingredient_count(std::string_view name) const;
+    int potion_count(std::string_view name) const;
+    int trophy_count(std::string_view name) const;
+    uint64_t epoch() const;
+
+private:
+    friend class Inventory;
+
+    struct Names
+    {
+        PagedArray<std::shared_ptr<const std::string>> by_id; // name of every id
+        PagedArray<Id> slots;  // open-addressing table of the ids plus one, 0 for an empty slot
+        size_t size = 0;       // ids named so far
+        size_t slot_count = 0; // slots in the table, a power of two, 0 until the first name
+
+        void add(const std::string &name);
+        Id find(std::string_view name) const;
+        void insert(Id id);
+    };
+    struct Counts
+    {
+        PagedArray<int> by_id; // count of every id, 0 if absent
+        std::vector<std::shared_ptr<const TotalsCache::Run>> totals; // blocks of the totals answer, see TotalsCache
+    };
+    using Lines = PagedArray<std::shared_ptr<const std::string>>; // answer of every id, null if there is none
+
+    uint64_t lines = 0;                          // lines the inventory had executed when the view was published
+    std::shared_ptr<const Names> symbols;        // names of the ids below
+    std::shared_ptr<const Counts> ingredients;
+    std::shared_ptr<const Counts> potions;
+    std::shared_ptr<const Counts> trophies;
+    std::shared_ptr<const Lines> knowledge;      // "What is effective against <monster> ?" by monster id
+    std::shared_ptr<const Lines> formulas;       // "What is in <potion> ?" by potion id
+
+    static int count(const Counts &counts, Id id);
+    static const std::string *line(const Lines &lines, Id id);
+    static void write_totals(const Counts &counts, OutputSink &out);
+};
@@ -0,0 +1,332 @@
+/**
+ * @file Journal.cpp
+ * @brief Implements the encoding and group commit of journal records.
+ */
+
+#include "Journal.h"
+#include "MappedFile.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Commits the pending records and closes the journal file.
+ */
+Journal::~Journal()
+{
+    commit();
+    close();
+}
+
+/**
+ * @brief Closes the journal file, if one is open.
+ */
+void Journal::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/**
+ * @brief Opens a journal file for appending, creating it if it doesn't exist.
+ *
+ * A record at the end of an existing journal that a crash cut short is cut off, so new records
+ * directly follow the last complete one.
+ *
+ * @param path The journal file.
+ * @param group_size The number of records written per commit.
+ * @return false if the file can't be opened or isn't a journal of this version, true otherwise.
+ */
+bool Journal::open(const std::string &path, size_t group_size)
+{
+    commit();
+    close();
+    target = nullptr;
+    this->group_size = group_size;
+
+    size_t valid = 0;
+    {
+        MappedFile existing;
+        if (existing.open(path) && !existing.contents().empty())
+        {
+            SnapshotReader reader(existing.contents());
+            if (!read_header(reader))
+            {
+                return false;
+            }
+            std::string_view record_body;
+            while (next_record(reader, record_body))
+            {
+            }
+            valid = existing.contents().size() - reader.remaining();
+        }
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (::ftruncate(fd, valid) != 0)
+    {
+        close();
+        return false;
+    }
+    if (valid == 0)
+    {
+        SnapshotWriter writer(pending);
+        writer.raw(magic);
+        writer.u32(version);
+    }
+    return true;
+}
+
+/**
+ * @brief Makes the journal append to a string instead of a file, e.g. to replay it from memory.
+ *
+ * @param target The string the journal is appended to, starting with the header.
+ * @param group_size The number of records written per commit.
+ */
+void Journal::open_in_memory(std::string &target, size_t group_size)
+{
+    commit();
+    close();
+    this->target = &target;
+    this->group_size = group_size;
+    SnapshotWriter writer(pending);
+    writer.raw(magic);
+    writer.u32(version);
+}
+
+/**
+ * @brief Adds a record to the pending ones, framed with its length and checksum.
+ *
+ * @param record_body The encoded kind, line and fields of the record.
+ */
+void Journal::append(std::string_view record_body)
+{
+    SnapshotWriter writer(pending);
+    writer.u32((uint32_t)record_body.size());
+    writer.raw(record_body);
+    writer.u32(Snapshot::checksum(record_body));
+}
+
+/**
+ * @brief Appends a list of items as their number followed by their ids and counts.
+ *
+ * @param writer The record being encoded.
+ * @param items The items to append.
+ */
+static void write_items(SnapshotWriter &writer, const std::vector<Item> &items)
+{
+    writer.u32((uint32_t)items.size());
+    for (const Item &item : items)
+    {
+        writer.u32(item.id);
+        writer.u32((uint32_t)item.count);
+    }
+}
+
+/**
+ * @brief Appends the record of an executed command, committing if a group is complete.
+ *
+ * Names interned since the last record are appended first. Commands that don't change the
+ * state, and those naming something that was never interned, get no record.
+ *
+ * @param command The command, with its names resolved.
+ * @param symbols The table the ids of the command were interned in.
+ * @param line The number of the line the command was on.
+ */
+void Journal::record(const Command &command, const SymbolTable &symbols, uint64_t line)
+{
+    if (fd < 0 && target == nullptr)
+    {
+        return;
+    }
+    last_line = line;
+
+    SnapshotWriter writer(body);
+    for (; journaled_symbols < symbols.size(); ++journaled_symbols)
+    {
+        body.clear();
+        writer.u32(Symbol);
+        writer.u64(line);
+        writer.u32((uint32_t)journaled_symbols);
+        writer.text(symbols.name((Id)journaled_symbols));
+        append(body);
+    }
+
+    body.clear();
+    switch (command.type)
+    {
+    case CommandType::Loot:
+        writer.u32(Loot);
+        writer.u64(line);
+        write_items(writer, command.loot.ingredients);
+        break;
+    case CommandType::Trade:
+        for (const Item &item : command.trade.trophies)
+        {
+            if (item.id == SymbolTable::none)
+            {
+                return;
+            }
+        }
+        writer.u32(Trade);
+        writer.u64(line);
+        write_items(writer, command.trade.trophies);
+        write_items(writer, command.trade.ingredients);
+        break;
+    case CommandType::Brew:
+    case CommandType::BrewBatch:
+        if (command.brew.potion_id == SymbolTable::none)
+        {
+            return;
+        }
+        writer.u32(command.type == CommandType::Brew ? Brew : BrewBatch);
+        writer.u64(line);
+        writer.u32(command.brew.potion_id);
+        writer.u32((uint32_t)command.brew.count);
+        break;
+    case CommandType::SignKnowledge:
+        writer.u32(SignKnowledge);
+        writer.u64(line);
+        writer.u32(command.sign_knowledge.sign_id);
+        writer.u32(command.sign_knowledge.monster_id);
+        break;
+    case CommandType::PotionKnowledge:
+        writer.u32(PotionKnowledge);
+        writer.u64(line);
+        writer.u32(command.potion_knowledge.potion_id);
+        writer.u32(command.potion_knowledge.monster_id);
+        break;
+    case CommandType::PotionRecipe:
+        writer.u32(PotionRecipe);
+        writer.u64(line);
+        writer.u32(command.potion_recipe.potion_id);
+        write_items(writer, command.potion_recipe.ingredients);
+        break;
+    case CommandType::Encounter:
+        if (command.encounter.monster_id == SymbolTable::none)
+        {
+            return;
+        }
+        writer.u32(Encounter);
+        writer.u64(line);
+        writer.u32(command.encounter.monster_id);
+        break;
+    default:
+        return;
+    }
+    append(body);
+    record_count++;
+
+    if (++pending_records >= group_size)
+    {
+        commit();
+    }
+}
+
+/**
+ * @brief Writes the pending records, followed by a progress record, and makes them durable.
+ *
+ * All records go out in one write and a file journal is synchronized once, whatever the number
+ * of records.
+ *
+ * @return false if writing or synchronizing the file failed, true otherwise.
+ */
+bool Journal::commit()
+{
+    if (pending.empty())
+    {
+        return true;
+    }
+    body.clear();
+    SnapshotWriter writer(body);
+    writer.u32(Progress);
+    writer.u64(last_line);
+    append(body);
+    pending_records = 0;
+
+    if (target != nullptr)
+    {
+        target->append(pending);
+        pending.clear();
+        return true;
+    }
+    if (fd < 0)
+    {
+        pending.clear();
+        return false;
+    }
+
+    const char *data = pending.data();
+    size_t left = pending.size();
+    while (left > 0)
+    {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            pending.clear();
+            return false;
+        }
+        data += written;
+        left -= written;
+    }
+    pending.clear();
+    return ::fdatasync(fd) == 0;
+}
+
+/**
+ * @brief Gets the number of command records appended.
+ * @return The number of records since the journal was opened.
+ */
+uint64_t Journal::records() const
+{
+    return record_count;
+}
+
+/**
+ * @brief Reads and checks the header at the start of a journal.
+ *
+ * @param reader The journal being read, positioned at its start.
+ * @return true if the journal has the magic and version of this format, false otherwise.
+ */
+bool Journal::read_header(SnapshotReader &reader)
+{
+    std::string_view read_magic;
+    uint32_t read_version = 0;
+    return reader.raw(magic.size(), read_magic) && read_magic == magic && reader.u32(read_version) &&
+           read_version == version;
+}
+
+/**
+ * @brief Reads the next complete record of a journal.
+ *
+ * @param reader The journal being read, positioned at a record.
+ * @param record_body Set to the body of the record.
+ * @return false if the journal ends there or the record is incomplete or damaged, true otherwise.
+ *         The reader only moves past records that were read successfully.
+ */
+bool Journal::next_record(SnapshotReader &reader, std::string_view &record_body)
+{
+    SnapshotReader rest = reader;
+    uint32_t size = 0;
+    uint32_t stored_checksum = 0;
+    std::string_view read_body;
+    if (!rest.u32(size) || !rest.raw(size, read_body) || !rest.u32(stored_checksum) ||
+        stored_checksum != Snapshot::checksum(read_body))
+    {
+        return false;
+    }
+    reader = rest;
+    record_body = read_body;
+    return true;
+}
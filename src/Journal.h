@@ -0,0 +1,81 @@
+/**
+ * @class Journal
+ * @brief Append-only log of the state-changing commands of a session, in their parsed form.
+ *
+ * Every loot, trade, brew, learn and encounter command a session executes is appended as a
+ * binary record holding its kind, the number of its line and its ids and counts. Names are not
+ * repeated in every record: whenever the session's SymbolTable has grown, the new names are
+ * appended first as symbol records, so a replay can intern them and give them the same ids.
+ * Commands naming something that was never interned (brewing an unknown potion, trading
+ * unknown trophies, encountering an unknown monster) can't change the state and are left out.
+ *
+ * A journal starts with the magic "WTJRNL\0\0" and the format version. Each record is its
+ * length, its body and an FNV-1a checksum of the body, all encoded with SnapshotWriter. A
+ * record cut short by a crash fails its checksum, and everything from there on is ignored.
+ *
+ * Records are collected in memory and written with group commit: once group_size records are
+ * pending (or when commit is called), they are written together with a progress record holding
+ * the last line number, in a single write followed by one fdatasync. A crash therefore loses at
+ * most the last group, never part of a record.
+ *
+ * Session::replay_journal applies a journal without parsing any text.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Command.h"
+#include "Snapshot.h"
+#include "SymbolTable.h"
+
+class Journal
+{
+public:
+    static constexpr std::string_view magic{"WTJRNL\0\0", 8}; // first bytes of every journal
+    static constexpr uint32_t version = 1;                    // bumped whenever the layout changes
+    static constexpr size_t default_group_size = 256;         // records written per commit
+
+    // the kind stored at the start of every record body
+    enum Kind : uint32_t
+    {
+        Symbol,
+        Progress,
+        Loot,
+        Trade,
+        Brew,
+        BrewBatch,
+        SignKnowledge,
+        PotionKnowledge,
+        PotionRecipe,
+        Encounter
+    };
+
+    Journal() = default;
+    ~Journal();
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    bool open(const std::string &path, size_t group_size = default_group_size);
+    void open_in_memory(std::string &target, size_t group_size = default_group_size);
+    void record(const Command &command, const SymbolTable &symbols, uint64_t line);
+    bool commit();
+    uint64_t records() const;
+
+    static bool read_header(SnapshotReader &reader);
+    static bool next_record(SnapshotReader &reader, std::string_view &body);
+
+private:
+    std::string pending;            // encoded records not written yet
+    std::string body;               // reusable buffer for the record being encoded
+    size_t pending_records = 0;     // number of command records in pending
+    size_t group_size = default_group_size;
+    int fd = -1;                    // journal file, -1 when writing to a string or closed
+    std::string *target = nullptr;  // journal string, used instead of fd when not null
+    size_t journaled_symbols = 0;   // number of ids whose symbol record was appended
+    uint64_t last_line = 0;         // line of the last record, written in progress records
+    uint64_t record_count = 0;      // command records appended since the journal was opened
+
+    void append(std::string_view record_body);
+    void close();
+};
@@ -0,0 +1,186 @@
+/**
+ * @file Keywords.h
+ * @brief Compile-time perfect hash over the words that pick a grammar rule.
+ *
+ * The first two tokens of a line decide which rule it can follow: "Geralt loots", "Total potion",
+ * "What is" and so on. The parser classifies both once into a Keyword and switches on them,
+ * instead of comparing them with every candidate word in turn. The words are listed in `entries`,
+ * and a multiplicative hash over the length, first and last character of a word maps each of them
+ * to its own slot of a 64-slot table. The multiplier is searched for at compile time, and the
+ * build fails if no multiplier without collisions is found, so adding a keyword can't silently
+ * break the table.
+ *
+ * Classifying a word costs one multiplication, two table loads and an integer comparison with the
+ * key of the only keyword that can match it, so most other words are rejected without looking at
+ * their characters. The remaining tokens are still compared at their fixed positions, where a
+ * single comparison with a literal is cheaper than hashing every token of the line.
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace Utils
+{
+    /**
+     * @brief The words that can start a line or follow its first word, None for any other word.
+     */
+    enum class Keyword : uint8_t
+    {
+        None,
+        Geralt,
+        Total,
+        What,
+        Exit,
+        Loots,
+        Trades,
+        Brews,
+        Learns,
+        Encounters,
+        Ingredient,
+        Potion,
+        Trophy,
+        Is
+    };
+
+    namespace keyword_table
+    {
+        struct Entry
+        {
+            std::string_view text;
+            Keyword keyword;
+        };
+
+        inline constexpr Entry entries[] = {
+            {"Geralt", Keyword::Geralt}, {"Total", Keyword::Total}, {"What", Keyword::What},
+            {"Exit", Keyword::Exit}, {"loots", Keyword::Loots}, {"trades", Keyword::Trades},
+            {"brews", Keyword::Brews}, {"learns", Keyword::Learns}, {"encounters", Keyword::Encounters},
+            {"ingredient", Keyword::Ingredient}, {"potion", Keyword::Potion}, {"trophy", Keyword::Trophy},
+            {"is", Keyword::Is}};
+
+        constexpr int bits = 6;                 // the table has 2^bits slots
+        constexpr size_t max_length = 10;       // length of the longest keyword, "encounters" and "ingredient"
+        constexpr size_t entry_count = sizeof(entries) / sizeof(entries[0]);
+
+        /**
+         * @brief Packs the length, first and last character of a non-empty word into one integer.
+         *
+         * Every keyword differs from the others in at least one of them.
+         */
+        constexpr uint32_t key(std::string_view word)
+        {
+            return (uint32_t)word.size() | (uint32_t)(unsigned char)word.front() << 8 |
+                   (uint32_t)(unsigned char)word.back() << 16;
+        }
+
+        /**
+         * @brief Maps a non-empty word to a slot of the table.
+         */
+        constexpr uint32_t slot(std::string_view word, uint32_t multiplier)
+        {
+            return (key(word) * multiplier) >> (32 - bits);
+        }
+
+        /**
+         * @brief Checks if a multiplier puts every keyword in its own slot.
+         */
+        constexpr bool is_perfect(uint32_t multiplier)
+        {
+            bool used[1 << bits] = {};
+            for (const Entry &entry : entries)
+            {
+                uint32_t s = slot(entry.text, multiplier);
+                if (used[s])
+                {
+                    return false;
+                }
+                used[s] = true;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Finds the first odd multiplier, starting from Knuth's, without collisions.
+         * @return The multiplier, or 0 if the search gave up.
+         */
+        constexpr uint32_t find_multiplier()
+        {
+            uint32_t multiplier = 2654435761u;
+            for (int attempt = 0; attempt < 100000; ++attempt, multiplier += 2)
+            {
+                if (is_perfect(multiplier))
+                {
+                    return multiplier;
+                }
+            }
+            return 0;
+        }
+
+        constexpr uint32_t multiplier = find_multiplier();
+        static_assert(multiplier != 0, "no perfect hash found for the keywords, change key() or bits");
+
+        /**
+         * @brief Builds the table, holding the index of its keyword plus one in every used slot.
+         */
+        constexpr std::array<uint8_t, 1 << bits> build_slots()
+        {
+            std::array<uint8_t, 1 << bits> slots{};
+            for (size_t i = 0; i < entry_count; ++i)
+            {
+                slots[slot(entries[i].text, multiplier)] = (uint8_t)(i + 1);
+            }
+            return slots;
+        }
+
+        /**
+         * @brief Builds the keys of the keywords, indexed like the slots, with 0 for the empty index.
+         */
+        constexpr std::array<uint32_t, entry_count + 1> build_keys()
+        {
+            std::array<uint32_t, entry_count + 1> keys{};
+            for (size_t i = 0; i < entry_count; ++i)
+            {
+                keys[i + 1] = key(entries[i].text);
+            }
+            return keys;
+        }
+
+        inline constexpr std::array<uint8_t, 1 << bits> slots = build_slots();
+        inline constexpr std::array<uint32_t, entry_count + 1> keys = build_keys();
+    }
+
+    /**
+     * @brief Classifies a token.
+     *
+     * @param word The token.
+     * @return The keyword the token is, or Keyword::None if it isn't one.
+     */
+    constexpr Keyword classify_keyword(std::string_view word)
+    {
+        if (word.empty() || word.size() > keyword_table::max_length)
+        {
+            return Keyword::None;
+        }
+        uint32_t key = keyword_table::key(word);
+        uint8_t index = keyword_table::slots[keyword_table::slot(word, keyword_table::multiplier)];
+        if (keyword_table::keys[index] != key) // also rejects empty slots, as no word has the key 0
+        {
+            return Keyword::None;
+        }
+        // the key already matched the length and both ends, only the characters in between are left
+        const keyword_table::Entry &entry = keyword_table::entries[index - 1];
+        for (size_t i = 1; i + 1 < word.size(); ++i)
+        {
+            if (word[i] != entry.text[i])
+            {
+                return Keyword::None;
+            }
+        }
+        return entry.keyword;
+    }
+
+    static_assert(classify_keyword("Geralt") == Keyword::Geralt && classify_keyword("is") == Keyword::Is &&
+                      classify_keyword("Geralts") == Keyword::None && classify_keyword("") == Keyword::None,
+                  "keyword table is inconsistent");
+}
@@ -0,0 +1,86 @@
+/**
+ * @file LineArena.cpp
+ * @brief Implements the per-line monotonic memory resource.
+ */
+
+#include "LineArena.h"
+
+/**
+ * @brief Creates an arena whose reusable buffer is allocated on first use.
+ *
+ * @param initial_size The size of the buffer every line starts from, at least 1.
+ */
+LineArena::LineArena(size_t initial_size) : initial_size(initial_size > 0 ? initial_size : 1)
+{
+}
+
+/**
+ * @brief Releases everything allocated since the last reset.
+ *
+ * The next allocation starts at the beginning of the buffer again, and memory taken from the
+ * default resource for lines that didn't fit is given back.
+ */
+void LineArena::reset()
+{
+    if (pool)
+    {
+        pool->release();
+    }
+}
+
+/**
+ * @brief Gets the number of allocations served.
+ * @return The number of allocations since the arena was created.
+ */
+size_t LineArena::allocations() const
+{
+    return allocation_count;
+}
+
+/**
+ * @brief Gets the number of bytes served.
+ * @return The number of bytes allocated since the arena was created.
+ */
+size_t LineArena::bytes() const
+{
+    return byte_count;
+}
+
+/**
+ * @brief Allocates from the buffer, or from the default resource once the buffer is used up.
+ *
+ * The first allocation allocates the buffer.
+ *
+ * @param bytes The size of the allocation.
+ * @param alignment The alignment of the allocation.
+ * @return The allocated memory, valid until the next reset.
+ */
+void *LineArena::do_allocate(size_t bytes, size_t alignment)
+{
+    allocation_count++;
+    byte_count += bytes;
+    if (!pool)
+    {
+        buffer.resize(initial_size);
+        pool.emplace(buffer.data(), buffer.size(), std::pmr::new_delete_resource());
+    }
+    return pool->allocate(bytes, alignment);
+}
+
+/**
+ * @brief Does nothing, memory is only given back by reset.
+ */
+void LineArena::do_deallocate(void *, size_t, size_t)
+{
+}
+
+/**
+ * @brief Checks if memory from one resource can be given back to the other.
+ *
+ * @param other The resource to compare with.
+ * @return true only if other is this arena.
+ */
+bool LineArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
@@ -0,0 +1,41 @@
+/**
+ * @class LineArena
+ * @brief Monotonic memory resource for the temporaries of a single line.
+ *
+ * Containers that only live while one line is executed, such as the trophies of a trade or the
+ * names of a monster knowledge answer, allocate from this resource through std::pmr. Allocation
+ * is a pointer bump into a buffer that is reused for every line, and deallocation does nothing.
+ * Session resets the arena before each line, which makes the whole buffer available again.
+ *
+ * Lines whose temporaries don't fit in the buffer get more memory from the default resource
+ * until the next reset. The arena counts how much it served, so benchmarks can report it.
+ *
+ * The buffer is only allocated by the first allocation, so an arena that never serves a line,
+ * like that of an idle world in the server, costs no memory beyond the object.
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+class LineArena : public std::pmr::memory_resource
+{
+public:
+    explicit LineArena(size_t initial_size = 16 * 1024);
+    void reset();
+    size_t allocations() const;
+    size_t bytes() const;
+
+private:
+    size_t initial_size;                    // size of buffer once it is allocated
+    std::vector<std::byte> buffer;          // memory every line starts from, empty until the first allocation
+    std::optional<std::pmr::monotonic_buffer_resource> pool; // bump allocator over buffer, made with it
+    size_t allocation_count = 0;            // allocations served since construction
+    size_t byte_count = 0;                  // bytes served since construction
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
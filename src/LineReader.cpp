@@ -0,0 +1,67 @@
+/**
+ * @file LineReader.cpp
+ * @brief Implements the newline scanner behind the --input batch mode.
+ */
+
+#include "LineReader.h"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Creates a reader positioned at the start of a range.
+ *
+ * @param text The bytes to split. They have to outlive the reader and the lines it returns.
+ */
+LineReader::LineReader(std::string_view text) : position(text.data()), end(text.data() + text.size())
+{
+}
+
+/**
+ * @brief Gets the next line terminated by '\n'.
+ *
+ * @param line Set to the line, without its '\n', if there is one.
+ * @return false once no terminated line is left, the point where getline would report EOF.
+ */
+bool LineReader::next(std::string_view &line)
+{
+    const char *newline = find_newline(position, end);
+    if (newline == end)
+    {
+        return false;
+    }
+    line = std::string_view(position, newline - position);
+    position = newline + 1;
+    return true;
+}
+
+/**
+ * @brief Finds the first '\n' in a range of bytes.
+ *
+ * @param first The start of the range.
+ * @param last The end of the range.
+ * @return A pointer to the first '\n', or last if there is none.
+ */
+const char *LineReader::find_newline(const char *first, const char *last)
+{
+#if defined(__SSE2__)
+    const __m128i newlines = _mm_set1_epi8('\n');
+    while (last - first >= 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines));
+        if (mask != 0)
+        {
+            return first + __builtin_ctz(mask);
+        }
+        first += 16;
+    }
+#endif
+    if (first == last)
+    {
+        return last;
+    }
+    const void *found = std::memchr(first, '\n', last - first);
+    return found != nullptr ? static_cast<const char *>(found) : last;
+}
@@ -0,0 +1,28 @@
+/**
+ * @class LineReader
+ * @brief Splits a range of bytes into lines without copying them.
+ *
+ * Lines are returned as views into the range, without their '\n'. The reader follows the
+ * semantics of the interactive loop in main.cpp, which reads with std::getline and stops as soon
+ * as the stream reports EOF: only lines terminated by '\n' are returned, and trailing bytes
+ * after the last '\n' are never executed. Like getline, '\r' and every other byte is kept.
+ *
+ * Line boundaries are found by find_newline, which compares 16 bytes at a time with SSE2 where
+ * it is available and falls back to memchr otherwise.
+ */
+
+#pragma once
+#include <string_view>
+
+class LineReader
+{
+public:
+    explicit LineReader(std::string_view text);
+    bool next(std::string_view &line);
+
+    static const char *find_newline(const char *first, const char *last);
+
+private:
+    const char *position; // start of the next line
+    const char *end;      // end of the range
+};
@@ -0,0 +1,79 @@
+/**
+ * @file MappedFile.cpp
+ * @brief Implements the read-only file mapping used by the --input batch mode.
+ */
+
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Unmaps the file, if one is mapped.
+ */
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+/**
+ * @brief Maps a file, replacing the previously mapped one.
+ *
+ * @param path The file to map.
+ * @return true if the file could be opened and mapped, false otherwise.
+ */
+bool MappedFile::open(const std::string &path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    // a zero-length mapping is not allowed, an empty file just has no contents
+    if (info.st_size > 0)
+    {
+        void *mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            ::close(fd);
+            return false;
+        }
+        // the file is read from start to end exactly once
+        ::madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(mapping);
+        size = info.st_size;
+    }
+    // the mapping stays valid after its descriptor is closed
+    ::close(fd);
+    return true;
+}
+
+/**
+ * @brief Gets the bytes of the mapped file.
+ * @return A view of the whole file, empty if the file is empty or nothing is mapped.
+ */
+std::string_view MappedFile::contents() const
+{
+    return std::string_view(data, size);
+}
+
+/**
+ * @brief Unmaps the file, if one is mapped.
+ */
+void MappedFile::close()
+{
+    if (data != nullptr)
+    {
+        ::munmap(const_cast<char *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
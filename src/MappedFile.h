@@ -0,0 +1,31 @@
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The file is mapped when it is opened and unmapped when the object is destroyed, so its
+ * contents can be read as one contiguous range of bytes without copying them into a buffer.
+ * An empty file opens successfully and has no bytes.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    std::string_view contents() const;
+
+private:
+    const char *data = nullptr; // start of the mapping, null if nothing is mapped
+    size_t size = 0;            // length of the file in bytes
+
+    void close();
+};
@@ -11,41 +11,89 @@
 #include "Inventory.h"
 #include "Utils.h"
 #include <string>
-#include <map>
-#include <set>
 
 /**
- * @brief Get the set of effective signs against the monster.
- * @return A set containing the names of known effective signs.
+ * @brief Get the sorted list of effective signs against the monster.
+ * @return A reference to the ascending ids of known effective signs.
  */
-std::set<std::string> Monster::get_signs()
+const Monster::Ids &Monster::get_signs() const
 {
     return signs_against;
 }
 
 /**
- * @brief Get the set of effective potions against the monster.
- * @return A set containing the names of known effective potions.
+ * @brief Get the sorted list of effective potions against the monster.
+ * @return A reference to the ascending ids of known effective potions.
  */
-std::set<std::string> Monster::get_potions()
+const Monster::Ids &Monster::get_potions() const
 {
     return potions_against;
 }
 
 /**
  * @brief Add a sign to the monster's known weaknesses.
- * @param sign The sign name to add.
+ * @param sign The id of the sign to add.
+ * @return true if the sign was new, false if it was already known.
  */
-void Monster::add_sign(std::string sign)
+bool Monster::add_sign(Id sign)
 {
-    signs_against.insert(sign);
+    bool added = signs_against.insert_sorted(sign);
+    knowledge_valid = knowledge_valid && !added;
+    return added;
 }
 
 /**
  * @brief Add a potion to the monster's known weaknesses.
- * @param potion The potion name to add.
+ * @param potion The id of the potion to add.
+ * @return true if the potion was new, false if it was already known.
  */
-void Monster::add_potion(std::string potion)
+bool Monster::add_potion(Id potion)
 {
-    potions_against.insert(potion);
+    bool added = potions_against.insert_sorted(potion);
+    knowledge_valid = knowledge_valid && !added;
+    return added;
+}
+
+/**
+ * @brief Get the response to a monster knowledge question.
+ *
+ * Signs and potions are listed in one alphabetical, comma-separated list, followed by a newline.
+ * The line is built on the first call after the knowledge changed and reused until it changes again.
+ *
+ * @param symbols The table the sign and potion ids were interned in.
+ * @param scratch The resource the names are sorted in while the line is built.
+ * @return A reference to the formatted line, valid until a sign or potion is added.
+ */
+const std::string &Monster::get_knowledge_line(const SymbolTable &symbols, std::pmr::memory_resource *scratch) const
+{
+    if (knowledge_valid)
+    {
+        return knowledge_line;
+    }
+
+    // both signs and potions are printed in one alphabetical list
+    std::pmr::vector<std::string_view> merged(scratch);
+    merged.reserve(signs_against.size() + potions_against.size());
+    for (Id sign : signs_against)
+    {
+        merged.push_back(symbols.name(sign));
+    }
+    for (Id potion : potions_against)
+    {
+        merged.push_back(symbols.name(potion));
+    }
+    std::sort(merged.begin(), merged.end());
+
+    knowledge_line.clear();
+    for (size_t i = 0; i < merged.size(); ++i)
+    {
+        knowledge_line += merged[i];
+        if (i < merged.size() - 1)
+        {
+            knowledge_line += ", ";
+        }
+    }
+    knowledge_line += "\n";
+    knowledge_valid = true;
+    return knowledge_line;
 }
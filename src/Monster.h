@@ -6,28 +6,44 @@
  * including their weaknesses to signs and potions. It provides methods
  * to add and retrieve this information.
  *
+ * Signs and potions are stored as ids interned in the session's SymbolTable, each kind in an
+ * ascending SmallVector without duplicates, so a monster with a few weaknesses keeps them inside
+ * the object instead of in a tree node per id.
+ *
  * Data encapsulation is used to prevent direct access to internal data. All
- * modifications or retrievals are done through public getter and setters.
+ * modifications or retrievals are done through public getter and setters. Getters return
+ * const references, so reading the bestiary never copies the lists.
+ *
+ * The response to "What is effective against <monster> ?" is built the first time it is asked
+ * for and kept until a new sign or potion is learned, so repeated questions reuse the same string.
  *
  * @note This class assumes that all input data is valid and well-formed.
  */
 
 #pragma once
-#include <map>
-#include <set>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <iostream>
 #include <algorithm>
+#include "SmallVector.h"
+#include "SymbolTable.h"
 
 class Monster
 {
+public:
+    using Ids = SmallVector<Id, 4>; // ascending ids without duplicates, the first four in place
+
 private:
-    std::set<std::string> signs_against;   // a set to keep track of signs can be used to defend the monster
-    std::set<std::string> potions_against; // a set to keep track of potions can be used to defend the monster
+    Ids signs_against;   // a sorted list to keep track of signs can be used to defend the monster
+    Ids potions_against; // a sorted list to keep track of potions can be used to defend the monster
+    mutable std::string knowledge_line; // formatted response listing signs and potions, valid if knowledge_valid
+    mutable bool knowledge_valid = false;
 public:
-    std::set<std::string> get_signs();
-    std::set<std::string> get_potions();
-    void add_sign(std::string sign);
-    void add_potion(std::string potion);
+    const Ids &get_signs() const;
+    const Ids &get_potions() const;
+    bool add_sign(Id sign);
+    bool add_potion(Id potion);
+    const std::string &get_knowledge_line(const SymbolTable &symbols,
+                                          std::pmr::memory_resource *scratch = std::pmr::get_default_resource()) const;
 };
\ No newline at end of file
@@ -0,0 +1,165 @@
+/**
+ * @file OutputSink.cpp
+ * @brief Implements the buffered response writer.
+ */
+
+#include "OutputSink.h"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <unistd.h>
+
+/**
+ * @brief Creates a sink writing to a file descriptor.
+ *
+ * @param fd The descriptor to write to, e.g. 1 for the standard output. It is not closed by the sink.
+ * @param capacity The size of the buffer.
+ */
+OutputSink::OutputSink(int fd, size_t capacity) : buffer(capacity), fd(fd)
+{
+}
+
+/**
+ * @brief Creates a sink appending to a string.
+ *
+ * @param target The string the output is appended to when the sink is flushed.
+ * @param capacity The size of the buffer.
+ */
+OutputSink::OutputSink(std::string &target, size_t capacity) : buffer(capacity), target(&target)
+{
+}
+
+/**
+ * @brief Flushes the pending output.
+ */
+OutputSink::~OutputSink()
+{
+    flush();
+}
+
+/**
+ * @brief Appends text to the buffer, flushing first if it does not fit.
+ *
+ * Text longer than the whole buffer is written straight through after the pending output.
+ *
+ * @param text The text to append.
+ * @return This sink.
+ */
+OutputSink &OutputSink::operator<<(std::string_view text)
+{
+    if (used + text.size() > buffer.size())
+    {
+        flush();
+        if (text.size() > buffer.size())
+        {
+            write_through(text.data(), text.size());
+            return *this;
+        }
+    }
+    std::memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
+    return *this;
+}
+
+/**
+ * @brief Appends a null-terminated string to the buffer.
+ *
+ * @param text The text to append.
+ * @return This sink.
+ */
+OutputSink &OutputSink::operator<<(const char *text)
+{
+    return *this << std::string_view(text);
+}
+
+/**
+ * @brief Appends a single character to the buffer.
+ *
+ * @param c The character to append.
+ * @return This sink.
+ */
+OutputSink &OutputSink::operator<<(char c)
+{
+    if (used == buffer.size())
+    {
+        flush();
+    }
+    buffer[used++] = c;
+    return *this;
+}
+
+/**
+ * @brief Appends the decimal form of an integer to the buffer.
+ *
+ * @param value The integer to append.
+ * @return This sink.
+ */
+OutputSink &OutputSink::operator<<(int value)
+{
+    char digits[16];
+    char *end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    return *this << std::string_view(digits, end - digits);
+}
+
+/**
+ * @brief Writes the pending output to the target and empties the buffer.
+ */
+void OutputSink::flush()
+{
+    if (used == 0)
+    {
+        return;
+    }
+    write_through(buffer.data(), used);
+    used = 0;
+}
+
+/**
+ * @brief Starts or stops dropping the output.
+ *
+ * The pending output is flushed first, so it is written or dropped according to the setting it
+ * was produced under.
+ *
+ * @param muted true to drop the output from now on, false to write it again.
+ */
+void OutputSink::set_muted(bool muted)
+{
+    flush();
+    this->muted = muted;
+}
+
+/**
+ * @brief Writes bytes to the target without buffering them.
+ *
+ * Write errors on a descriptor, e.g. a closed pipe, drop the bytes, the same way a failed
+ * std::ostream silently discards what is written to it.
+ *
+ * @param data The bytes to write.
+ * @param size The number of bytes to write.
+ */
+void OutputSink::write_through(const char *data, size_t size)
+{
+    if (muted)
+    {
+        return;
+    }
+    if (target != nullptr)
+    {
+        target->append(data, size);
+        return;
+    }
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            break;
+        }
+        data += written;
+        size -= written;
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ * @class OutputSink
+ * @brief Buffered writer every response of a session goes through.
+ *
+ * Responses are appended to a large buffer that is reused for the whole session and written to
+ * its target in bulk: a file descriptor, with one write call per flush, or a string, which is
+ * how the output of a session can be captured in memory. The buffer is flushed when it fills
+ * up, when flush is called and when the sink is destroyed.
+ *
+ * The interactive loop flushes before every prompt, so a user always sees the response to a
+ * line before typing the next one. Batch runs only flush when the buffer is full.
+ *
+ * The `<<` operators accept the same kinds of values the inventory used to write to a
+ * std::ostream: strings, characters and integers.
+ *
+ * A muted sink drops its output when it is flushed, e.g. while a journal is replayed to recover
+ * a state whose responses were already written. Writes themselves don't check the flag.
+ */
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+class OutputSink
+{
+public:
+    explicit OutputSink(int fd, size_t capacity = 1 << 16);
+    explicit OutputSink(std::string &target, size_t capacity = 1 << 16);
+    ~OutputSink();
+    OutputSink(const OutputSink &) = delete;
+    OutputSink &operator=(const OutputSink &) = delete;
+
+    OutputSink &operator<<(std::string_view text);
+    OutputSink &operator<<(const char *text);
+    OutputSink &operator<<(char c);
+    OutputSink &operator<<(int value);
+    void flush();
+    void set_muted(bool muted);
+
+private:
+    std::vector<char> buffer; // pending output, never longer than its capacity
+    size_t used = 0;          // number of pending bytes at the start of buffer
+    int fd = -1;              // target file descriptor, -1 when writing to a string
+    std::string *target = nullptr; // target string, used instead of fd when not null
+    bool muted = false;       // true if flushed output is dropped instead of written
+
+    void write_through(const char *data, size_t size);
+};
@@ -0,0 +1,102 @@
+/**
+ * @class PagedArray
+ * @brief An array indexed by id whose copies share their pages until one of them changes a page.
+ *
+ * The entries are kept in pages of page_size entries, and the pages in directories of
+ * directory_size pages, so an array is a short list of directories. Copying an array copies
+ * that list only, one pointer per directory_size * page_size entries, and the copy shares every
+ * page with the original. set copies the directory and the page it writes to first, unless this
+ * array is the only one holding them, so a change never shows in another copy: an array can be
+ * copied into a published InventoryView, where reader threads read it, while the writer goes on
+ * setting entries in its own copy, and each publish copies only the pages set since the previous
+ * one.
+ *
+ * Entries that were never set read as a value-initialized T, and so do pages and directories that
+ * were never made, so the array needs no size: an id past everything set reads as T().
+ *
+ * A page or directory is only changed in place when its use count says that no other array holds
+ * it. No other array can take it then, as arrays only take pages by copying another array, and
+ * the acquire fence after the check orders the change after the reads of the last thread that let
+ * go of it.
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+template <typename T>
+class PagedArray
+{
+public:
+    static constexpr size_t page_size = 256;      // entries per page
+    static constexpr size_t directory_size = 256; // pages per directory
+
+    /**
+     * @brief Gets an entry.
+     *
+     * @param index The index of the entry.
+     * @return The entry, or a value-initialized T if it was never set.
+     */
+    const T &get(size_t index) const
+    {
+        static const T unset{};
+        size_t d = index / (page_size * directory_size);
+        if (d >= directories.size() || directories[d] == nullptr)
+        {
+            return unset;
+        }
+        const std::shared_ptr<Page> &page = (*directories[d])[index / page_size % directory_size];
+        return page == nullptr ? unset : (*page)[index % page_size];
+    }
+
+    /**
+     * @brief Sets an entry, after copying its page and directory if another array shares them.
+     *
+     * @param index The index of the entry.
+     * @param value The new value.
+     */
+    void set(size_t index, const T &value)
+    {
+        size_t d = index / (page_size * directory_size);
+        if (d >= directories.size())
+        {
+            directories.resize(d + 1);
+        }
+        Directory &directory = own(directories[d]);
+        Page &page = own(directory[index / page_size % directory_size]);
+        page[index % page_size] = value;
+    }
+
+private:
+    using Page = std::array<T, page_size>;
+    using Directory = std::array<std::shared_ptr<Page>, directory_size>;
+
+    std::vector<std::shared_ptr<Directory>> directories; // null for directories never set
+
+    /**
+     * @brief Makes a page or directory this array may change, copying it if it is shared.
+     *
+     * @param block The pointer to the page or directory, replaced by a copy if another array holds it.
+     * @return The page or directory, held by this array only.
+     */
+    template <typename Block>
+    static Block &own(std::shared_ptr<Block> &block)
+    {
+        if (block == nullptr)
+        {
+            block = std::make_shared<Block>();
+        }
+        else if (block.use_count() > 1)
+        {
+            block = std::make_shared<Block>(*block);
+        }
+        else
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *block;
+    }
+};
@@ -0,0 +1,219 @@
+/**
+ * @file Pipeline.cpp
+ * @brief Implements the split, parse, apply and write stages of the pipelined execution.
+ */
+
+#include "Pipeline.h"
+#include "LineReader.h"
+#include "Utils.h"
+#include <thread>
+
+/**
+ * @brief Creates a pipeline around a session.
+ *
+ * @param session The session the lines are executed in.
+ * @param staging The sink the session was created with.
+ * @param staged The string staging writes to.
+ * @param destination The sink the responses end up in, written only by the writer thread.
+ * @param parsers The number of parser threads, at least 1.
+ * @param batch_lines The maximum number of lines per batch, at least 1.
+ */
+Pipeline::Pipeline(Session &session, OutputSink &staging, std::string &staged, OutputSink &destination, int parsers,
+                   size_t batch_lines)
+    : session(session), staging(staging), staged(staged), destination(destination), parsers(parsers),
+      batch_lines(batch_lines), pool(4 * parsers + 4), free_batches(pool.size()), to_write(pool.size())
+{
+    for (int p = 0; p < parsers; ++p)
+    {
+        to_parse.push_back(std::make_unique<SpscRing<Batch *>>(pool.size()));
+        parsed.push_back(std::make_unique<SpscRing<Batch *>>(pool.size()));
+    }
+}
+
+/**
+ * @brief Points a potion name the parser joined in its own buffer to a copy owned by the batch.
+ *
+ * Names that are views into the line are left alone, the line outlives the batch. That is every name
+ * but a potion name whose words the line separates by other whitespace than one space.
+ *
+ * @param command The parsed command.
+ * @param line The line it was parsed from.
+ * @param storage The string of the batch that keeps the joined name of this command.
+ */
+static void keep_joined_name(Command &command, std::string_view line, std::string &storage)
+{
+    std::string_view *name = nullptr;
+    switch (command.type)
+    {
+    case CommandType::Brew:
+    case CommandType::BrewBatch:
+        name = &command.brew.potion;
+        break;
+    case CommandType::PotionKnowledge:
+        name = &command.potion_knowledge.potion;
+        break;
+    case CommandType::PotionRecipe:
+        name = &command.potion_recipe.potion;
+        break;
+    case CommandType::PotionCount:
+    case CommandType::PotionFormula:
+        name = &command.query.name;
+        break;
+    default:
+        return;
+    }
+    if (name->data() >= line.data() && name->data() + name->size() <= line.data() + line.size())
+    {
+        return;
+    }
+    storage.assign(*name);
+    *name = storage;
+}
+
+/**
+ * @brief Executes every line of an input through the pipeline and returns once all responses are written.
+ *
+ * The calling thread splits the input into batches while the other stages run on their own threads.
+ *
+ * @param input The lines to execute, each ending in '\n'.
+ * @param skip The number of lines at the start that a restored snapshot or journal already covers.
+ */
+void Pipeline::run(std::string_view input, uint64_t skip)
+{
+    stopped.store(false);
+    session.defer_auto_snapshots(true);
+    for (Batch &batch : pool)
+    {
+        Batch *free_batch = &batch;
+        free_batches.try_push(free_batch);
+    }
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < parsers; ++p)
+    {
+        threads.emplace_back(&Pipeline::parse_batches, this, p);
+    }
+    threads.emplace_back(&Pipeline::apply_batches, this);
+    threads.emplace_back(&Pipeline::write_batches, this);
+
+    LineReader reader(input);
+    std::string_view line;
+    size_t index = 0;
+    bool done = false;
+    while (!done)
+    {
+        Batch *batch = free_batches.pop();
+        batch->lines.clear();
+        while (batch->lines.size() < batch_lines)
+        {
+            // once an exit command ran, the remaining lines are not even read
+            if (stopped.load(std::memory_order_relaxed) || !reader.next(line) || line == "Exit")
+            {
+                done = true;
+                break;
+            }
+            if (skip > 0)
+            {
+                skip--;
+                continue;
+            }
+            batch->lines.push_back(line);
+        }
+        batch->last = done;
+        to_parse[index++ % parsers]->push(batch);
+    }
+    for (int p = 0; p < parsers; ++p)
+    {
+        to_parse[p]->push(nullptr);
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    session.defer_auto_snapshots(false);
+}
+
+/**
+ * @brief Parser stage: parses the batches of one parser until the splitter is done.
+ *
+ * @param parser The index of the parser.
+ */
+void Pipeline::parse_batches(int parser)
+{
+    Utils::Parser line_parser;
+    while (Batch *batch = to_parse[parser]->pop())
+    {
+        size_t count = batch->lines.size();
+        if (batch->commands.size() < count)
+        {
+            batch->commands.resize(count);
+            batch->names.resize(count);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            // swapping hands the parser the old command of the slot, so both keep their capacity
+            std::swap(batch->commands[i], line_parser.parse(batch->lines[i]));
+            keep_joined_name(batch->commands[i], batch->lines[i], batch->names[i]);
+        }
+        parsed[parser]->push(batch);
+    }
+}
+
+/**
+ * @brief Applier stage: executes the parsed batches in the order of the input.
+ *
+ * After an exit command the remaining batches are still taken, so no other stage waits forever,
+ * but their commands are not executed.
+ */
+void Pipeline::apply_batches()
+{
+    size_t index = 0;
+    bool running = true;
+    while (true)
+    {
+        Batch *batch = parsed[index++ % parsers]->pop();
+        for (size_t i = 0; running && i < batch->lines.size(); ++i)
+        {
+            if (!session.execute(batch->commands[i]))
+            {
+                running = false;
+                stopped.store(true, std::memory_order_relaxed);
+            }
+        }
+        staging.flush();
+        batch->output.swap(staged);
+        staged.clear();
+        batch->has_snapshot = session.take_auto_snapshot(batch->snapshot);
+
+        bool last = batch->last;
+        to_write.push(batch);
+        if (last)
+        {
+            break;
+        }
+    }
+    to_write.push(nullptr);
+}
+
+/**
+ * @brief Writer stage: writes the responses of every executed batch and recycles the batch.
+ *
+ * The auto-snapshot taken with a batch is written right after its responses were flushed.
+ */
+void Pipeline::write_batches()
+{
+    while (Batch *batch = to_write.pop())
+    {
+        destination << batch->output;
+        batch->output.clear();
+        if (batch->has_snapshot)
+        {
+            // the responses of every line the snapshot covers are out before it claims them
+            destination.flush();
+            session.write_auto_snapshot(batch->snapshot);
+        }
+        free_batches.push(batch);
+    }
+    destination.flush();
+}
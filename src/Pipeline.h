@@ -0,0 +1,77 @@
+/**
+ * @class Pipeline
+ * @brief Executes the lines of an input on several threads, with parsing ahead of execution.
+ *
+ * Parsing a line depends only on the line, while executing it depends on every line before it.
+ * The pipeline therefore splits the work into stages connected by SpscRing queues:
+ *
+ * - the calling thread splits the input into batches of lines;
+ * - a pool of parser threads turns every line of a batch into a Command, batch i going to
+ *   parser i % parsers, each with its own Utils::Parser;
+ * - one applier thread takes the batches back in their original order, by visiting the parsers
+ *   round robin, and executes their commands in the session;
+ * - one writer thread writes the responses of each batch to the destination sink.
+ *
+ * Every queue has exactly one producer and one consumer, so none of them needs a lock. Batches
+ * come from a fixed pool and return to the splitter once written, which bounds the memory in
+ * flight and keeps the vectors and strings of each batch allocated from one use to the next.
+ *
+ * Lines are views into the input, which must stay alive until run returns. A potion name the
+ * parser had to join is copied into the batch, since the parser reuses its buffer for the next
+ * line. An auto-snapshot of the session is deferred while the pipeline runs: the applier takes
+ * it with the batch it fell in, and the writer writes it only after the responses of that batch,
+ * so a snapshot never claims lines whose responses are not out yet. The input ends at the first
+ * line that is exactly "Exit", at an exit command, or at its last '\n', just like the --input
+ * loop.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Command.h"
+#include "OutputSink.h"
+#include "Session.h"
+#include "SpscRing.h"
+
+class Pipeline
+{
+public:
+    static constexpr size_t default_batch_lines = 256; // lines handed between stages at once
+
+    Pipeline(Session &session, OutputSink &staging, std::string &staged, OutputSink &destination, int parsers,
+             size_t batch_lines = default_batch_lines);
+    void run(std::string_view input, uint64_t skip = 0);
+
+private:
+    struct Batch
+    {
+        std::vector<std::string_view> lines; // the lines of the batch, views into the input
+        std::vector<Command> commands;       // commands[i] is the parsed form of lines[i]
+        std::vector<std::string> names;      // joined potion name of commands[i], if it has one
+        std::string output;                  // responses of the batch, once executed
+        std::string snapshot;                // deferred auto-snapshot taken after the batch, if has_snapshot
+        bool has_snapshot = false;           // true if snapshot must be written once output is out
+        bool last = false;                   // true for the batch the input ends with
+    };
+
+    Session &session;         // the session the commands are executed in
+    OutputSink &staging;      // the sink the session writes to
+    std::string &staged;      // the string staging writes to, taken by each batch once executed
+    OutputSink &destination;  // where the writer thread writes the responses
+    int parsers;              // number of parser threads
+    size_t batch_lines;       // maximum number of lines per batch
+    std::vector<Batch> pool;  // every batch, passed between the stages by pointer
+    SpscRing<Batch *> free_batches;                // written batches, back to the splitter
+    std::vector<std::unique_ptr<SpscRing<Batch *>>> to_parse; // to_parse[p] feeds parser p
+    std::vector<std::unique_ptr<SpscRing<Batch *>>> parsed;   // parsed[p] holds the batches parser p finished
+    SpscRing<Batch *> to_write;                    // executed batches, for the writer
+    std::atomic<bool> stopped{false};              // set by the applier once an exit command ran
+
+    void parse_batches(int parser);
+    void apply_batches();
+    void write_batches();
+};
@@ -3,13 +3,12 @@
  * @brief Implements the Potion class methods used in alchemy and brewing logic.
  *
  * This file contains simple getter and setter logic for potion ingredients,
- * including a sorting routine to ensure correct formatting in responses.
+ * including a sorting routine, run when the formula is set, to ensure correct formatting in responses.
  */
 
 #include "Inventory.h"
 #include "Utils.h"
 #include <string>
-#include <set>
 
 /**
  * @brief Get the list of ingredients required for this potion.
@@ -18,27 +17,87 @@
  * ingredients are sorted in ascending alphabetical order. This ensures
  * consistent output formatting for "What is in ..." queries.
  *
- * @return A sorted vector of ingredient-count pairs.
+ * @return A reference to the sorted list of ingredient-count pairs, empty if no formula is known.
  */
-std::vector<std::pair<std::string, int>> Potion::get_ingredients()
+const Formula &Potion::get_ingredients() const
 {
-    std::sort(ingredients.begin(), ingredients.end(),
-              [](const std::pair<std::string, int> &a, const std::pair<std::string, int> &b)
+    return ingredients;
+}
+
+/**
+ * @brief Get what brewing this potion asks of each distinct ingredient.
+ * @return A reference to the requirements, one per ingredient of the formula.
+ */
+const Potion::Requirements &Potion::get_requirements() const
+{
+    return requirements;
+}
+
+/**
+ * @brief Set the list of ingredients for this potion.
+ *
+ * The list is sorted here, once, in the order get_ingredients returns it, and merged into one
+ * requirement per ingredient.
+ *
+ * @param new_ingredients A vector containing pairs of ingredient ids and their quantities.
+ * @param symbols The table the ingredient ids were interned in, used to compare their names.
+ */
+void Potion::set_ingredients(std::vector<std::pair<Id, int>> new_ingredients, const SymbolTable &symbols)
+{
+    std::sort(new_ingredients.begin(), new_ingredients.end(),
+              [&symbols](const std::pair<Id, int> &a, const std::pair<Id, int> &b)
               {
                   if (a.second == b.second)
                   {
-                      return a.first < b.first;
+                      return symbols.name(a.first) < symbols.name(b.first);
                   }
                   return a.second > b.second;
               });
-    return ingredients;
+    ingredients.assign(new_ingredients.begin(), new_ingredients.end());
+    formula_line.clear();
+
+    requirements.clear();
+    for (const auto &pair : ingredients)
+    {
+        auto same = std::find_if(requirements.begin(), requirements.end(), [&pair](const Requirement &r)
+                                 { return r.ingredient == pair.first; });
+        if (same == requirements.end())
+        {
+            requirements.push_back({pair.first, pair.second, pair.second});
+        }
+        else
+        {
+            same->total += pair.second;
+            same->largest = std::max(same->largest, pair.second);
+        }
+    }
 }
 
 /**
- * @brief Set the list of ingredients for this potion.
- * @param new_ingredients A vector containing pairs of ingredient names and their quantities.
+ * @brief Get the response to a potion formula question.
+ *
+ * The ingredients are listed as "<count> <ingredient>" in the order of get_ingredients, separated
+ * by commas and followed by a newline. The line is built on the first call and then reused.
+ *
+ * @param symbols The table the ingredient ids were interned in.
+ * @return A reference to the formatted line, valid until the formula is set again.
  */
-void Potion::set_ingredients(std::vector<std::pair<std::string, int>> new_ingredients)
+const std::string &Potion::get_formula_line(const SymbolTable &symbols) const
 {
-    this->ingredients = new_ingredients;
+    if (!formula_line.empty())
+    {
+        return formula_line;
+    }
+    for (size_t i = 0; i < ingredients.size(); ++i)
+    {
+        formula_line += std::to_string(ingredients[i].second);
+        formula_line += ' ';
+        formula_line += symbols.name(ingredients[i].first);
+        if (i < ingredients.size() - 1)
+        {
+            formula_line += ", ";
+        }
+    }
+    formula_line += '\n';
+    return formula_line;
 }
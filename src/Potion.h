@@ -6,22 +6,54 @@
  * along with the number of times the potion has been brewed (its count in the inventory).
  * It provides methods to get and set the ingredients, as well as to increment or decrement
  * the potion count.
+ * Ingredients are stored as ids interned in the session's SymbolTable. The formula is sorted once,
+ * when it is set, and read back through a const reference.
+ *
+ * Next to the formula the potion keeps its requirements: one entry per distinct ingredient with
+ * the amount a single brew uses up and the largest amount any formula entry asks for. They differ
+ * only when a formula names an ingredient more than once, since every entry must be covered on
+ * its own while the brew uses up their sum.
+ *
+ * Both lists are SmallVectors that keep up to four entries inside the potion, so a short formula
+ * takes no allocation of its own.
+ *
+ * The response to "What is in <potion> ?" is built the first time it is asked for and kept, as a
+ * formula never changes once it is known.
  * All internal data is encapsulated to prevent direct access or arbitrary modification from outside the class.
  */
 
 #pragma once
-#include <map>
-#include <set>
 #include <string>
+#include <utility>
 #include <vector>
-#include <iostream>
 #include <algorithm>
+#include "SmallVector.h"
+#include "SymbolTable.h"
+
+/**
+ * @brief What brewing a potion asks of one ingredient.
+ */
+struct Requirement
+{
+    Id ingredient;
+    int total;   // the amount one brew uses up, the sum of its formula entries
+    int largest; // the amount that must be in stock to brew, the largest of its formula entries
+};
+
+using Formula = SmallVector<std::pair<Id, int>, 4>; // ingredient ids and counts of a formula, in its order
 
 class Potion
 {
+public:
+    using Requirements = SmallVector<Requirement, 4>;
+
 private:
-    std::vector<std::pair<std::string, int>> ingredients; // a vector to keep the ingredients and their counts necessary for crafting the potion
+    Formula ingredients;               // a list to keep the ingredient ids and their counts necessary for crafting the potion
+    Requirements requirements;         // the formula merged per ingredient, used when brewing
+    mutable std::string formula_line;  // formatted formula, empty until it is first asked for
 public:
-    std::vector<std::pair<std::string, int>> get_ingredients();
-    void set_ingredients(std::vector<std::pair<std::string, int>> ingredients);
+    const Formula &get_ingredients() const;
+    const Requirements &get_requirements() const;
+    const std::string &get_formula_line(const SymbolTable &symbols) const;
+    void set_ingredients(std::vector<std::pair<Id, int>> ingredients, const SymbolTable &symbols);
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+/**
+ * @file PreparednessIndex.cpp
+ * @brief Implements the incremental index of encounter preparedness.
+ */
+
+#include "PreparednessIndex.h"
+
+/**
+ * @brief Gets the entry of a monster, creating it if needed.
+ *
+ * @param monster The id of the monster.
+ * @return A reference to the entry, valid until another monster is added.
+ */
+PreparednessIndex::Readiness &PreparednessIndex::entry(Id monster)
+{
+    if (monster >= monsters.size())
+    {
+        monsters.resize(monster + 1);
+    }
+    return monsters[monster];
+}
+
+/**
+ * @brief Records that a sign is effective against a monster.
+ *
+ * @param monster The id of the monster.
+ */
+void PreparednessIndex::sign_learned(Id monster)
+{
+    entry(monster).has_sign = true;
+}
+
+/**
+ * @brief Records that a potion is effective against a monster. Must be called once per pair.
+ *
+ * @param monster The id of the monster.
+ * @param potion The id of the potion.
+ * @param potion_counts The current potion counts, used to find whether the potion is in stock.
+ */
+void PreparednessIndex::potion_learned(Id monster, Id potion, const CountStore &potion_counts)
+{
+    if (potion >= effective.size())
+    {
+        effective.resize(potion + 1);
+    }
+    effective[potion].push_back(monster);
+    if (potion_counts.get(potion) > 0)
+    {
+        entry(monster).potions_in_stock++;
+    }
+    else
+    {
+        entry(monster);
+    }
+}
+
+/**
+ * @brief Updates the monsters a potion is effective against after its count changed.
+ *
+ * @param potion The id of the potion.
+ * @param before The count of the potion before the change.
+ * @param after The count of the potion after the change.
+ */
+void PreparednessIndex::stock_changed(Id potion, int before, int after)
+{
+    if (potion >= effective.size() || (before > 0) == (after > 0))
+    {
+        return;
+    }
+    int delta = after > 0 ? 1 : -1;
+    for (Id monster : effective[potion])
+    {
+        monsters[monster].potions_in_stock += delta;
+    }
+}
+
+/**
+ * @brief Checks if Geralt would defeat a monster.
+ *
+ * @param monster The id of the monster, may be SymbolTable::none.
+ * @return true if a sign against the monster is known or one of its effective potions is in stock.
+ */
+bool PreparednessIndex::is_prepared(Id monster) const
+{
+    if (monster >= monsters.size())
+    {
+        return false;
+    }
+    return monsters[monster].has_sign || monsters[monster].potions_in_stock > 0;
+}
+
+/**
+ * @brief Gets the number of potions effective against a monster that are in stock.
+ *
+ * @param monster The id of the monster, may be SymbolTable::none.
+ * @return The number of distinct effective potions with a positive count.
+ */
+int PreparednessIndex::potions_in_stock(Id monster) const
+{
+    return monster < monsters.size() ? monsters[monster].potions_in_stock : 0;
+}
@@ -0,0 +1,38 @@
+/**
+ * @class PreparednessIndex
+ * @brief Keeps track of which monsters Geralt is prepared to fight.
+ *
+ * For every monster in the bestiary the index stores whether a sign is known to be effective
+ * against it, and how many of the potions known to be effective against it are in stock. A
+ * reverse index from potion to the monsters it is effective against keeps the counts up to date
+ * as potions are brewed and used, so deciding whether an encounter is won is a single lookup.
+ *
+ * Geralt is prepared for a monster if he knows a sign against it or has at least one of its
+ * effective potions, exactly the rule encounters have always followed.
+ */
+
+#pragma once
+#include <vector>
+#include "CountStore.h"
+#include "SymbolTable.h"
+
+class PreparednessIndex
+{
+public:
+    void sign_learned(Id monster);
+    void potion_learned(Id monster, Id potion, const CountStore &potion_counts);
+    void stock_changed(Id potion, int before, int after);
+    bool is_prepared(Id monster) const;
+    int potions_in_stock(Id monster) const;
+
+private:
+    struct Readiness
+    {
+        bool has_sign = false;    // a sign against the monster is known
+        int potions_in_stock = 0; // known effective potions with a positive count
+    };
+    std::vector<Readiness> monsters;          // indexed by monster id
+    std::vector<std::vector<Id>> effective;   // monsters each potion is known to be effective against
+
+    Readiness &entry(Id monster);
+};
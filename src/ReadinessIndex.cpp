@@ -0,0 +1,99 @@
+/**
+ * @file ReadinessIndex.cpp
+ * @brief Implements the incremental index of brewable potions.
+ */
+
+#include "ReadinessIndex.h"
+
+/**
+ * @brief Adds the formula of a potion that had none.
+ *
+ * @param potion The id of the potion.
+ * @param formula The ingredient ids and counts of its formula.
+ * @param stock The current ingredient counts, used to find the entries that are already covered.
+ *
+ * @note The listener is called if the potion can be brewed right away.
+ */
+void ReadinessIndex::add_formula(Id potion, const Formula &formula, const CountStore &stock)
+{
+    if (potion >= missing.size())
+    {
+        missing.resize(potion + 1, -1);
+    }
+    int uncovered = 0;
+    for (const auto &pair : formula)
+    {
+        if (pair.first >= uses.size())
+        {
+            uses.resize(pair.first + 1);
+        }
+        uses[pair.first].push_back({potion, pair.second});
+        if (stock.get(pair.first) < pair.second)
+        {
+            uncovered++;
+        }
+    }
+    missing[potion] = uncovered;
+    if (uncovered == 0 && listener)
+    {
+        listener(potion);
+    }
+}
+
+/**
+ * @brief Updates the formulas using an ingredient after its count changed.
+ *
+ * @param ingredient The id of the ingredient.
+ * @param before The count of the ingredient before the change.
+ * @param after The count of the ingredient after the change.
+ *
+ * @note The listener is called for every potion that became brewable through this change.
+ */
+void ReadinessIndex::stock_changed(Id ingredient, int before, int after)
+{
+    if (ingredient >= uses.size() || before == after)
+    {
+        return;
+    }
+    for (const Use &use : uses[ingredient])
+    {
+        bool was_covered = before >= use.count;
+        bool is_covered = after >= use.count;
+        if (was_covered == is_covered)
+        {
+            continue;
+        }
+        if (is_covered)
+        {
+            if (--missing[use.potion] == 0 && listener)
+            {
+                listener(use.potion);
+            }
+        }
+        else
+        {
+            missing[use.potion]++;
+        }
+    }
+}
+
+/**
+ * @brief Checks if every entry of a potion's formula is covered.
+ *
+ * @param potion The id of the potion, may be SymbolTable::none.
+ * @return true if the potion has a formula and enough of each of its ingredients, false otherwise.
+ */
+bool ReadinessIndex::is_brewable(Id potion) const
+{
+    return potion < missing.size() && missing[potion] == 0;
+}
+
+/**
+ * @brief Registers the function called when a potion becomes brewable.
+ *
+ * @param new_listener The function to call with the id of the potion, or an empty function to stop reporting.
+ */
+void ReadinessIndex::set_listener(std::function<void(Id)> new_listener)
+{
+    listener = std::move(new_listener);
+}
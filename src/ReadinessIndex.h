@@ -0,0 +1,43 @@
+/**
+ * @class ReadinessIndex
+ * @brief Keeps track of which known potions can be brewed from the current ingredients.
+ *
+ * For every potion with a formula the index stores how many formula entries are not covered by
+ * the ingredient counts, and, for every ingredient, the formula entries that use it. When the
+ * count of an ingredient changes, only the formulas using that ingredient are updated, so
+ * checking whether a potion can be brewed is a single lookup instead of a pass over its formula.
+ *
+ * An entry "<count> <ingredient>" is covered when at least that many of the ingredient are in
+ * stock. Entries are checked independently, the same way brewing always checked them, so a
+ * formula naming an ingredient twice needs each count on its own, not their sum.
+ *
+ * A listener can be registered; it is called with the id of a potion whenever that potion
+ * becomes brewable, either when its formula is learned or when an ingredient arrives.
+ */
+
+#pragma once
+#include <functional>
+#include <utility>
+#include <vector>
+#include "CountStore.h"
+#include "Potion.h"
+#include "SymbolTable.h"
+
+class ReadinessIndex
+{
+public:
+    void add_formula(Id potion, const Formula &formula, const CountStore &stock);
+    void stock_changed(Id ingredient, int before, int after);
+    bool is_brewable(Id potion) const;
+    void set_listener(std::function<void(Id)> listener);
+
+private:
+    struct Use
+    {
+        Id potion; // potion whose formula has the entry
+        int count; // the count the entry asks for
+    };
+    std::vector<int> missing;           // uncovered entries of each potion's formula, -1 without a formula
+    std::vector<std::vector<Use>> uses; // formula entries naming each ingredient
+    std::function<void(Id)> listener;   // called when a potion becomes brewable, may be empty
+};
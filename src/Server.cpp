@@ -0,0 +1,559 @@
+/**
+ * @file Server.cpp
+ * @brief Implements the sharded multi-world server: the I/O loop and the shard threads.
+ */
+
+#include "Server.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <poll.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Creates a server with no connections. The shard threads start with run.
+ *
+ * @param shards The number of shard threads, at least 1.
+ */
+Server::Server(int shards)
+{
+    for (int s = 0; s < shards; ++s)
+    {
+        this->shards.push_back(std::make_unique<Shard>());
+    }
+    filling.assign(shards, nullptr);
+    if (::pipe(wake_pipe) == 0)
+    {
+        ::fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+    }
+}
+
+/**
+ * @brief Closes the listening socket if run didn't, the wake-up pipe and any connection left open.
+ */
+Server::~Server()
+{
+    for (Connection &connection : connections)
+    {
+        close_connection(connection);
+    }
+    if (listener >= 0)
+    {
+        ::close(listener);
+        ::unlink(listen_path.c_str());
+    }
+    ::close(wake_pipe[0]);
+    ::close(wake_pipe[1]);
+}
+
+/**
+ * @brief Starts accepting connections on a Unix socket, replacing any file at its path.
+ *
+ * @param path The path of the socket.
+ * @return true if the socket is listening, false otherwise.
+ */
+bool Server::listen(const std::string &path)
+{
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "witchertracker-server: socket path too long: " << path << "\n";
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(fd, 128) != 0)
+    {
+        std::cerr << "witchertracker-server: cannot listen on " << path << ": " << std::strerror(errno) << "\n";
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        return false;
+    }
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    listener = fd;
+    listen_path = path;
+    return true;
+}
+
+/**
+ * @brief Adds a connection over existing descriptors, e.g. the standard input and output.
+ *
+ * The descriptors are made non-blocking while the server uses them and get their flags back
+ * when the connection is closed. They are not closed.
+ *
+ * @param in_fd The descriptor requests are read from.
+ * @param out_fd The descriptor responses are written to, may be the same one.
+ */
+void Server::add_connection(int in_fd, int out_fd)
+{
+    Connection connection;
+    connection.in_fd = in_fd;
+    connection.out_fd = out_fd;
+    connection.in_flags = ::fcntl(in_fd, F_GETFL);
+    connection.out_flags = ::fcntl(out_fd, F_GETFL);
+    connection.reading = true;
+    ::fcntl(in_fd, F_SETFL, connection.in_flags | O_NONBLOCK);
+    ::fcntl(out_fd, F_SETFL, connection.out_flags | O_NONBLOCK);
+    connections.push_back(std::move(connection));
+}
+
+/**
+ * @brief Asks run to return once the lines already read are answered.
+ *
+ * Only sets a flag and writes to a pipe, so it may be called from a signal handler.
+ */
+void Server::stop()
+{
+    stopping.store(true);
+    char byte = 0;
+    ssize_t ignored = ::write(wake_pipe[1], &byte, 1);
+    (void)ignored;
+}
+
+/**
+ * @brief Gets the number of worlds that exist, in every shard.
+ * @return The number of worlds.
+ */
+size_t Server::world_count() const
+{
+    return worlds_alive.load();
+}
+
+/**
+ * @brief Wakes the I/O thread if it may be blocking in poll.
+ */
+void Server::wake_io()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (io_sleeping.exchange(false))
+    {
+        char byte = 0;
+        ssize_t ignored = ::write(wake_pipe[1], &byte, 1);
+        (void)ignored;
+    }
+}
+
+/**
+ * @brief Takes the next batch for a shard, waiting on its condition variable once it stays empty.
+ *
+ * @param shard The shard.
+ * @return The batch, or null when the shard should end.
+ */
+Server::Batch *Server::wait_request(Shard &shard)
+{
+    Batch *batch = nullptr;
+    for (int spin = 0; spin < 64; ++spin)
+    {
+        if (shard.requests.try_pop(batch))
+        {
+            return batch;
+        }
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    shard.sleeping.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!shard.requests.try_pop(batch))
+    {
+        shard.wake.wait(lock);
+    }
+    shard.sleeping.store(false);
+    return batch;
+}
+
+/**
+ * @brief Executes every line of a batch in its world and tags the responses.
+ *
+ * @param shard The shard the batch was routed to, which owns the worlds of its lines.
+ * @param batch The batch, its output is replaced with the tagged responses.
+ */
+void Server::execute_batch(Shard &shard, Batch &batch)
+{
+    batch.output.clear();
+    std::string_view lines = batch.lines;
+    while (!lines.empty())
+    {
+        size_t newline = lines.find('\n');
+        std::string_view request = lines.substr(0, newline);
+        lines.remove_prefix(newline + 1);
+        size_t tab = request.find('\t');
+        std::string_view world = request.substr(0, tab);
+        std::string_view line = request.substr(tab + 1);
+
+        shard.key.assign(world);
+        auto it = shard.worlds.find(shard.key);
+        if (it == shard.worlds.end())
+        {
+            if (line == "Exit")
+            {
+                continue; // ends a world that didn't exist
+            }
+            it = shard.worlds.emplace(shard.key, std::make_unique<Session>(shard.sink, world_arena_size)).first;
+            worlds_alive++;
+        }
+
+        bool running = line != "Exit" && it->second->execute(shard.parser.parse(line));
+        shard.sink.flush();
+        std::string_view responses = shard.staged;
+        while (!responses.empty())
+        {
+            size_t end = responses.find('\n');
+            batch.output.append(world);
+            batch.output += '\t';
+            batch.output.append(responses.substr(0, end));
+            batch.output += '\n';
+            responses.remove_prefix(end == std::string_view::npos ? responses.size() : end + 1);
+        }
+        shard.staged.clear();
+        if (!running)
+        {
+            shard.worlds.erase(it);
+            worlds_alive--;
+        }
+    }
+}
+
+/**
+ * @brief Runs a shard thread: executes the batches it is given until a null batch arrives.
+ *
+ * @param shard The shard.
+ */
+void Server::serve_shard(Shard &shard)
+{
+    while (Batch *batch = wait_request(shard))
+    {
+        execute_batch(shard, *batch);
+        shard.responses.push(batch);
+        wake_io();
+    }
+}
+
+/**
+ * @brief Takes a free batch, or creates one.
+ * @return The batch, empty.
+ */
+Server::Batch *Server::take_batch()
+{
+    if (free_batches.empty())
+    {
+        pool.push_back(std::make_unique<Batch>());
+        return pool.back().get();
+    }
+    Batch *batch = free_batches.back();
+    free_batches.pop_back();
+    batch->lines.clear();
+    return batch;
+}
+
+/**
+ * @brief Hands a batch to a shard, collecting responses while its ring is full, and wakes the shard if it sleeps.
+ *
+ * @param shard The index of the shard.
+ * @param batch The batch, or null to end the shard.
+ */
+void Server::push_request(size_t shard, Batch *batch)
+{
+    Shard &target = *shards[shard];
+    while (!target.requests.try_push(batch))
+    {
+        // the shard may itself wait for room to return a batch
+        collect_responses();
+        std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (target.sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(target.mutex);
+        target.wake.notify_one();
+    }
+}
+
+/**
+ * @brief Moves the responses of every executed batch to their connection and frees the batches.
+ * @return true if any batch came back.
+ */
+bool Server::collect_responses()
+{
+    bool any = false;
+    for (std::unique_ptr<Shard> &shard : shards)
+    {
+        Batch *batch = nullptr;
+        while (shard->responses.try_pop(batch))
+        {
+            Connection &connection = connections[batch->connection];
+            connection.pending_out += batch->output;
+            connection.in_flight--;
+            free_batches.push_back(batch);
+            any = true;
+        }
+    }
+    return any;
+}
+
+/**
+ * @brief Splits the complete request lines a connection sent into batches, one per shard, and hands them over.
+ *
+ * @param connection The index of the connection.
+ */
+void Server::route_lines(size_t connection)
+{
+    std::string &input = connections[connection].pending_in;
+    size_t start = 0;
+    size_t newline;
+    while ((newline = input.find('\n', start)) != std::string::npos)
+    {
+        std::string_view line(input.data() + start, newline - start);
+        start = newline + 1;
+        size_t tab = line.find('\t');
+        if (tab == std::string_view::npos)
+        {
+            std::cerr << "witchertracker-server: request without a world id: " << line << "\n";
+            continue;
+        }
+        size_t shard = std::hash<std::string_view>()(line.substr(0, tab)) % shards.size();
+        if (filling[shard] == nullptr)
+        {
+            filling[shard] = take_batch();
+            filling[shard]->connection = connection;
+        }
+        filling[shard]->lines.append(line);
+        filling[shard]->lines += '\n';
+    }
+    input.erase(0, start);
+
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        if (filling[shard] != nullptr)
+        {
+            connections[connection].in_flight++;
+            push_request(shard, filling[shard]);
+            filling[shard] = nullptr;
+        }
+    }
+}
+
+/**
+ * @brief Writes as much of the pending responses of a connection as it takes without blocking.
+ *
+ * @param connection The connection. If its peer went away, its responses are dropped.
+ */
+void Server::write_pending(Connection &connection)
+{
+    size_t written = 0;
+    while (written < connection.pending_out.size())
+    {
+        ssize_t n = ::write(connection.out_fd, connection.pending_out.data() + written,
+                            connection.pending_out.size() - written);
+        if (n > 0)
+        {
+            written += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        // the peer is gone: nothing more can be written, and nothing more will be read
+        written = connection.pending_out.size();
+        connection.reading = false;
+    }
+    connection.pending_out.erase(0, written);
+}
+
+/**
+ * @brief Closes a connection, giving added descriptors their flags back and closing accepted sockets.
+ *
+ * @param connection The connection.
+ */
+void Server::close_connection(Connection &connection)
+{
+    if (connection.out_fd < 0)
+    {
+        return;
+    }
+    if (connection.owned)
+    {
+        ::close(connection.out_fd);
+    }
+    else
+    {
+        ::fcntl(connection.in_fd, F_SETFL, connection.in_flags);
+        ::fcntl(connection.out_fd, F_SETFL, connection.out_flags);
+    }
+    connection = Connection();
+}
+
+/**
+ * @brief Serves the connections until stop is called or, without a listening socket, every connection is done.
+ *
+ * Starts the shard threads, runs the I/O loop on the calling thread and ends the shards before returning.
+ * Every line read before the end is executed and its responses written, as far as the peer accepts them.
+ */
+void Server::run()
+{
+    for (std::unique_ptr<Shard> &shard : shards)
+    {
+        Shard *s = shard.get();
+        shard->thread = std::thread([this, s] { serve_shard(*s); });
+    }
+
+    std::vector<pollfd> fds;
+    std::vector<size_t> polled; // connection index of every fds entry after the fixed ones
+    std::vector<char> chunk(read_size);
+    while (true)
+    {
+        collect_responses();
+        bool open = false;
+        for (Connection &connection : connections)
+        {
+            if (connection.out_fd < 0)
+            {
+                continue;
+            }
+            if (stopping.load())
+            {
+                connection.reading = false; // no new requests once stopping
+            }
+            write_pending(connection);
+            if (!connection.reading && connection.in_flight == 0 && connection.pending_out.empty())
+            {
+                close_connection(connection);
+                continue;
+            }
+            open = true;
+        }
+        if (!open && (stopping.load() || listener < 0))
+        {
+            break;
+        }
+
+        fds.clear();
+        polled.clear();
+        fds.push_back({wake_pipe[0], POLLIN, 0});
+        if (listener >= 0 && !stopping.load())
+        {
+            fds.push_back({listener, POLLIN, 0});
+        }
+        size_t fixed = fds.size();
+        for (size_t c = 0; c < connections.size(); ++c)
+        {
+            Connection &connection = connections[c];
+            if (connection.out_fd < 0)
+            {
+                continue;
+            }
+            // a connection whose batches fill a ring waits with its next read until they come back
+            if (connection.reading && connection.in_flight < ring_size / 2)
+            {
+                fds.push_back({connection.in_fd, POLLIN, 0});
+                polled.push_back(c);
+            }
+            if (!connection.pending_out.empty())
+            {
+                // a separate entry, as the input and output may be different descriptors
+                fds.push_back({connection.out_fd, POLLOUT, 0});
+                polled.push_back(c);
+            }
+        }
+
+        io_sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (collect_responses())
+        {
+            io_sleeping.store(false);
+            continue;
+        }
+        int ready = ::poll(fds.data(), fds.size(), -1);
+        io_sleeping.store(false);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "witchertracker-server: poll failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+
+        if (fds[0].revents != 0)
+        {
+            char drain[64];
+            while (::read(wake_pipe[0], drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+        if (fixed == 2 && fds[1].revents != 0)
+        {
+            int fd;
+            while ((fd = ::accept(listener, nullptr, nullptr)) >= 0)
+            {
+                ::fcntl(fd, F_SETFL, O_NONBLOCK);
+                Connection connection;
+                connection.in_fd = fd;
+                connection.out_fd = fd;
+                connection.owned = true;
+                connection.reading = true;
+                size_t slot = 0;
+                while (slot < connections.size() && connections[slot].out_fd >= 0)
+                {
+                    slot++;
+                }
+                if (slot == connections.size())
+                {
+                    connections.emplace_back();
+                }
+                connections[slot] = std::move(connection);
+            }
+        }
+        for (size_t i = fixed; i < fds.size(); ++i)
+        {
+            Connection &connection = connections[polled[i - fixed]];
+            if (fds[i].events != POLLIN || (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0 || !connection.reading)
+            {
+                continue; // an output entry, handled by write_pending at the top of the loop
+            }
+            ssize_t n = ::read(connection.in_fd, chunk.data(), chunk.size());
+            if (n > 0)
+            {
+                connection.pending_in.append(chunk.data(), n);
+                route_lines(polled[i - fixed]);
+            }
+            else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                // like getline at EOF, a last line without its '\n' is not executed
+                connection.pending_in.clear();
+                connection.reading = false;
+            }
+        }
+    }
+
+    if (listener >= 0)
+    {
+        ::close(listener);
+        ::unlink(listen_path.c_str());
+        listener = -1;
+    }
+    for (size_t s = 0; s < shards.size(); ++s)
+    {
+        push_request(s, nullptr);
+    }
+    for (std::unique_ptr<Shard> &shard : shards)
+    {
+        shard->thread.join();
+    }
+}
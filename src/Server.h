@@ -0,0 +1,128 @@
+/**
+ * @class Server
+ * @brief Serves many independent worlds, each with its own Session, from a fixed set of shard threads.
+ *
+ * A world is one Geralt state, named by a world id. Clients send request lines of the form
+ * "<world>\t<line>\n", where the world id is everything before the first tab and the line is
+ * executed in that world exactly as the interactive loop would execute it. Every line of the
+ * response is sent back to the connection the request came from as "<world>\t<response>\n".
+ * A world is created by its first line and ends, like a run of witchertracker, at an "Exit" line
+ * or an exit command, which answer nothing; a later line with the same id starts a new world.
+ * Lines without a tab are reported on the standard error and skipped.
+ *
+ * Every world belongs to one shard, picked by hashing its id, and only that shard's thread ever
+ * touches its Session, so executing a line takes no lock. Within a world the lines run in the
+ * order they arrived and their responses go back in the same order; responses of different
+ * worlds can interleave. Worlds outlive connections, so a client can reconnect and continue.
+ *
+ * The calling thread does all the I/O in run: it polls the connections, splits what they send
+ * into lines, and gathers the lines for each shard into a batch, which it hands to the shard
+ * through an SpscRing. The shard parses the lines with its own Utils::Parser, executes them in
+ * their worlds, all of which write to the shard's one OutputSink, tags the responses and returns
+ * the batch through a second SpscRing. Batches are reused, so the steady state allocates only
+ * for new worlds. A world never builds a parser of its own, and its line arena is small and only
+ * allocated once a line needs it, so an idle world costs little more than its state. A shard with nothing to do waits on a condition variable, and the I/O thread
+ * in poll; the other side only takes the lock or writes to the wake-up pipe when it finds the
+ * sleeping flag set, which it checks after a sequentially consistent fence.
+ *
+ * Connections are either added with add_connection, such as the standard input and output, or
+ * accepted on a Unix socket given to listen. run returns once stop was called, or without a
+ * listening socket once every connection reached the end of its input and got all responses.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "OutputSink.h"
+#include "Session.h"
+#include "SpscRing.h"
+#include "Utils.h"
+
+class Server
+{
+public:
+    static constexpr size_t ring_size = 256;          // batches in flight to or from a shard
+    static constexpr size_t read_size = 64 * 1024;    // bytes read from a connection at once
+    static constexpr size_t world_arena_size = 1024;  // bytes of a world's LineArena, allocated by its first use
+
+    explicit Server(int shards);
+    ~Server();
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    bool listen(const std::string &path);
+    void add_connection(int in_fd, int out_fd);
+    void run();
+    void stop();
+    size_t world_count() const;
+
+private:
+    struct Batch
+    {
+        size_t connection = 0; // index of the connection the lines came from and the responses go to
+        std::string lines;     // request lines, each ending in '\n'
+        std::string output;    // tagged responses, once executed
+    };
+
+    struct Shard
+    {
+        Shard() : requests(ring_size), responses(ring_size), sink(staged)
+        {
+        }
+
+        SpscRing<Batch *> requests;  // batches to execute, a null batch ends the thread
+        SpscRing<Batch *> responses; // executed batches, back to the I/O thread
+        std::unordered_map<std::string, std::unique_ptr<Session>> worlds; // the worlds of this shard by id
+        std::string staged;          // what the worlds wrote for the current line
+        OutputSink sink;             // the sink every world of the shard writes to
+        Utils::Parser parser;        // parses the lines of every world of the shard
+        std::string key;             // reusable buffer for the id of the world being looked up
+        std::atomic<bool> sleeping{false}; // set while the thread waits for requests
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread thread;
+    };
+
+    struct Connection
+    {
+        int in_fd = -1;          // where requests are read from
+        int out_fd = -1;         // where responses are written to, -1 once the connection is closed
+        int in_flags = 0;        // flags of in_fd before it was made non-blocking
+        int out_flags = 0;       // flags of out_fd before it was made non-blocking
+        bool owned = false;      // true for accepted sockets, which are closed with the connection
+        bool reading = false;    // false once the input ended or the server is stopping
+        std::string pending_in;  // the start of a request line whose '\n' wasn't read yet
+        std::string pending_out; // responses not written yet
+        size_t in_flight = 0;    // batches of this connection handed to shards and not back yet
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<Connection> connections; // closed ones are reused for new connections
+    std::vector<std::unique_ptr<Batch>> pool; // every batch ever created
+    std::vector<Batch *> free_batches;        // batches no shard holds, owned by the I/O thread
+    std::vector<Batch *> filling;             // the batch being filled for each shard, or null
+    int listener = -1;                        // the Unix socket connections are accepted on, if any
+    std::string listen_path;                  // its path, removed when the server ends
+    int wake_pipe[2] = {-1, -1};              // written to wake the I/O thread from poll
+    std::atomic<bool> io_sleeping{false};     // set while the I/O thread may block in poll
+    std::atomic<bool> stopping{false};        // set by stop
+    std::atomic<size_t> worlds_alive{0};      // worlds of every shard
+
+    void serve_shard(Shard &shard);
+    Batch *wait_request(Shard &shard);
+    void execute_batch(Shard &shard, Batch &batch);
+    void route_lines(size_t connection);
+    void push_request(size_t shard, Batch *batch);
+    Batch *take_batch();
+    bool collect_responses();
+    void write_pending(Connection &connection);
+    void close_connection(Connection &connection);
+    void wake_io();
+};
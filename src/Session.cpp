@@ -0,0 +1,654 @@
+/**
+ * @file Session.cpp
+ * @brief Implements the execution of a single command line within a session.
+ *
+ * Classifies lines as sentence-type or question-type commands and delegates them to the
+ * session's Inventory for processing.
+ */
+
+#include "Session.h"
+#include "MappedFile.h"
+#include "Snapshot.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+/**
+ * @brief Creates a session with an empty inventory.
+ *
+ * @param out The sink every response of this session is written to.
+ * @param arena_size The size of the buffer of the session's LineArena, allocated by the first line that uses it.
+ */
+Session::Session(OutputSink &out, size_t arena_size) : out(out), arena(arena_size), inventory(symbols, out, &arena)
+{
+}
+
+/**
+ * @brief Executes a command that was parsed from a line or read from a journal.
+ *
+ * @param command The command, with its names resolved. It must not be an exit command.
+ */
+void Session::dispatch(const Command &command)
+{
+    WITCHER_STATS_SCOPE(stats.handler(command.type));
+    switch (command.type)
+    {
+    case CommandType::IngredientCount: // specific ingredient count
+        out << inventory.get_ingredient_count(command.query.id) << "\n";
+        break;
+    case CommandType::TotalIngredients: // total ingredient count
+        inventory.print_ingredients();
+        break;
+    case CommandType::PotionCount: // specific potion count
+        out << inventory.get_potion_count(command.query.id) << "\n";
+        break;
+    case CommandType::TotalPotions: // total potion count
+        inventory.print_potions();
+        break;
+    case CommandType::TrophyCount: // specific trophy count
+        out << inventory.get_trophy_count(command.query.id) << "\n";
+        break;
+    case CommandType::TotalTrophies: // total trophy count
+        inventory.print_trophies();
+        break;
+    case CommandType::MonsterKnowledge: // specific monster knowledge
+        inventory.print_monster_knowledge(command.query);
+        break;
+    case CommandType::PotionFormula: // potion formula
+        inventory.print_potion_formula(command.query);
+        break;
+    case CommandType::Loot:
+        inventory.handle_loot(command.loot);
+        break;
+    case CommandType::Trade:
+        inventory.handle_trade(command.trade);
+        break;
+    case CommandType::Brew:
+        inventory.handle_brew(command.brew);
+        break;
+    case CommandType::BrewBatch:
+        inventory.handle_brew_batch(command.brew);
+        break;
+    case CommandType::SignKnowledge:
+        inventory.handle_sign_knowledge(command.sign_knowledge);
+        break;
+    case CommandType::PotionKnowledge:
+        inventory.handle_potion_knowledge(command.potion_knowledge);
+        break;
+    case CommandType::PotionRecipe:
+        inventory.handle_potion_recipe(command.potion_recipe);
+        break;
+    case CommandType::Encounter:
+        inventory.handle_encounter(command.encounter);
+        break;
+    default:
+        out << "INVALID\n";
+        break;
+    }
+}
+
+/**
+ * @brief Parse and execute a single user command related to inventory state or knowledge.
+ *
+ * This function is responsible for interpreting and executing a line of input from the user.
+ * The parser turns the line into a typed command in a single pass, its names are resolved to
+ * ids, and based on the command type the matching inventory method executes it. The temporaries
+ * of the previous line are released first, so the arena is reused from the start of its buffer.
+ *
+ * @param line The input line to execute. It only has to stay alive during the call.
+ * @return false if the line was an exit command and the session is over, true otherwise.
+ */
+bool Session::execute_line(std::string_view line)
+{
+    if (!parser)
+    {
+        parser = std::make_unique<Utils::Parser>();
+    }
+#ifdef WITCHER_STATS
+    uint64_t start = Stats::now();
+    Command &command = parser->parse(line);
+    bool running = execute(command);
+    stats.line(command.type).record(Stats::now() - start);
+    return running;
+#else
+    return execute(parser->parse(line));
+#endif
+}
+
+/**
+ * @brief Executes a line that was already parsed, e.g. by another thread.
+ *
+ * The command goes through everything execute_line does after parsing: its names are resolved
+ * in this session's symbol table, it is executed, journaled and counted as a line.
+ *
+ * @param command The command Utils::Parser::parse produced. Its names must be valid during the call.
+ * @return false if the line was an exit command and the session is over, true otherwise.
+ */
+bool Session::execute(Command &command)
+{
+    arena.reset();
+    lines++;
+    Utils::resolve_names(command, symbols);
+    WITCHER_STATS_ONLY(stats.count(command.type));
+
+    if (command.type == CommandType::Exit) // Exit command, finish the run
+    {
+        return false;
+    }
+    dispatch(command);
+    if (journal != nullptr)
+    {
+        journal->record(command, symbols, lines);
+    }
+
+    if (auto_snapshot_every > 0 && lines % auto_snapshot_every == 0)
+    {
+        if (auto_snapshot_deferred)
+        {
+            save_snapshot(snapshot_buffer);
+            auto_snapshot_pending = true;
+            return true;
+        }
+        // the responses of the covered lines must be out before the snapshot claims them done
+        out.flush();
+        if (!save_snapshot_file(auto_snapshot_path))
+        {
+            std::cerr << "witchertracker: cannot write snapshot " << auto_snapshot_path << "\n";
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the number of lines executed in this session.
+ * @return The number of lines, counting those a restored snapshot covered.
+ */
+uint64_t Session::lines_executed() const
+{
+    return lines;
+}
+
+/**
+ * @brief Publishes a view of the inventory as of the last line executed, for other threads to answer questions from.
+ *
+ * Only the thread executing the lines may call this. The view replaces the one view returns.
+ * A view copies the counts of every kind that changed since the previous one, so a writer
+ * answering many questions from views publishes one after a batch of lines, not after every line.
+ *
+ * @return The view, whose epoch is the number of lines executed so far.
+ */
+std::shared_ptr<const InventoryView> Session::publish_view()
+{
+    std::shared_ptr<const InventoryView> view = inventory.publish(lines);
+    std::atomic_store_explicit(&published, view, std::memory_order_release);
+    return view;
+}
+
+/**
+ * @brief Gets the view publish_view published last. Any thread may call this, while lines are executed.
+ *
+ * A thread answering several questions should keep the view for all of them, instead of getting
+ * it again for every question.
+ *
+ * @return The view, or null if none was published yet.
+ */
+std::shared_ptr<const InventoryView> Session::view() const
+{
+    return std::atomic_load_explicit(&published, std::memory_order_acquire);
+}
+
+/**
+ * @brief Writes a snapshot of the session.
+ *
+ * @param buffer The string the snapshot is written to, replacing its contents.
+ */
+void Session::save_snapshot(std::string &buffer)
+{
+    buffer.clear();
+    SnapshotWriter writer(buffer);
+    writer.raw(Snapshot::magic);
+    writer.u32(Snapshot::version);
+    writer.u64(lines);
+
+    writer.u32((uint32_t)symbols.size());
+    for (Id id = 0; id < symbols.size(); ++id)
+    {
+        writer.text(symbols.name(id));
+    }
+    inventory.save(writer);
+
+    writer.u32(Snapshot::checksum(buffer));
+}
+
+/**
+ * @brief Restores a snapshot into this session, which must not have executed any line yet.
+ *
+ * Names are interned again in the order of their ids, so every id of the snapshot keeps its
+ * meaning. The snapshot can be a view into a memory-mapped file, nothing refers to it afterwards.
+ *
+ * @param data The snapshot, as written by save_snapshot.
+ * @return false if the snapshot is damaged, has another version or the session is not new,
+ *         true otherwise. After a failure the session should be discarded.
+ */
+bool Session::restore_snapshot(std::string_view data)
+{
+    if (lines != 0 || symbols.size() != 0 || data.size() < Snapshot::magic.size() + 4)
+    {
+        return false;
+    }
+    std::string_view body = data.substr(0, data.size() - 4);
+    SnapshotReader trailer(data.substr(body.size()));
+    uint32_t stored_checksum = 0;
+    if (!trailer.u32(stored_checksum) || stored_checksum != Snapshot::checksum(body))
+    {
+        return false;
+    }
+
+    SnapshotReader reader(body);
+    std::string_view magic;
+    uint32_t version = 0;
+    uint64_t executed = 0;
+    uint32_t names = 0;
+    if (!reader.raw(Snapshot::magic.size(), magic) || magic != Snapshot::magic || !reader.u32(version) ||
+        version != Snapshot::version || !reader.u64(executed) || !reader.u32(names))
+    {
+        return false;
+    }
+    for (uint32_t id = 0; id < names; ++id)
+    {
+        std::string_view name;
+        if (!reader.text(name) || symbols.intern(name) != id)
+        {
+            return false;
+        }
+    }
+    if (!inventory.restore(reader) || reader.remaining() != 0)
+    {
+        return false;
+    }
+    lines = executed;
+    return true;
+}
+
+/**
+ * @brief Writes a file through a temporary file next to it, renamed over it once complete.
+ *
+ * Readers of the target therefore always see either its previous contents or the new ones.
+ *
+ * @param path The file to write.
+ * @param contents The bytes to write.
+ * @return true if the file was written, false otherwise.
+ */
+static bool replace_file(const std::string &path, std::string_view contents)
+{
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const char *data = contents.data();
+    size_t left = contents.size();
+    while (left > 0)
+    {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            return false;
+        }
+        data += written;
+        left -= written;
+    }
+    if (::close(fd) != 0 || ::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a snapshot of the session to a file.
+ *
+ * The snapshot is written to a temporary file next to the target and renamed over it once it is
+ * complete, so the target always holds either the previous snapshot or the new one.
+ *
+ * @param path The file to write.
+ * @return true if the file was written, false otherwise.
+ */
+bool Session::save_snapshot_file(const std::string &path)
+{
+    save_snapshot(snapshot_buffer);
+    return replace_file(path, snapshot_buffer);
+}
+
+/**
+ * @brief Restores a snapshot file into this session, which must not have executed any line yet.
+ *
+ * The file is memory-mapped and decoded in place.
+ *
+ * @param path The file to read.
+ * @return true if the file could be read and restored, false otherwise.
+ */
+bool Session::restore_snapshot_file(const std::string &path)
+{
+    MappedFile file;
+    return file.open(path) && restore_snapshot(file.contents());
+}
+
+/**
+ * @brief Attaches a journal that every state-changing command is recorded in once it executed.
+ *
+ * @param journal The journal, which must outlive the session, or null to stop recording.
+ */
+void Session::set_journal(Journal *journal)
+{
+    this->journal = journal;
+}
+
+/**
+ * @brief Reads an id and checks that it was interned.
+ *
+ * @param record The record being read.
+ * @param symbols The table the id must belong to.
+ * @param id Set to the id read.
+ * @return false if the record ends or the id is unknown, true otherwise.
+ */
+static bool read_id(SnapshotReader &record, const SymbolTable &symbols, Id &id)
+{
+    return record.u32(id) && id < symbols.size();
+}
+
+/**
+ * @brief Reads a list of items written by the journal, with their names looked up.
+ *
+ * @param record The record being read.
+ * @param symbols The table the ids of the items belong to.
+ * @param items Filled with the items read, keeping its capacity.
+ * @return false if the record is malformed, true otherwise.
+ */
+static bool read_items(SnapshotReader &record, const SymbolTable &symbols, std::vector<Item> &items)
+{
+    uint32_t size = 0;
+    if (!record.u32(size) || size > record.remaining() / 8)
+    {
+        return false;
+    }
+    items.resize(size);
+    for (Item &item : items)
+    {
+        uint32_t count = 0;
+        if (!read_id(record, symbols, item.id) || !record.u32(count) || count == 0 || count > INT32_MAX)
+        {
+            return false;
+        }
+        item.count = (int)count;
+        item.name = symbols.name(item.id);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the fields of a command record into the replayed command.
+ *
+ * Names are taken from the symbol table, so the command is the one the parser produced for the
+ * original line, with its names resolved.
+ *
+ * @param record The record being read, positioned after its kind and line.
+ * @param kind The kind of the record, one of the command kinds of Journal::Kind.
+ * @return false if the record is malformed, true otherwise.
+ */
+bool Session::read_record(SnapshotReader &record, uint32_t kind)
+{
+    Command &command = replayed;
+    uint32_t count = 0;
+    switch (kind)
+    {
+    case Journal::Loot:
+        command.type = CommandType::Loot;
+        return read_items(record, symbols, command.loot.ingredients);
+    case Journal::Trade:
+        command.type = CommandType::Trade;
+        return read_items(record, symbols, command.trade.trophies) &&
+               read_items(record, symbols, command.trade.ingredients);
+    case Journal::Brew:
+    case Journal::BrewBatch:
+        command.type = kind == Journal::Brew ? CommandType::Brew : CommandType::BrewBatch;
+        if (!read_id(record, symbols, command.brew.potion_id) || !record.u32(count) || count == 0 ||
+            count > INT32_MAX)
+        {
+            return false;
+        }
+        command.brew.count = (int)count;
+        command.brew.potion = symbols.name(command.brew.potion_id);
+        return true;
+    case Journal::SignKnowledge:
+        command.type = CommandType::SignKnowledge;
+        if (!read_id(record, symbols, command.sign_knowledge.sign_id) ||
+            !read_id(record, symbols, command.sign_knowledge.monster_id))
+        {
+            return false;
+        }
+        command.sign_knowledge.sign = symbols.name(command.sign_knowledge.sign_id);
+        command.sign_knowledge.monster = symbols.name(command.sign_knowledge.monster_id);
+        return true;
+    case Journal::PotionKnowledge:
+        command.type = CommandType::PotionKnowledge;
+        if (!read_id(record, symbols, command.potion_knowledge.potion_id) ||
+            !read_id(record, symbols, command.potion_knowledge.monster_id))
+        {
+            return false;
+        }
+        command.potion_knowledge.potion = symbols.name(command.potion_knowledge.potion_id);
+        command.potion_knowledge.monster = symbols.name(command.potion_knowledge.monster_id);
+        return true;
+    case Journal::PotionRecipe:
+        command.type = CommandType::PotionRecipe;
+        if (!read_id(record, symbols, command.potion_recipe.potion_id) ||
+            !read_items(record, symbols, command.potion_recipe.ingredients) ||
+            command.potion_recipe.ingredients.empty())
+        {
+            return false;
+        }
+        command.potion_recipe.potion = symbols.name(command.potion_recipe.potion_id);
+        return true;
+    case Journal::Encounter:
+        command.type = CommandType::Encounter;
+        if (!read_id(record, symbols, command.encounter.monster_id))
+        {
+            return false;
+        }
+        command.encounter.monster = symbols.name(command.encounter.monster_id);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Applies the records of a journal to this session, without parsing any text.
+ *
+ * Symbol records intern their names with the ids they had when they were journaled. Command
+ * records for lines a restored snapshot already covers are skipped, the others are executed and
+ * their responses are written to the session's sink. Afterwards the session counts the lines up
+ * to the last one the journal knows of, so the input can be resumed from there.
+ *
+ * Reading stops at the first incomplete or damaged record, which is how a journal cut short by
+ * a crash ends.
+ *
+ * @param data The journal, as written by Journal.
+ * @return false if the journal is not empty but has no valid header, or a record doesn't fit the
+ *         state of the session, true otherwise. After a failure the session should be discarded.
+ */
+bool Session::replay_journal(std::string_view data)
+{
+    // a journal that crashed before its first commit is empty
+    SnapshotReader reader(data);
+    if (data.empty())
+    {
+        return true;
+    }
+    if (!Journal::read_header(reader))
+    {
+        return false;
+    }
+
+    uint64_t covered = lines;
+    uint64_t last = lines;
+    std::string_view body;
+    while (Journal::next_record(reader, body))
+    {
+        SnapshotReader record(body);
+        uint32_t kind = 0;
+        uint64_t line = 0;
+        if (!record.u32(kind) || !record.u64(line))
+        {
+            return false;
+        }
+        if (kind == Journal::Symbol)
+        {
+            uint32_t id = 0;
+            std::string_view name;
+            if (!record.u32(id) || !record.text(name) || id > symbols.size())
+            {
+                return false;
+            }
+            if (id < symbols.size() ? symbols.name(id) != name : symbols.intern(name) != id)
+            {
+                return false;
+            }
+            continue;
+        }
+        last = std::max(last, line);
+        if (kind == Journal::Progress || line <= covered)
+        {
+            continue;
+        }
+
+        arena.reset();
+        if (!read_record(record, kind) || record.remaining() != 0)
+        {
+            return false;
+        }
+        dispatch(replayed);
+    }
+    lines = last;
+    return true;
+}
+
+/**
+ * @brief Applies the records of a journal file to this session, see replay_journal.
+ *
+ * The file is memory-mapped and decoded in place.
+ *
+ * @param path The journal file.
+ * @return true if the file could be read and replayed, false otherwise.
+ */
+bool Session::replay_journal_file(const std::string &path)
+{
+    MappedFile file;
+    return file.open(path) && replay_journal(file.contents());
+}
+
+/**
+ * @brief Makes the session write a snapshot by itself at a fixed interval.
+ *
+ * After every line whose number is a multiple of the interval, the pending responses are flushed
+ * and a snapshot is written to the file. A failed write is reported on the standard error and the
+ * session goes on.
+ *
+ * @param path The file the snapshots are written to.
+ * @param every_lines The number of lines between snapshots, or 0 to stop writing them.
+ */
+void Session::set_auto_snapshot(const std::string &path, uint64_t every_lines)
+{
+    auto_snapshot_path = path;
+    auto_snapshot_every = every_lines;
+}
+
+/**
+ * @brief Makes the periodic snapshots wait to be taken instead of being written right away.
+ *
+ * A session whose responses are written by another thread cannot tell when they are out, so
+ * flushing its own sink is not enough for a snapshot to claim their lines. While deferred, a
+ * snapshot is only encoded at the interval, and the thread that writes the responses takes it with
+ * take_auto_snapshot and writes it with write_auto_snapshot after the responses of its lines.
+ * A snapshot not taken before the next one is replaced by it.
+ *
+ * @param deferred true to defer the snapshots, false to write them at once again.
+ */
+void Session::defer_auto_snapshots(bool deferred)
+{
+    auto_snapshot_deferred = deferred;
+    auto_snapshot_pending = false;
+}
+
+/**
+ * @brief Takes the last deferred snapshot, if one was encoded since the previous call.
+ *
+ * @param buffer Set to the snapshot; its previous contents are kept by the session for reuse.
+ * @return true if a snapshot was taken, false if none was pending.
+ */
+bool Session::take_auto_snapshot(std::string &buffer)
+{
+    if (!auto_snapshot_pending)
+    {
+        return false;
+    }
+    buffer.swap(snapshot_buffer);
+    auto_snapshot_pending = false;
+    return true;
+}
+
+/**
+ * @brief Writes a deferred snapshot to the auto-snapshot file.
+ *
+ * Only reads the path, which doesn't change while lines are executed, so any thread may call this.
+ * A failed write is reported on the standard error, as for the snapshots written at once.
+ *
+ * @param contents A snapshot taken with take_auto_snapshot.
+ * @return true if the file was written, false otherwise.
+ */
+bool Session::write_auto_snapshot(std::string_view contents) const
+{
+    if (!replace_file(auto_snapshot_path, contents))
+    {
+        std::cerr << "witchertracker: cannot write snapshot " << auto_snapshot_path << "\n";
+        return false;
+    }
+    return true;
+}
+
+#ifdef WITCHER_STATS
+/**
+ * @brief Gets the counters and latencies of the lines executed so far.
+ * @return The statistics of this session.
+ */
+const Stats &Session::statistics() const
+{
+    return stats;
+}
+
+/**
+ * @brief Writes the statistics of this session to a file as JSON, see Stats::write_json.
+ *
+ * Like a snapshot, the file is replaced at once, so it can be read while the run goes on.
+ *
+ * @param path The file to write.
+ * @return true if the file was written, false otherwise.
+ */
+bool Session::write_stats_file(const std::string &path) const
+{
+    std::string json;
+    stats.write_json(json);
+    return replace_file(path, json);
+}
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @class Session
+ * @brief One independent run of the Witcher Tracker, from the first command to Exit.
+ *
+ * A session owns the parser that tokenizes its lines, the symbol table its names are interned in
+ * and the inventory those lines act on, and writes every response to its own OutputSink.
+ * Temporaries of a line are allocated from the session's LineArena, which is reset before the
+ * next line is executed. The parser and the arena buffer are only allocated once they are used,
+ * so a session that only executes lines parsed elsewhere, as a world of the server does, never
+ * builds a parser, and an idle one holds little more than its state.
+ * Nothing is shared between sessions, so several of them can be executed on different threads
+ * inside one process.
+ *
+ * The symbol table and the inventory can be saved to a versioned binary snapshot (see
+ * Snapshot.h) together with the number of lines executed so far, and restored into a new session
+ * in time proportional to the size of the state. With an auto-snapshot interval the session
+ * writes a snapshot itself every N lines, so a restarted run can resume from the latest one.
+ * When another thread writes the responses, as in a Pipeline, the snapshots are deferred: the
+ * session only takes them, and the writing thread writes each one once the responses of the lines
+ * it covers are out.
+ *
+ * With a Journal attached, every state-changing command is appended to it after it executed.
+ * replay_journal applies such a journal again without parsing any text, by turning its records
+ * back into Commands and executing them like parsed lines.
+ *
+ * publish_view copies what the questions read into an InventoryView and swaps it in atomically,
+ * so other threads can answer questions from view while this one keeps executing lines. This is
+ * for embedders: neither the Pipeline nor the Server reads views, since publishing one before a
+ * question costs more than answering the question in the session.
+ *
+ * Built with WITCHER_STATS, the session also counts and times the lines it executes, see Stats.h.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include "Inventory.h"
+#include "Journal.h"
+#include "LineArena.h"
+#include "OutputSink.h"
+#include "Stats.h"
+#include "SymbolTable.h"
+#include "Utils.h"
+
+class Session
+{
+public:
+    static constexpr size_t default_arena_size = 16 * 1024; // bytes of the LineArena buffer, allocated on first use
+
+    explicit Session(OutputSink &out, size_t arena_size = default_arena_size);
+    bool execute_line(std::string_view line);
+    bool execute(Command &command);
+    uint64_t lines_executed() const;
+    std::shared_ptr<const InventoryView> publish_view();
+    std::shared_ptr<const InventoryView> view() const;
+    void save_snapshot(std::string &buffer);
+    bool restore_snapshot(std::string_view data);
+    bool save_snapshot_file(const std::string &path);
+    bool restore_snapshot_file(const std::string &path);
+    void set_auto_snapshot(const std::string &path, uint64_t every_lines);
+    void defer_auto_snapshots(bool deferred);
+    bool take_auto_snapshot(std::string &buffer);
+    bool write_auto_snapshot(std::string_view contents) const;
+    void set_journal(Journal *journal);
+    bool replay_journal(std::string_view data);
+    bool replay_journal_file(const std::string &path);
+#ifdef WITCHER_STATS
+    const Stats &statistics() const;
+    bool write_stats_file(const std::string &path) const;
+#endif
+
+private:
+    OutputSink &out;      // where responses are written
+    std::unique_ptr<Utils::Parser> parser; // tokens of the line being executed, made by the first execute_line
+    SymbolTable symbols;  // ids of every name seen in this session
+    LineArena arena;      // memory for the temporaries of the line being executed
+    Inventory inventory;  // Geralt's state in this session
+    uint64_t lines = 0;   // number of lines executed, including those covered by a restored snapshot
+    std::string auto_snapshot_path; // where periodic snapshots are written
+    uint64_t auto_snapshot_every = 0; // lines between periodic snapshots, 0 if they are disabled
+    std::string snapshot_buffer;    // reused by every snapshot written to a file
+    bool auto_snapshot_deferred = false; // periodic snapshots are left for take_auto_snapshot instead of written
+    bool auto_snapshot_pending = false;  // snapshot_buffer holds a deferred snapshot not taken yet
+    Journal *journal = nullptr;     // where executed commands are recorded, if anywhere
+    Command replayed;               // reusable command the records of a journal are read into
+    std::shared_ptr<const InventoryView> published; // the last view published, only accessed atomically
+#ifdef WITCHER_STATS
+    Stats stats;                    // counters and latencies of the lines executed in this session
+#endif
+
+    void dispatch(const Command &command);
+    bool read_record(SnapshotReader &record, uint32_t kind);
+};
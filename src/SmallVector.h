@@ -0,0 +1,272 @@
+/**
+ * @class SmallVector
+ * @brief A vector that keeps its first few values inside the object and only allocates beyond them.
+ *
+ * Most monsters are weak to a handful of signs and potions, and most formulas name a handful of
+ * ingredients, yet a std::set allocates a node per value and a std::vector allocates a block for
+ * even one. A SmallVector stores up to N values in place of its heap pointer, so small lists take
+ * no allocation at all and sit on the same cache line as the object holding them. Past N values
+ * the list moves to the heap and grows by doubling, as a std::vector does.
+ *
+ * The size and the capacity are 32 bits each, so the object is 8 bytes plus the larger of N
+ * values and a pointer: a SmallVector<Id, 4> is 24 bytes, against 48 for an empty std::set<Id>
+ * and 40 more for every value in it.
+ *
+ * insert_sorted keeps the values in ascending order without duplicates, which gives the list the
+ * semantics of a std::set with the memory of an array; lookups are binary searches.
+ *
+ * Only values that are copied and destroyed trivially, such as ids and plain structs of them, are
+ * supported, so moving values never runs user code and clearing never has to visit them.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+template <typename T, uint32_t N>
+class SmallVector
+{
+    static_assert(N > 0, "a SmallVector needs room for at least one value in place");
+    static_assert(std::is_trivially_copy_constructible<T>::value && std::is_trivially_destructible<T>::value,
+                  "SmallVector only holds values that are copied and destroyed trivially");
+
+public:
+    SmallVector() = default;
+
+    /**
+     * @brief Copies a list, into place if it fits.
+     *
+     * @param other The list to copy.
+     */
+    SmallVector(const SmallVector &other)
+    {
+        assign(other.begin(), other.end());
+    }
+
+    /**
+     * @brief Takes over a list, its heap block if it has one.
+     *
+     * @param other The list to take, left empty.
+     */
+    SmallVector(SmallVector &&other) noexcept
+    {
+        take(other);
+    }
+
+    /**
+     * @brief Replaces the values with copies of another list's.
+     *
+     * @param other The list to copy.
+     * @return This list.
+     */
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if (this != &other)
+        {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Replaces the values with another list's, taking over its heap block if it has one.
+     *
+     * @param other The list to take, left empty.
+     * @return This list.
+     */
+    SmallVector &operator=(SmallVector &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~SmallVector()
+    {
+        release();
+    }
+
+    /**
+     * @brief Replaces the values with those of a range.
+     *
+     * @param first The first value of the range.
+     * @param last One past the last value of the range.
+     */
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last)
+    {
+        count = 0;
+        reserve((size_t)std::distance(first, last));
+        std::uninitialized_copy(first, last, data());
+        count = (uint32_t)std::distance(first, last);
+    }
+
+    /**
+     * @brief Makes room for a number of values, so adding up to that many doesn't allocate.
+     *
+     * @param wanted The number of values.
+     */
+    void reserve(size_t wanted)
+    {
+        if (wanted > capacity)
+        {
+            grow(wanted);
+        }
+    }
+
+    /**
+     * @brief Appends a value.
+     *
+     * @param value The value.
+     */
+    void push_back(const T &value)
+    {
+        if (count == capacity)
+        {
+            grow((size_t)count + 1);
+        }
+        ::new (static_cast<void *>(data() + count)) T(value);
+        count++;
+    }
+
+    /**
+     * @brief Inserts a value before a position, moving the values from there on up by one.
+     *
+     * @param position Where the value goes, between begin and end.
+     * @param value The value.
+     * @return Where the value is now.
+     */
+    T *insert(const T *position, const T &value)
+    {
+        size_t at = position - data();
+        T copy = value; // the value may live in this list, which growing would free
+        if (count == capacity)
+        {
+            grow((size_t)count + 1);
+        }
+        T *values = data();
+        for (size_t i = count; i > at; --i)
+        {
+            ::new (static_cast<void *>(values + i)) T(values[i - 1]);
+        }
+        ::new (static_cast<void *>(values + at)) T(copy);
+        count++;
+        return values + at;
+    }
+
+    /**
+     * @brief Adds a value to a list kept in ascending order, unless it is there already.
+     *
+     * @param value The value.
+     * @return true if the value was new, false if it was already in the list.
+     */
+    bool insert_sorted(const T &value)
+    {
+        const T *position = std::lower_bound(begin(), end(), value);
+        if (position != end() && !(value < *position))
+        {
+            return false;
+        }
+        insert(position, value);
+        return true;
+    }
+
+    /**
+     * @brief Checks if a list kept in ascending order holds a value.
+     *
+     * @param value The value.
+     * @return true if the value is in the list.
+     */
+    bool contains_sorted(const T &value) const
+    {
+        return std::binary_search(begin(), end(), value);
+    }
+
+    /**
+     * @brief Removes every value, keeping the heap block if there is one.
+     */
+    void clear()
+    {
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T *data() { return capacity > N ? storage.heap : local(); }
+    const T *data() const { return capacity > N ? storage.heap : local(); }
+    T *begin() { return data(); }
+    T *end() { return data() + count; }
+    const T *begin() const { return data(); }
+    const T *end() const { return data() + count; }
+    T &operator[](size_t i) { return data()[i]; }
+    const T &operator[](size_t i) const { return data()[i]; }
+
+private:
+    union Storage
+    {
+        alignas(T) unsigned char local[sizeof(T) * N]; // the values while there are at most N
+        T *heap;                                       // the values once they outgrew local
+    };
+
+    uint32_t count = 0;    // values in the list
+    uint32_t capacity = N; // values that fit before the next growth, N while they are in place
+    Storage storage;
+
+    T *local() { return std::launder(reinterpret_cast<T *>(storage.local)); }
+    const T *local() const { return std::launder(reinterpret_cast<const T *>(storage.local)); }
+
+    /**
+     * @brief Moves the values to a heap block with room for at least a number of values.
+     *
+     * @param wanted The number of values.
+     */
+    void grow(size_t wanted)
+    {
+        size_t grown = std::max(wanted, (size_t)capacity * 2);
+        T *block = std::allocator<T>().allocate(grown);
+        std::uninitialized_copy(begin(), end(), block);
+        release();
+        storage.heap = block;
+        capacity = (uint32_t)grown;
+    }
+
+    /**
+     * @brief Frees the heap block if there is one, the values are left in neither place.
+     */
+    void release()
+    {
+        if (capacity > N)
+        {
+            std::allocator<T>().deallocate(storage.heap, capacity);
+            capacity = N;
+        }
+    }
+
+    /**
+     * @brief Takes the values of another list, which must not hold a heap block of this one.
+     *
+     * @param other The list, left empty.
+     */
+    void take(SmallVector &other)
+    {
+        if (other.capacity > N)
+        {
+            storage.heap = other.storage.heap;
+            capacity = other.capacity;
+            other.capacity = N;
+        }
+        else
+        {
+            std::uninitialized_copy(other.begin(), other.end(), local());
+        }
+        count = other.count;
+        other.count = 0;
+    }
+};
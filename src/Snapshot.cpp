@@ -0,0 +1,177 @@
+/**
+ * @file Snapshot.cpp
+ * @brief Implements the little-endian field encoding of snapshots.
+ */
+
+#include "Snapshot.h"
+
+/**
+ * @brief Computes the checksum stored at the end of a snapshot, 32-bit FNV-1a.
+ *
+ * @param data The bytes to check.
+ * @return The checksum of the bytes.
+ */
+uint32_t Snapshot::checksum(std::string_view data)
+{
+    uint32_t h = 2166136261u;
+    for (char c : data)
+    {
+        h ^= (unsigned char)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Creates a writer appending to a string.
+ *
+ * @param target The string the fields are appended to.
+ */
+SnapshotWriter::SnapshotWriter(std::string &target) : target(target)
+{
+}
+
+/**
+ * @brief Appends a 32-bit unsigned integer, least significant byte first.
+ *
+ * @param value The value to append.
+ */
+void SnapshotWriter::u32(uint32_t value)
+{
+    char bytes[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        bytes[i] = (char)(value >> (8 * i));
+    }
+    target.append(bytes, 4);
+}
+
+/**
+ * @brief Appends a 64-bit unsigned integer, least significant byte first.
+ *
+ * @param value The value to append.
+ */
+void SnapshotWriter::u64(uint64_t value)
+{
+    u32((uint32_t)value);
+    u32((uint32_t)(value >> 32));
+}
+
+/**
+ * @brief Appends a text as its length followed by its bytes.
+ *
+ * @param value The text to append.
+ */
+void SnapshotWriter::text(std::string_view value)
+{
+    u32((uint32_t)value.size());
+    target.append(value);
+}
+
+/**
+ * @brief Appends bytes as they are, without their length.
+ *
+ * @param bytes The bytes to append.
+ */
+void SnapshotWriter::raw(std::string_view bytes)
+{
+    target.append(bytes);
+}
+
+/**
+ * @brief Creates a reader over the bytes of a snapshot.
+ *
+ * @param data The snapshot, which must outlive the views returned by text and raw.
+ */
+SnapshotReader::SnapshotReader(std::string_view data) : data(data)
+{
+}
+
+/**
+ * @brief Reads a 32-bit unsigned integer written by SnapshotWriter::u32.
+ *
+ * @param value Set to the value read.
+ * @return false if the snapshot ends before the field, true otherwise.
+ */
+bool SnapshotReader::u32(uint32_t &value)
+{
+    if (data.size() < 4)
+    {
+        return false;
+    }
+    uint32_t result = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        result |= (uint32_t)(unsigned char)data[i] << (8 * i);
+    }
+    value = result;
+    data.remove_prefix(4);
+    return true;
+}
+
+/**
+ * @brief Reads a 64-bit unsigned integer written by SnapshotWriter::u64.
+ *
+ * @param value Set to the value read.
+ * @return false if the snapshot ends before the field, true otherwise.
+ */
+bool SnapshotReader::u64(uint64_t &value)
+{
+    if (data.size() < 8)
+    {
+        return false;
+    }
+    uint32_t low = 0;
+    uint32_t high = 0;
+    u32(low);
+    u32(high);
+    value = (uint64_t)high << 32 | low;
+    return true;
+}
+
+/**
+ * @brief Reads a text written by SnapshotWriter::text.
+ *
+ * @param value Set to a view of the text inside the snapshot.
+ * @return false if the snapshot ends before the field, true otherwise.
+ */
+bool SnapshotReader::text(std::string_view &value)
+{
+    std::string_view rest = data;
+    uint32_t size = 0;
+    if (!u32(size) || data.size() < size)
+    {
+        data = rest;
+        return false;
+    }
+    value = data.substr(0, size);
+    data.remove_prefix(size);
+    return true;
+}
+
+/**
+ * @brief Reads a given number of bytes.
+ *
+ * @param size The number of bytes to read.
+ * @param bytes Set to a view of the bytes inside the snapshot.
+ * @return false if the snapshot ends before the field, true otherwise.
+ */
+bool SnapshotReader::raw(size_t size, std::string_view &bytes)
+{
+    if (data.size() < size)
+    {
+        return false;
+    }
+    bytes = data.substr(0, size);
+    data.remove_prefix(size);
+    return true;
+}
+
+/**
+ * @brief Gets the number of bytes that were not read yet.
+ * @return The number of remaining bytes.
+ */
+size_t SnapshotReader::remaining() const
+{
+    return data.size();
+}
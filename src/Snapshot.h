@@ -0,0 +1,69 @@
+/**
+ * @file Snapshot.h
+ * @brief Encoding of the compact binary snapshots a Session can be saved to and restored from.
+ *
+ * A snapshot is a flat sequence of little-endian fields, so it can be decoded straight out of a
+ * memory-mapped file without parsing text or copying the file into a buffer first:
+ *
+ * - the 8-byte magic "WTSNAP\0\0", the format version and the number of lines the session had
+ *   executed when the snapshot was taken;
+ * - the symbol table, every name in the order of its id;
+ * - the ingredient, trophy and potion counts, the potion formulas and the bestiary, all keyed
+ *   on those ids;
+ * - an FNV-1a checksum of everything before it, so a truncated or damaged file is rejected.
+ *
+ * SnapshotWriter appends fields to a string, and SnapshotReader reads them back from a view,
+ * failing instead of reading past the end. Restoring only touches each entry of the state once,
+ * so its cost follows the size of the state, not the length of the log that produced it.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Snapshot
+{
+    constexpr std::string_view magic{"WTSNAP\0\0", 8}; // first bytes of every snapshot
+    constexpr uint32_t version = 1;                    // bumped whenever the layout changes
+
+    uint32_t checksum(std::string_view data);
+}
+
+/**
+ * @class SnapshotWriter
+ * @brief Appends the fields of a snapshot to a string.
+ */
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::string &target);
+    void u32(uint32_t value);
+    void u64(uint64_t value);
+    void text(std::string_view value);
+    void raw(std::string_view bytes);
+
+private:
+    std::string &target; // the snapshot being written
+};
+
+/**
+ * @class SnapshotReader
+ * @brief Reads the fields of a snapshot from a view of its bytes.
+ *
+ * Every read returns false, and leaves its output untouched, if the snapshot ends before the
+ * field does. Texts are returned as views into the snapshot, so they stay valid as long as it does.
+ */
+class SnapshotReader
+{
+public:
+    explicit SnapshotReader(std::string_view data);
+    bool u32(uint32_t &value);
+    bool u64(uint64_t &value);
+    bool text(std::string_view &value);
+    bool raw(size_t size, std::string_view &bytes);
+    size_t remaining() const;
+
+private:
+    std::string_view data; // the bytes that were not read yet
+};
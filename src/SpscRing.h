@@ -0,0 +1,114 @@
+/**
+ * @class SpscRing
+ * @brief Bounded lock-free queue between exactly one producer thread and one consumer thread.
+ *
+ * The ring holds up to a power-of-two number of values in a fixed array. The producer only
+ * writes the tail index and the consumer only writes the head index, each with release
+ * ordering, so a value is fully written before the other side can see it and no lock is needed.
+ * Both indexes live on their own cache line, so the two threads don't invalidate each other's
+ * line on every operation.
+ *
+ * try_push and try_pop never block. push and pop retry until they succeed, yielding the
+ * processor in between, which suits pipeline stages that would otherwise idle.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class SpscRing
+{
+public:
+    /**
+     * @brief Creates an empty ring.
+     *
+     * @param capacity The number of values the ring can hold, rounded up to a power of two.
+     */
+    explicit SpscRing(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+        values.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /**
+     * @brief Adds a value if the ring isn't full. Only the producer thread may call this.
+     *
+     * @param value The value to add, moved from only on success.
+     * @return true if the value was added, false if the ring is full.
+     */
+    bool try_push(T &value)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask)
+        {
+            return false;
+        }
+        values[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest value if there is one. Only the consumer thread may call this.
+     *
+     * @param value Set to the removed value.
+     * @return true if a value was removed, false if the ring is empty.
+     */
+    bool try_pop(T &value)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = std::move(values[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Adds a value, waiting while the ring is full.
+     *
+     * @param value The value to add.
+     */
+    void push(T value)
+    {
+        while (!try_push(value))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Removes the oldest value, waiting while the ring is empty.
+     *
+     * @return The removed value.
+     */
+    T pop()
+    {
+        T value;
+        while (!try_pop(value))
+        {
+            std::this_thread::yield();
+        }
+        return value;
+    }
+
+private:
+    std::vector<T> values; // the slots, indexed by position & mask
+    size_t mask = 0;       // number of slots minus one
+    alignas(64) std::atomic<size_t> head{0}; // position of the oldest value, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0}; // position after the newest value, written by the producer
+};
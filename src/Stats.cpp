@@ -0,0 +1,381 @@
+/**
+ * @file Stats.cpp
+ * @brief Implements the latency histograms and their JSON rendering.
+ */
+
+#include "Stats.h"
+#include <charconv>
+
+namespace
+{
+    /**
+     * @brief How a command type appears in the JSON: its name, and the code the detector returns for it.
+     */
+    struct TypeInfo
+    {
+        const char *name;
+        const char *kind; // "sentence", "question" or "other"
+        int code;         // return code of detect_sentence_type or detect_question_type, -1 for others
+    };
+
+    // indexed by CommandType
+    const TypeInfo type_info[Stats::type_count] = {
+        {"invalid", "other", -1},
+        {"exit", "other", -1},
+        {"loot", "sentence", 0},
+        {"trade", "sentence", 1},
+        {"brew", "sentence", 2},
+        {"brew_batch", "sentence", 7},
+        {"sign_knowledge", "sentence", 3},
+        {"potion_knowledge", "sentence", 4},
+        {"potion_recipe", "sentence", 5},
+        {"encounter", "sentence", 6},
+        {"ingredient_count", "question", 0},
+        {"total_ingredients", "question", 1},
+        {"potion_count", "question", 2},
+        {"total_potions", "question", 3},
+        {"trophy_count", "question", 4},
+        {"total_trophies", "question", 5},
+        {"monster_knowledge", "question", 6},
+        {"potion_formula", "question", 7},
+    };
+
+    /**
+     * @brief Appends an unsigned integer in decimal.
+     */
+    void append_number(std::string &out, uint64_t value)
+    {
+        char digits[24];
+        char *end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out.append(digits, end);
+    }
+
+    /**
+     * @brief Appends a signed integer in decimal.
+     */
+    void append_number(std::string &out, int value)
+    {
+        char digits[16];
+        char *end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out.append(digits, end);
+    }
+
+    /**
+     * @brief Appends `"key":`.
+     */
+    void append_key(std::string &out, const char *key)
+    {
+        out += '"';
+        out += key;
+        out += "\":";
+    }
+}
+
+/**
+ * @brief Finds the bucket a value is counted in.
+ *
+ * Values below sub_buckets are their own bucket. Above that, the position of the highest set bit
+ * picks a power of two, and the next sub_bucket_bits bits pick one of its buckets.
+ *
+ * @param value The value.
+ * @return The index of its bucket.
+ */
+int LatencyHistogram::bucket_of(uint64_t value)
+{
+    if (value < (uint64_t)sub_buckets)
+    {
+        return (int)value;
+    }
+    int magnitude = 63 - __builtin_clzll(value);
+    int shift = magnitude - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + (int)((value >> shift) - sub_buckets);
+}
+
+/**
+ * @brief Gets the smallest value a bucket counts.
+ *
+ * @param bucket The index of the bucket.
+ * @return The smallest value counted in it.
+ */
+uint64_t LatencyHistogram::lowest_in(int bucket)
+{
+    int power = bucket / sub_buckets;
+    uint64_t sub = bucket % sub_buckets;
+    if (power == 0)
+    {
+        return sub;
+    }
+    return (sub_buckets + sub) << (power - 1);
+}
+
+/**
+ * @brief Gets the largest value a bucket counts.
+ *
+ * @param bucket The index of the bucket.
+ * @return The largest value counted in it.
+ */
+uint64_t LatencyHistogram::highest_in(int bucket)
+{
+    int power = bucket / sub_buckets;
+    if (power == 0)
+    {
+        return lowest_in(bucket);
+    }
+    return lowest_in(bucket) + ((uint64_t)1 << (power - 1)) - 1;
+}
+
+/**
+ * @brief Records a value.
+ *
+ * @param value The value, a latency in nanoseconds.
+ */
+void LatencyHistogram::record(uint64_t value)
+{
+    counts[bucket_of(value)]++;
+    total++;
+    value_sum += value;
+    smallest = value < smallest ? value : smallest;
+    largest = value > largest ? value : largest;
+}
+
+/**
+ * @brief Gets the number of recorded values.
+ * @return The number of values.
+ */
+uint64_t LatencyHistogram::count() const
+{
+    return total;
+}
+
+/**
+ * @brief Gets the smallest recorded value.
+ * @return The value, or 0 if nothing was recorded.
+ */
+uint64_t LatencyHistogram::min() const
+{
+    return total == 0 ? 0 : smallest;
+}
+
+/**
+ * @brief Gets the largest recorded value.
+ * @return The value, or 0 if nothing was recorded.
+ */
+uint64_t LatencyHistogram::max() const
+{
+    return largest;
+}
+
+/**
+ * @brief Gets the sum of the recorded values.
+ * @return The sum.
+ */
+uint64_t LatencyHistogram::sum() const
+{
+    return value_sum;
+}
+
+/**
+ * @brief Gets the value below or at which a given share of the recorded values lie.
+ *
+ * As in an HDR histogram the answer is the largest value of the bucket the percentile falls in,
+ * but never more than the largest value recorded, so it is at most 1/16 above the exact one.
+ *
+ * @param percentile The share, from 0 to 100.
+ * @return The value, or 0 if nothing was recorded.
+ */
+uint64_t LatencyHistogram::value_at_percentile(double percentile) const
+{
+    if (total == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * total + 0.999999);
+    rank = rank == 0 ? 1 : (rank > total ? total : rank);
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < bucket_count; ++bucket)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+        {
+            uint64_t highest = highest_in(bucket);
+            return highest < largest ? highest : largest;
+        }
+    }
+    return largest;
+}
+
+/**
+ * @brief Appends the histogram as a JSON object.
+ *
+ * The object holds the count, min, max, mean and a few percentiles, and the non-empty buckets as
+ * [lowest value, count] pairs, from which any other percentile can be computed.
+ *
+ * @param out The string the object is appended to.
+ */
+void LatencyHistogram::write_json(std::string &out) const
+{
+    static const struct
+    {
+        const char *key;
+        double percentile;
+    } percentiles[] = {{"p50", 50}, {"p90", 90}, {"p99", 99}, {"p999", 99.9}};
+
+    out += '{';
+    append_key(out, "count");
+    append_number(out, total);
+    out += ',';
+    append_key(out, "min");
+    append_number(out, min());
+    out += ',';
+    append_key(out, "max");
+    append_number(out, max());
+    out += ',';
+    append_key(out, "mean");
+    append_number(out, total == 0 ? 0 : value_sum / total);
+    for (const auto &p : percentiles)
+    {
+        out += ',';
+        append_key(out, p.key);
+        append_number(out, value_at_percentile(p.percentile));
+    }
+    out += ',';
+    append_key(out, "buckets");
+    out += '[';
+    bool first = true;
+    for (int bucket = 0; bucket < bucket_count; ++bucket)
+    {
+        if (counts[bucket] == 0)
+        {
+            continue;
+        }
+        out += first ? "[" : ",[";
+        append_number(out, lowest_in(bucket));
+        out += ',';
+        append_number(out, counts[bucket]);
+        out += ']';
+        first = false;
+    }
+    out += "]}";
+}
+
+/**
+ * @brief Counts an executed line.
+ *
+ * @param type The type the line was parsed to.
+ */
+void Stats::count(CommandType type)
+{
+    counts[(int)type]++;
+}
+
+/**
+ * @brief Gets the number of executed lines of a type.
+ *
+ * @param type The command type.
+ * @return The number of lines.
+ */
+uint64_t Stats::executed(CommandType type) const
+{
+    return counts[(int)type];
+}
+
+/**
+ * @brief Gets the histogram of execute_line latencies for a type.
+ *
+ * @param type The type the lines were parsed to.
+ * @return The histogram, in nanoseconds.
+ */
+LatencyHistogram &Stats::line(CommandType type)
+{
+    return lines[(int)type];
+}
+
+/**
+ * @brief Gets the histogram of inventory method latencies for a type.
+ *
+ * @param type The command type.
+ * @return The histogram, in nanoseconds.
+ */
+LatencyHistogram &Stats::handler(CommandType type)
+{
+    return handlers[(int)type];
+}
+
+/**
+ * @brief Gets the histogram of execute_line latencies for a type.
+ *
+ * @param type The type the lines were parsed to.
+ * @return The histogram, in nanoseconds.
+ */
+const LatencyHistogram &Stats::line(CommandType type) const
+{
+    return lines[(int)type];
+}
+
+/**
+ * @brief Gets the histogram of inventory method latencies for a type.
+ *
+ * @param type The command type.
+ * @return The histogram, in nanoseconds.
+ */
+const LatencyHistogram &Stats::handler(CommandType type) const
+{
+    return handlers[(int)type];
+}
+
+/**
+ * @brief Writes every counter and histogram as one JSON object.
+ *
+ * The object has the total number of lines, the number of invalid ones, and an entry per command
+ * type with its detector code, its count and both of its histograms:
+ *
+ *     {"lines":N,"invalid":N,"types":{"loot":{"kind":"sentence","code":0,"count":N,
+ *      "line_ns":{...},"handler_ns":{...}},...}}
+ *
+ * @param out The string the JSON is written to, replacing its contents.
+ */
+void Stats::write_json(std::string &out) const
+{
+    uint64_t total = 0;
+    for (uint64_t c : counts)
+    {
+        total += c;
+    }
+
+    out.clear();
+    out += '{';
+    append_key(out, "lines");
+    append_number(out, total);
+    out += ',';
+    append_key(out, "invalid");
+    append_number(out, counts[(int)CommandType::Invalid]);
+    out += ',';
+    append_key(out, "types");
+    out += '{';
+    for (int type = 0; type < type_count; ++type)
+    {
+        if (type > 0)
+        {
+            out += ',';
+        }
+        append_key(out, type_info[type].name);
+        out += '{';
+        append_key(out, "kind");
+        out += '"';
+        out += type_info[type].kind;
+        out += "\",";
+        append_key(out, "code");
+        append_number(out, type_info[type].code);
+        out += ',';
+        append_key(out, "count");
+        append_number(out, counts[type]);
+        out += ',';
+        append_key(out, "line_ns");
+        lines[type].write_json(out);
+        out += ',';
+        append_key(out, "handler_ns");
+        handlers[type].write_json(out);
+        out += '}';
+    }
+    out += "}}\n";
+}
@@ -0,0 +1,114 @@
+/**
+ * @file Stats.h
+ * @brief Per-command counters and latency histograms, compiled in with WITCHER_STATS.
+ *
+ * A Session built with WITCHER_STATS counts every line it executes by CommandType, which maps one
+ * to one onto the codes detect_sentence_type and detect_question_type return, with invalid lines
+ * under CommandType::Invalid. It also times every line it executes through execute_line, from
+ * parsing to the last response, and separately the inventory method that handles the command,
+ * into histograms kept per type. Lines a Pipeline parsed on other threads only have the handler
+ * timed. write_json renders all of it as one JSON object.
+ *
+ * Without WITCHER_STATS the macros below expand to nothing, so the hot path carries no clock
+ * reads or counters at all, and Session has no Stats member.
+ *
+ * LatencyHistogram is log-linear like an HDR histogram: values below 16 ns have a bucket each,
+ * and every power of two above is split into 16 buckets, so a recorded value is known to within
+ * 1/16 of itself over the whole 64-bit range, in under 8 KB of counts.
+ */
+
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "Command.h"
+
+class LatencyHistogram
+{
+public:
+    static constexpr int sub_bucket_bits = 4;                 // log2 of the buckets per power of two
+    static constexpr int sub_buckets = 1 << sub_bucket_bits;  // buckets per power of two
+    static constexpr int bucket_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    void record(uint64_t value);
+    uint64_t count() const;
+    uint64_t min() const;
+    uint64_t max() const;
+    uint64_t sum() const;
+    uint64_t value_at_percentile(double percentile) const;
+    void write_json(std::string &out) const;
+
+    static int bucket_of(uint64_t value);
+    static uint64_t lowest_in(int bucket);
+    static uint64_t highest_in(int bucket);
+
+private:
+    std::array<uint64_t, bucket_count> counts{}; // number of recorded values per bucket
+    uint64_t total = 0;                          // number of recorded values
+    uint64_t smallest = UINT64_MAX;              // smallest recorded value
+    uint64_t largest = 0;                        // largest recorded value
+    uint64_t value_sum = 0;                      // sum of the recorded values, for the mean
+};
+
+class Stats
+{
+public:
+    static constexpr int type_count = (int)CommandType::PotionFormula + 1;
+
+    void count(CommandType type);
+    uint64_t executed(CommandType type) const;
+    LatencyHistogram &line(CommandType type);
+    LatencyHistogram &handler(CommandType type);
+    const LatencyHistogram &line(CommandType type) const;
+    const LatencyHistogram &handler(CommandType type) const;
+    void write_json(std::string &out) const;
+
+    /**
+     * @brief Reads the monotonic clock the histograms are recorded with.
+     * @return The time in nanoseconds since an arbitrary epoch.
+     */
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    std::array<uint64_t, type_count> counts{};          // lines executed, by command type
+    std::array<LatencyHistogram, type_count> lines;    // execute_line latency, by the type the line parsed to
+    std::array<LatencyHistogram, type_count> handlers; // inventory method latency, by command type
+};
+
+/**
+ * @class StatsTimer
+ * @brief Records the time from its construction to its destruction in a histogram.
+ */
+class StatsTimer
+{
+public:
+    explicit StatsTimer(LatencyHistogram &histogram) : histogram(histogram), start(Stats::now())
+    {
+    }
+    ~StatsTimer()
+    {
+        histogram.record(Stats::now() - start);
+    }
+    StatsTimer(const StatsTimer &) = delete;
+    StatsTimer &operator=(const StatsTimer &) = delete;
+
+private:
+    LatencyHistogram &histogram; // where the elapsed time goes
+    uint64_t start;              // when the timer was created
+};
+
+#ifdef WITCHER_STATS
+// times the rest of the enclosing scope into a histogram
+#define WITCHER_STATS_SCOPE(histogram) StatsTimer witcher_stats_timer(histogram)
+// keeps a statement only in instrumented builds
+#define WITCHER_STATS_ONLY(...) __VA_ARGS__
+#else
+#define WITCHER_STATS_SCOPE(histogram)
+#define WITCHER_STATS_ONLY(...)
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file SymbolTable.cpp
+ * @brief Implements name interning with an open-addressing hash table.
+ */
+
+#include "SymbolTable.h"
+
+/**
+ * @brief Creates an empty symbol table.
+ */
+SymbolTable::SymbolTable() : slots(64, none)
+{
+}
+
+/**
+ * @brief Hashes a name with 32-bit FNV-1a.
+ *
+ * @param name The name to hash.
+ * @return The hash of the name.
+ */
+uint32_t SymbolTable::hash(std::string_view name)
+{
+    uint32_t h = 2166136261u;
+    for (char c : name)
+    {
+        h ^= (unsigned char)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Finds the slot holding a name, or the empty slot where it would be inserted.
+ *
+ * Collisions are resolved by linear probing.
+ *
+ * @param name The name to look for.
+ * @param name_hash The hash of the name.
+ * @return The index of the slot in slots.
+ */
+size_t SymbolTable::find_slot(std::string_view name, uint32_t name_hash) const
+{
+    size_t mask = slots.size() - 1;
+    size_t i = name_hash & mask;
+    while (slots[i] != none)
+    {
+        Id id = slots[i];
+        if (hashes[id] == name_hash && names[id] == name)
+        {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * @brief Doubles the number of slots and reinserts every id.
+ *
+ * @note This method modifies the slots in place.
+ */
+void SymbolTable::grow()
+{
+    std::vector<Id> larger(slots.size() * 2, none);
+    slots.swap(larger);
+    size_t mask = slots.size() - 1;
+    for (Id id = 0; id < names.size(); ++id)
+    {
+        size_t i = hashes[id] & mask;
+        while (slots[i] != none)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+}
+
+/**
+ * @brief Gets the id of a name, giving it a new id if it wasn't seen before.
+ *
+ * @param name The name to intern.
+ * @return The id of the name.
+ */
+Id SymbolTable::intern(std::string_view name)
+{
+    uint32_t name_hash = hash(name);
+    size_t i = find_slot(name, name_hash);
+    if (slots[i] != none)
+    {
+        return slots[i];
+    }
+
+    Id id = names.size();
+    names.emplace_back(name);
+    hashes.push_back(name_hash);
+    slots[i] = id;
+
+    // keep the table at most half full, so probe sequences stay short
+    if (names.size() * 2 > slots.size())
+    {
+        grow();
+    }
+    return id;
+}
+
+/**
+ * @brief Gets the id of a name without interning it.
+ *
+ * @param name The name to look for.
+ * @return The id of the name, or SymbolTable::none if it was never interned.
+ */
+Id SymbolTable::find(std::string_view name) const
+{
+    return slots[find_slot(name, hash(name))];
+}
+
+/**
+ * @brief Gets the name of an id.
+ *
+ * @param id An id returned by intern.
+ * @return The name the id was given for.
+ */
+const std::string &SymbolTable::name(Id id) const
+{
+    return names[id];
+}
+
+/**
+ * @brief Gets the number of interned names.
+ * @return The number of ids given out so far.
+ */
+size_t SymbolTable::size() const
+{
+    return names.size();
+}
@@ -0,0 +1,39 @@
+/**
+ * @class SymbolTable
+ * @brief Interns names of ingredients, trophies, potions, signs and monsters as dense integer ids.
+ *
+ * Every distinct name is stored once and gets the next free id, starting from 0. Inventory keys
+ * its state on these ids, so a lookup is an integer comparison instead of a string comparison.
+ * Names are hashed into an open-addressing table, and lookups by std::string_view don't allocate.
+ *
+ * Ids are never reused or removed, and the name of an id never changes.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using Id = uint32_t;
+
+class SymbolTable
+{
+public:
+    static constexpr Id none = UINT32_MAX; // returned by find for names that were never interned
+
+    SymbolTable();
+    Id intern(std::string_view name);
+    Id find(std::string_view name) const;
+    const std::string &name(Id id) const;
+    size_t size() const;
+    static uint32_t hash(std::string_view name);
+
+private:
+    std::vector<std::string> names; // name of each id
+    std::vector<uint32_t> hashes;   // hash of each id's name, kept to rehash without recomputing
+    std::vector<Id> slots;          // open-addressing table of ids, its size is always a power of two
+
+    size_t find_slot(std::string_view name, uint32_t name_hash) const;
+    void grow();
+};
@@ -0,0 +1,203 @@
+/**
+ * @file TotalsCache.cpp
+ * @brief Implements the segmented rendering cache of the totals answers.
+ */
+
+#include "TotalsCache.h"
+#include <algorithm>
+#include <charconv>
+
+/**
+ * @brief Creates an empty cache, for an empty CountStore.
+ *
+ * @param symbols The table the ids of the counts are interned in.
+ */
+TotalsCache::TotalsCache(const SymbolTable &symbols) : symbols(symbols)
+{
+}
+
+/**
+ * @brief Gets the name that sorts last in a block.
+ *
+ * @param block The block.
+ * @return The name of the last entry of its last segment.
+ */
+const std::string &TotalsCache::last_name(const Block &block) const
+{
+    return symbols.name(block.segments.back().ids.back());
+}
+
+/**
+ * @brief Records a change of one count.
+ *
+ * The entry goes to the first block, and within it to the first segment, whose last name does not
+ * sort before its name, or to the last one if every name sorts before it.
+ *
+ * @param id The id whose count changed.
+ * @param before The count before the change, 0 if the id was not present.
+ * @param after The count after the change, 0 if the id was removed.
+ */
+void TotalsCache::changed(Id id, int before, int after)
+{
+    bool was_present = before > 0;
+    bool is_present = after > 0;
+    if (before == after || (!was_present && !is_present))
+    {
+        return;
+    }
+    if (blocks.empty())
+    {
+        blocks.emplace_back();
+        blocks.back().segments.emplace_back();
+        blocks.back().segments.back().ids.push_back(id);
+        return;
+    }
+
+    const std::string &name = symbols.name(id);
+    auto block_it = std::lower_bound(blocks.begin(), blocks.end(), name, [this](const Block &block, const std::string &key)
+                                     { return last_name(block) < key; });
+    size_t block_index = block_it == blocks.end() ? blocks.size() - 1 : block_it - blocks.begin();
+    Block &block = blocks[block_index];
+    std::vector<Segment> &segments = block.segments;
+    auto it = std::lower_bound(segments.begin(), segments.end(), name, [this](const Segment &segment, const std::string &key)
+                               { return symbols.name(segment.ids.back()) < key; });
+    size_t index = it == segments.end() ? segments.size() - 1 : it - segments.begin();
+    Segment &segment = segments[index];
+    segment.dirty = true;
+    block.published = nullptr;
+    if (was_present && is_present)
+    {
+        return;
+    }
+
+    auto position = std::lower_bound(segment.ids.begin(), segment.ids.end(), name, [this](Id a, const std::string &key)
+                                     { return symbols.name(a) < key; });
+    if (is_present)
+    {
+        segment.ids.insert(position, id);
+        if (segment.ids.size() > max_segment_size)
+        {
+            // move the upper half into a new segment right after this one
+            Segment upper;
+            upper.ids.assign(segment.ids.begin() + segment.ids.size() / 2, segment.ids.end());
+            segment.ids.resize(segment.ids.size() / 2);
+            segments.insert(segments.begin() + index + 1, std::move(upper));
+            if (segments.size() > max_block_size)
+            {
+                // and the upper half of the segments into a new block right after this one
+                Block upper_block;
+                upper_block.segments.assign(std::make_move_iterator(segments.begin() + segments.size() / 2),
+                                            std::make_move_iterator(segments.end()));
+                segments.resize(segments.size() / 2);
+                blocks.insert(blocks.begin() + block_index + 1, std::move(upper_block));
+            }
+        }
+    }
+    else
+    {
+        segment.ids.erase(position);
+        if (segment.ids.empty())
+        {
+            segments.erase(segments.begin() + index);
+            if (segments.empty())
+            {
+                blocks.erase(blocks.begin() + block_index);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Renders the entries of one segment.
+ *
+ * @param segment The segment to render.
+ * @param counts The counts to render.
+ */
+void TotalsCache::render(Segment &segment, const CountStore &counts)
+{
+    std::string &text = segment.text;
+    text.clear();
+    for (size_t i = 0; i < segment.ids.size(); ++i)
+    {
+        if (i > 0)
+        {
+            text += ", ";
+        }
+        char digits[16];
+        char *end = std::to_chars(digits, digits + sizeof(digits), counts.get(segment.ids[i])).ptr;
+        text.append(digits, end);
+        text += ' ';
+        text += symbols.name(segment.ids[i]);
+    }
+    segment.dirty = false;
+    segment.published = nullptr;
+}
+
+/**
+ * @brief Writes the totals answer, rendering only the segments that changed.
+ *
+ * @param out The sink to write to.
+ * @param counts The counts to list. Every change to them must have been reported through changed.
+ */
+void TotalsCache::write(OutputSink &out, const CountStore &counts)
+{
+    if (blocks.empty())
+    {
+        out << "None\n";
+        return;
+    }
+    bool first = true;
+    for (Block &block : blocks)
+    {
+        for (Segment &segment : block.segments)
+        {
+            if (segment.dirty)
+            {
+                render(segment, counts);
+            }
+            if (!first)
+            {
+                out << ", ";
+            }
+            out << segment.text;
+            first = false;
+        }
+    }
+    out << "\n";
+}
+
+/**
+ * @brief Gets the totals answer as shared runs of segment texts, rendering only the segments that changed.
+ *
+ * The answer is the texts of every run joined by ", " and ended with '\n', or "None\n" if there are no runs.
+ *
+ * @param runs Set to the run of every block, in order. A run never changes once handed out.
+ * @param counts The counts to list. Every change to them must have been reported through changed.
+ */
+void TotalsCache::publish(std::vector<std::shared_ptr<const Run>> &runs, const CountStore &counts)
+{
+    runs.clear();
+    runs.reserve(blocks.size());
+    for (Block &block : blocks)
+    {
+        if (block.published == nullptr)
+        {
+            auto run = std::make_shared<Run>();
+            run->reserve(block.segments.size());
+            for (Segment &segment : block.segments)
+            {
+                if (segment.dirty)
+                {
+                    render(segment, counts);
+                }
+                if (segment.published == nullptr)
+                {
+                    segment.published = std::make_shared<const std::string>(segment.text);
+                }
+                run->push_back(segment.published);
+            }
+            block.published = std::move(run);
+        }
+        runs.push_back(block.published);
+    }
+}
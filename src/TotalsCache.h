@@ -0,0 +1,65 @@
+/**
+ * @class TotalsCache
+ * @brief Cached rendering of a totals answer such as "Total ingredient ?".
+ *
+ * The answer lists every entry of a CountStore as "<count> <name>" in alphabetical order. The
+ * cache keeps that list as a sequence of segments, like the pieces of a rope: each segment holds
+ * a run of consecutive entries in alphabetical order and their rendered text. The inventory
+ * reports every count change to the cache, and only the segment holding the changed entry is
+ * marked dirty, whether its count changed or it appeared or disappeared. Segments are split when
+ * they grow too long and dropped when they become empty, so no change ever shifts the others.
+ *
+ * A question renders the dirty segments again and writes all of them, so asking twice without a
+ * change in between only writes the cached text.
+ *
+ * The segments are grouped in blocks of consecutive segments, split when they hold too many
+ * segments and dropped when they hold none, so a segment that splits or disappears only shifts
+ * the segments of its own block.
+ *
+ * publish hands out the answer for an InventoryView as one immutable run of shared segment texts
+ * per block. A block makes a new run only the first time it is published after one of its
+ * segments changed, and a segment is copied into a new string only the first time it is
+ * published after it was rendered again, so consecutive views share the runs of every block that
+ * didn't change in between, and publishing copies one pointer per block and the changed blocks.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "CountStore.h"
+#include "OutputSink.h"
+#include "SymbolTable.h"
+
+class TotalsCache
+{
+public:
+    using Run = std::vector<std::shared_ptr<const std::string>>; // the segment texts of one block, in order
+
+    explicit TotalsCache(const SymbolTable &symbols);
+    void changed(Id id, int before, int after);
+    void write(OutputSink &out, const CountStore &counts);
+    void publish(std::vector<std::shared_ptr<const Run>> &runs, const CountStore &counts);
+
+private:
+    static constexpr size_t max_segment_size = 128; // a segment growing past this is split in two
+    static constexpr size_t max_block_size = 64;    // a block growing past this many segments is split in two
+
+    struct Segment
+    {
+        std::vector<Id> ids; // entries in alphabetical order of their names, never empty
+        std::string text;    // rendered entries separated by ", ", valid unless dirty
+        bool dirty = true;
+        std::shared_ptr<const std::string> published; // the text as last published, null if rendered since
+    };
+    struct Block
+    {
+        std::vector<Segment> segments;        // in alphabetical order, never empty
+        std::shared_ptr<const Run> published; // the segments as last published, null if one changed since
+    };
+    const SymbolTable &symbols; // names of the ids, for ordering and rendering
+    std::vector<Block> blocks;  // in alphabetical order, every name of a block sorts before the next one's
+
+    const std::string &last_name(const Block &block) const;
+    void render(Segment &segment, const CountStore &counts);
+};
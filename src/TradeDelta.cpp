@@ -0,0 +1,99 @@
+/**
+ * @file TradeDelta.cpp
+ * @brief Implements the merged, sorted item deltas of trades.
+ */
+
+#include "TradeDelta.h"
+#include <algorithm>
+
+/**
+ * @brief Creates an empty delta.
+ *
+ * @param memory The resource the entries are allocated from. It has to outlive the delta.
+ */
+TradeDelta::TradeDelta(std::pmr::memory_resource *memory) : items(memory)
+{
+}
+
+/**
+ * @brief Removes every entry, keeping the capacity.
+ */
+void TradeDelta::clear()
+{
+    items.clear();
+}
+
+/**
+ * @brief Adds items to the delta without merging them, merge must be called before the delta is used.
+ *
+ * @param added The items, with their ids resolved.
+ */
+void TradeDelta::append(const std::vector<Item> &added)
+{
+    for (const Item &item : added)
+    {
+        items.push_back({item.id, item.count});
+    }
+}
+
+/**
+ * @brief Sorts the entries by id and sums the counts of entries with the same id into one.
+ */
+void TradeDelta::merge()
+{
+    std::sort(items.begin(), items.end(), [](const Entry &a, const Entry &b)
+              { return a.id < b.id; });
+
+    size_t kept = 0;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (kept > 0 && items[kept - 1].id == items[i].id)
+        {
+            items[kept - 1].count += items[i].count;
+        }
+        else
+        {
+            items[kept++] = items[i];
+        }
+    }
+    items.resize(kept);
+}
+
+/**
+ * @brief Replaces the delta with the merged items.
+ *
+ * @param added The items, with their ids resolved.
+ */
+void TradeDelta::assign(const std::vector<Item> &added)
+{
+    clear();
+    append(added);
+    merge();
+}
+
+/**
+ * @brief Checks if a store holds every entry of the delta.
+ *
+ * @param store The store, e.g. the trophies of the inventory.
+ * @return true if the count of every id in the store is at least its count in the delta.
+ */
+bool TradeDelta::covered_by(const CountStore &store) const
+{
+    for (const Entry &entry : items)
+    {
+        if (store.get(entry.id) < entry.count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the entries.
+ * @return The entries, sorted by id with one entry per id if the delta was merged.
+ */
+const std::pmr::vector<TradeDelta::Entry> &TradeDelta::entries() const
+{
+    return items;
+}
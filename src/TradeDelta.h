@@ -0,0 +1,43 @@
+/**
+ * @class TradeDelta
+ * @brief The items a trade moves, merged by id into a short sorted vector.
+ *
+ * A trade names its trophies one by one, and the same trophy can be named more than once. The
+ * delta sums the counts of every id, so "2 Harpy trophy, 2 Harpy trophy" needs four Harpy
+ * trophies, and keeps one entry per id in increasing id order. covered_by then checks the whole
+ * delta against a CountStore in a single pass, which for the dense store walks its counts in
+ * address order, and the inventory applies the delta only once all of it is covered, so a trade
+ * either moves every item or none.
+ *
+ * The entries are allocated from the memory resource given at construction, usually the scratch
+ * memory of the line being handled, and the counts are summed in 64 bits, so no number of
+ * repetitions of a large count can wrap around and pass the check.
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+#include "Command.h"
+#include "CountStore.h"
+
+class TradeDelta
+{
+public:
+    struct Entry
+    {
+        Id id;
+        int64_t count; // sum of the counts of every item with this id
+    };
+
+    explicit TradeDelta(std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+    void clear();
+    void append(const std::vector<Item> &items);
+    void merge();
+    void assign(const std::vector<Item> &items);
+    bool covered_by(const CountStore &store) const;
+    const std::pmr::vector<Entry> &entries() const;
+
+private:
+    std::pmr::vector<Entry> items; // sorted by id with one entry per id after merge
+};
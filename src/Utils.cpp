@@ -7,14 +7,57 @@
  */
 
 #include "Utils.h"
-#include <regex>
+#include "CharClass.h"
+#include <array>
+#include <charconv>
 #include <string>
 #include <iostream>
 
 namespace Utils
 {
-    std::vector<std::string> words;
-    int word_count = 0;
+    // number of empty tokens appended after the last real token, see split_line
+    static const int sentinel_count = 4;
+
+    // what a byte is to the tokenizer and the prefilter
+    enum ByteClass : uint8_t
+    {
+        Word,     // letter or digit, part of a word
+        Stray,    // any other byte that isn't a separator, part of a word no valid line can contain
+        Space,    // whitespace, separates tokens
+        Comma,    // a token of its own
+        Question  // a token of its own
+    };
+
+    /**
+     * @brief Builds the class of every byte.
+     *
+     * Whitespace is the `\s` class of the default "C" locale: space, tab, newline, vertical tab, form feed and
+     * carriage return. Letters and digits are those isalpha and isdigit accept in that locale.
+     */
+    static constexpr std::array<uint8_t, 256> build_byte_classes()
+    {
+        std::array<uint8_t, 256> classes{};
+        for (int c = 0; c < 256; ++c)
+        {
+            bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+            bool space = c == ' ' || (c >= '\t' && c <= '\r');
+            classes[c] = word ? Word : space ? Space : c == ',' ? Comma : c == '?' ? Question : Stray;
+        }
+        return classes;
+    }
+
+    static constexpr std::array<uint8_t, 256> byte_classes = build_byte_classes();
+
+    /**
+     * @brief Gets the class of a character.
+     *
+     * @param c The character.
+     * @return Its ByteClass.
+     */
+    static uint8_t byte_class(char c)
+    {
+        return byte_classes[(unsigned char)c];
+    }
 
     /**
      * @brief Splits the line into words based on spaces, commas, and question marks.
@@ -22,111 +65,240 @@ namespace Utils
      * This function takes a line of text and splits it into individual words. Since we need commas to validity check,
      * and question marks to detect the type of input, we take them as separate word tokens as well.
      *
+     * The line is scanned only once from left to right, looking up the class of every byte. Whitespace is skipped,
+     * commas and question marks are emitted as single character tokens, and every other run of characters becomes a
+     * word. This produces exactly the same tokens as the `[^\s,?]+|[?,]` pattern without building a regex for each
+     * line. The same pass notes in `stray_bytes` whether any word has a byte that is neither a letter nor a digit.
+     *
+     * Tokens are views into `line`, so nothing is copied and the `words` vector keeps its capacity between lines.
+     * The first two tokens are classified into `leading` with the table in Keywords.h, so the detectors can switch
+     * on them.
+     * The caller must keep the line alive while the tokens are in use. A few empty tokens are appended after the
+     * last real one, so validators that look a couple of words ahead of `word_count` compare against an empty
+     * word instead of reading past the end of the vector.
+     *
      * @param line The line of text to be split.
      * @return void
      *
-     * @note This function modifies the global `words` vector and `word_count` variable.
+     * @note This function modifies the parser's `words` vector, `leading` keywords, `stray_bytes` and `word_count`
+     *       variables.
      */
-    void split_line(const std::string &line)
+    void Parser::split_line(std::string_view line)
     {
-
         words.clear();
-        std::regex pattern(R"([^\s,?]+|[?,])");
 
-        auto begin = std::sregex_iterator(line.begin(), line.end(), pattern);
-        auto end = std::sregex_iterator();
-
-        for (auto it = begin; it != end; ++it)
+        uint8_t stray = 0;
+        size_t i = 0;
+        size_t n = line.size();
+        while (i < n)
         {
-            words.push_back(it->str());
+            uint8_t c = byte_class(line[i]);
+            if (c == Space)
+            {
+                i++;
+                continue;
+            }
+            if (c >= Comma)
+            {
+                words.push_back(line.substr(i, 1));
+                i++;
+                continue;
+            }
+            size_t start = i;
+            while (i < n && (c = byte_class(line[i])) <= Stray)
+            {
+                stray |= c;
+                i++;
+            }
+            words.push_back(line.substr(start, i - start));
         }
+        stray_bytes = stray != 0;
         word_count = words.size();
+        words.insert(words.end(), sentinel_count, std::string_view());
+        leading[0] = classify_keyword(words[0]);
+        leading[1] = classify_keyword(words[1]);
+    }
+
+    /**
+     * @brief Rejects lines that can't follow the grammar from their first word and last byte, without tokenizing.
+     *
+     * A line passes unless it certainly is invalid, so a line that passes still has to be parsed, and a line that
+     * doesn't is INVALID without parsing. Only the leading and trailing whitespace, the first word and the last byte
+     * are looked at, so the check costs the same for long lines. A line is rejected if:
+     * - its first word isn't "Geralt", "Total", "What" or "Exit";
+     * - it ends in ',', which no command does;
+     * - it starts with "Geralt" and ends in '?', as sentences don't, or starts with "Total" or "What" and doesn't,
+     *   as questions do;
+     * - it is "Exit" followed by anything but whitespace.
+     *
+     * @param line The line to be checked.
+     * @return false if the line is certainly invalid, true if it has to be parsed to tell.
+     *
+     * @note This function does not modify any global state.
+     */
+    bool may_be_valid(std::string_view line)
+    {
+        size_t start = 0;
+        size_t n = line.size();
+        while (start < n && byte_class(line[start]) == Space)
+        {
+            start++;
+        }
+        size_t end = start;
+        while (end < n && byte_class(line[end]) == Word)
+        {
+            end++;
+        }
+        std::string_view first = line.substr(start, end - start);
+
+        size_t last = n;
+        while (last > end && byte_class(line[last - 1]) == Space)
+        {
+            last--;
+        }
+        // class of the last byte that isn't whitespace, Word if the first word is all there is
+        uint8_t tail = last > end ? byte_class(line[last - 1]) : uint8_t(Word);
+
+        if (first == "Geralt")
+        {
+            return tail != Comma && tail != Question;
+        }
+        if (first == "Total" || first == "What")
+        {
+            return tail == Question;
+        }
+        return first == "Exit" && last == end;
     }
 
     /**
      * @brief Checks if the string contains only alphabetical characters.
      *
-     * This function iterates through each character in the string and checks if it is an alphabetic character.
+     * Letters are those of the "C" locale. Short strings are checked with a table, longer ones a vector at a time
+     * by the kernels CharClass picked for the CPU.
      *
      * @param str The string to be checked.
      * @return true if the string is alphabetical, false otherwise.
      *
      * @note This function does not modify any global state.
      */
-    bool is_alphabetical(const std::string &str)
+    bool is_alphabetical(std::string_view str)
     {
-        for (char c : str)
-        {
-            if (!isalpha(c))
-            {
-                return false;
-            }
-        }
-        return true;
+        return CharClass::all_alpha(str.data(), str.size());
     }
 
     /**
      * @brief Checks if the string represents a valid integer.
      *
      * This function checks if the string consists only of digits, not any decimal points or non-numeric characters.
+     * It is checked the same way as is_alphabetical.
      *
      * @param str The string to be checked.
      * @return true if the string is a valid integer, false otherwise.
      *
      * @note This function does not modify any global state.
      */
-    bool is_integer(const std::string &str)
+    bool is_integer(std::string_view str)
     {
-        for (char c : str)
+        return CharClass::all_digit(str.data(), str.size());
+    }
+
+    /**
+     * @brief Converts a word that passed is_integer to its numeric value.
+     *
+     * Counts that don't fit in an int are returned as 0, so they are rejected by the same "count must be
+     * positive" checks as a literal 0.
+     *
+     * @param str The word to be converted.
+     * @return The value of the word, or 0 if it is out of range.
+     *
+     * @note This function does not modify any global state.
+     */
+    int to_integer(std::string_view str)
+    {
+        int value = 0;
+        auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+        if (result.ec != std::errc())
         {
-            if (!isdigit(c))
-            {
-                return false;
-            }
+            return 0;
         }
-        return true;
+        return value;
     }
 
     /**
      * @brief Checks if the potion name is valid.
      *
      * This function checks if the potion name consists of only alphabetical words with only one space between them.
-     * Does it by iterating through every word and checking them with is_alphabetical and each character in the potion name portion of the line and checking
-     * character by character if a space is followed by another space.
+     * The words are views into the line, so the name is the span of the line from the first character of the first
+     * word to the last character of the last word, and every byte of it belongs to one of the words or to the whitespace
+     * between them.
+     * The words are all alphabetical if and only if the span holds only letters and whitespace, so the whole span is
+     * checked for that and for double spaces in a single pass, by CharClass::is_name_span.
      *
-     * @param line The line of text to be checked.
      * @param start_index The starting index of the potion name in the words vector.
      * @param end_index The ending index of the potion name in the words vector.
      * @return true if the potion name is valid, false otherwise.
      *
      * @note This function does not modify any global state.
      */
-    bool is_valid_potion_name(const std::string &line, int start_index, int end_index)
+    bool Parser::is_valid_potion_name(int start_index, int end_index) const
     {
-        // first we find the potion name in the actual line because we need to check multiple spaces, and our words vector of course doesn't hold that information
-        std::string start_word = words[start_index];
-        std::string end_word = words[end_index];
-        int start_index_in_line = line.find(start_word);                     // start of the potion name in the line
-        int end_index_in_line = line.find(end_word) + end_word.length() - 1; // last character of the potion name in the line
+        if (start_index > end_index)
+        {
+            return true;
+        }
 
-        // all words must be alphabetical
-        for (int i = start_index; i <= end_index; i++)
+        const char *first = words[start_index].data();
+        const char *last = words[end_index].data() + words[end_index].size();
+        return CharClass::is_name_span(first, last - first);
+    }
+
+    /**
+     * @brief Gets the potion name spanned by a range of words, with single spaces between them.
+     *
+     * A valid potion name almost always appears in the line exactly as it is named, one space between its
+     * words, so the name is returned as the span of the line from its first word to its last one, without
+     * copying it; the symbol table hashes that span directly when the name is resolved. Only a name whose
+     * words are separated by other whitespace, such as a tab, which is_valid_potion_name also accepts, is
+     * joined, in a buffer owned by the parser that keeps its capacity between lines.
+     *
+     * @param start_index The index of the first word of the name.
+     * @param end_index The index of the last word of the name.
+     * @return A view of the name, into the line or into the parser's buffer, valid until the next call.
+     *
+     * @note This function modifies the parser's name buffer only if the words are not single-spaced.
+     */
+    std::string_view Parser::join_words(int start_index, int end_index)
+    {
+        if (start_index > end_index)
+        {
+            return {};
+        }
+        int gap = start_index;
+        while (gap < end_index)
         {
-            if (!is_alphabetical(words[i]))
+            const char *after = words[gap].data() + words[gap].size();
+            if (*after != ' ' || after + 1 != words[gap + 1].data())
             {
-                return false;
+                break;
             }
+            gap++;
+        }
+        if (gap == end_index)
+        {
+            const char *first = words[start_index].data();
+            return std::string_view(first, words[end_index].data() + words[end_index].size() - first);
         }
 
-        // there can't be any double spaces in the substring we found
-        for (int i = start_index_in_line; i < end_index_in_line; i++)
+        joined_name.clear();
+        for (int i = start_index; i <= end_index; ++i)
         {
-            if (line[i] == ' ' && line[i + 1] == ' ')
+            joined_name += words[i];
+            if (i < end_index)
             {
-                return false;
+                joined_name += ' ';
             }
         }
-        return true;
+        return joined_name;
     }
 
     /**
@@ -144,9 +316,9 @@ namespace Utils
      *           1: Question
      *          2: Exit
      *
-     * @note This function doesn't modify any global state.
+     * @note This function doesn't modify any state.
      */
-    int detect_type()
+    int Parser::detect_type() const
     {
 
         if (word_count == 0)
@@ -157,7 +329,7 @@ namespace Utils
         {
             return 1; // Question
         }
-        if (words[0] == "Exit" && word_count == 1)
+        if (leading[0] == Keyword::Exit && word_count == 1)
         {
             return 2; // Exit
         }
@@ -173,10 +345,11 @@ namespace Utils
      *
      * @return true if the sentence is valid, false otherwise.
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    bool is_valid_loot()
+    bool Parser::is_valid_loot()
     {
+        command.loot.ingredients.clear();
         int curr_index = 2;
         // When calculated with necessary commas and the sentence structure a loot action sentence
         // must have 3k + 1 words, because each item has a count, a name and a comma except the last one.
@@ -192,12 +365,12 @@ namespace Utils
             {
                 return false;
             }
-            int cnt = stoi(words[curr_index]);
+            int cnt = to_integer(words[curr_index]);
             if (cnt <= 0)
             {
                 return false;
             }
-            std::string ing = words[curr_index + 1];
+            std::string_view ing = words[curr_index + 1];
             if (!is_alphabetical(ing))
             {
                 return false;
@@ -206,6 +379,7 @@ namespace Utils
             {
                 return false;
             }
+            command.loot.ingredients.push_back({ing, cnt});
             curr_index += 3;
         }
         return true;
@@ -220,10 +394,12 @@ namespace Utils
      *
      * @return true if the sentence is valid, false otherwise.
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    bool is_valid_trade()
+    bool Parser::is_valid_trade()
     {
+        command.trade.trophies.clear();
+        command.trade.ingredients.clear();
         int curr_index = 2;
         // first we check the part trophies are given before the "for" keyword
         // when we encounter the "for" keyword, we break the loop and move on to the next part
@@ -233,12 +409,12 @@ namespace Utils
             {
                 return false;
             }
-            int cnt = stoi(words[curr_index]);
+            int cnt = to_integer(words[curr_index]);
             if (cnt <= 0)
             {
                 return false;
             }
-            std::string ing = words[curr_index + 1];
+            std::string_view ing = words[curr_index + 1];
             if (!is_alphabetical(ing))
             {
                 return false;
@@ -250,6 +426,7 @@ namespace Utils
                 {
                     return false;
                 }
+                command.trade.trophies.push_back({ing, cnt});
                 curr_index += 4; // to skip the "for" keyword to ingredients part
                 break;
             }
@@ -257,6 +434,7 @@ namespace Utils
             {
                 return false;
             }
+            command.trade.trophies.push_back({ing, cnt});
             curr_index += 3;
         }
 
@@ -274,12 +452,12 @@ namespace Utils
             {
                 return false;
             }
-            int cnt = stoi(words[curr_index]);
+            int cnt = to_integer(words[curr_index]);
             if (cnt <= 0)
             {
                 return false;
             }
-            std::string ing = words[curr_index + 1];
+            std::string_view ing = words[curr_index + 1];
             if (!is_alphabetical(ing))
             {
                 return false;
@@ -288,6 +466,7 @@ namespace Utils
             {
                 return false;
             }
+            command.trade.ingredients.push_back({ing, cnt});
             curr_index += 3;
         }
         return true;
@@ -303,9 +482,9 @@ namespace Utils
      *
      * @return true if the sentence is valid, false otherwise.
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    bool is_valid_sign_knowledge()
+    bool Parser::is_valid_sign_knowledge()
     {
         if (word_count != 8)
         {
@@ -326,6 +505,8 @@ namespace Utils
         {
             return false;
         }
+        command.sign_knowledge.sign = words[2];
+        command.sign_knowledge.monster = words[7];
         return true;
     }
 
@@ -340,9 +521,9 @@ namespace Utils
      * @param curr_index The index of the first word after "is" in the words vector.
      * @return true if the sentence is valid, false otherwise.
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    bool is_valid_potion_knowledge(int curr_index)
+    bool Parser::is_valid_potion_knowledge(int curr_index)
     {
         if (words[curr_index + 2] == "effective" && words[curr_index + 3] == "against")
         {
@@ -354,6 +535,7 @@ namespace Utils
             {
                 return false;
             }
+            command.potion_knowledge.monster = words[curr_index + 4];
             return true;
         }
         return false;
@@ -369,12 +551,13 @@ namespace Utils
      * @param curr_index The index of the first word after "consists of" in the words vector.
      * @return true if the sentence is valid, false otherwise.
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    bool is_valid_potion_recipe(int curr_index)
+    bool Parser::is_valid_potion_recipe(int curr_index)
     {
         // this calculates the number of words after the curr_index
         // to follow the ingredient list structure, the number of words must be 3k + 2
+        command.potion_recipe.ingredients.clear();
         int cnt = word_count - curr_index;
         if (cnt % 3 != 2)
         {
@@ -388,12 +571,12 @@ namespace Utils
             {
                 return false;
             }
-            cnt = std::stoi(words[curr_index]);
+            cnt = to_integer(words[curr_index]);
             if (cnt <= 0)
             {
                 return false;
             }
-            std::string ing = words[curr_index + 1];
+            std::string_view ing = words[curr_index + 1];
             if (!is_alphabetical(ing))
             {
                 return false;
@@ -402,6 +585,7 @@ namespace Utils
             {
                 return false;
             }
+            command.potion_recipe.ingredients.push_back({ing, cnt});
             curr_index += 3;
         }
         return true;
@@ -416,9 +600,9 @@ namespace Utils
      *
      * @return true if the sentence is valid, false otherwise.
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    bool is_valid_encounter()
+    bool Parser::is_valid_encounter()
     {
         if (word_count != 4)
         {
@@ -428,6 +612,7 @@ namespace Utils
         {
             return false;
         }
+        command.encounter.monster = words[3];
         return true;
     }
 
@@ -438,7 +623,6 @@ namespace Utils
      * Does the validity checks by words, word_counts, valid name checks, valid number checks etc. Returns
      * type or -1 if invalid.
      *
-     * @param line The line of text to be checked.
      * @return int The type of sentence:
      *            -1: Invalid sentence
      *           0: Loot action
@@ -448,13 +632,14 @@ namespace Utils
      *       4: Potion knowledge action
      *      5: Potion recipe action
      *     6: Encounter action
+     *     7: Batch brew action
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    int detect_sentence_type(const std::string &line)
+    int Parser::detect_sentence_type()
     {
         // these are the trivial invalid types
-        if (words[0] != "Geralt") // first word not Geralt
+        if (leading[0] != Keyword::Geralt) // first word not Geralt
         {
             return -1;
         }
@@ -472,36 +657,46 @@ namespace Utils
         }
 
         // now let's move on to detect the type and do specific validity checks accordingly
-        if (words[1] == "loots") // possible loot sentence
+        switch (leading[1])
         {
+        case Keyword::Loots: // possible loot sentence
             if (!is_valid_loot())
             {
                 return -1;
             }
             return 0;
-        }
 
-        else if (words[1] == "trades") // possible trade sentence
-        {
+        case Keyword::Trades: // possible trade sentence
             if (!is_valid_trade())
             {
                 return -1;
             }
             return 1;
-        }
 
-        else if (words[1] == "brews") // possible brew sentence
-        {
+        case Keyword::Brews: // possible brew sentence
+            // potion names are alphabetical, so a count right after "brews" can only start a batch brew
+            if (is_integer(words[2]) && word_count >= 4)
+            {
+                int cnt = to_integer(words[2]);
+                if (cnt <= 0 || !is_valid_potion_name(3, word_count - 1))
+                {
+                    return -1;
+                }
+                command.brew.count = cnt;
+                command.brew.potion = join_words(3, word_count - 1);
+                return 7;
+            }
             // we need to check if the potion name is valid
             // the potion name is between the 3rd and the last word
-            if (!is_valid_potion_name(line, 2, word_count - 1))
+            if (!is_valid_potion_name(2, word_count - 1))
             {
                 return -1;
             }
+            command.brew.count = 1;
+            command.brew.potion = join_words(2, word_count - 1);
             return 2;
-        }
-        else if (words[1] == "learns")
-        {
+
+        case Keyword::Learns:
             if (word_count < 8)
             {
                 return -1;
@@ -516,38 +711,18 @@ namespace Utils
             }
             else // possible potion or potion recipe knowledge sentence
             {
-                bool potion_found = false; // to check if word potion is found in the sentence, both potion learn sentences require
-                for (int i = 2; i < word_count; ++i)
-                {
-                    if (words[i] == "potion")
-                    {
-                        potion_found = true;
-                        break;
-                    }
-                }
-                if (!potion_found) // if not this is a nothing sentence, i.e. invalid
-                {
-                    return -1;
-                }
-
-                // construct the potion name until the word "potion" is found
-                // both potion learn sentences follow this format up until here, they will diverse after "potion"
-                std::string potion_name = "";
+                // find where the potion name ends, at the first word "potion", which both potion learn sentences
+                // require. They follow the same format up until here, and diverge after "potion"
                 int curr_index = 2;
-                while (words[curr_index] != "potion" && curr_index < word_count)
+                while (curr_index < word_count && words[curr_index] != "potion")
                 {
-                    potion_name += words[curr_index];
-                    if (words[curr_index + 1] != "potion")
-                    {
-                        potion_name += " ";
-                    }
                     curr_index++;
                 }
-                if (!is_valid_potion_name(line, 2, curr_index - 1))
+                if (curr_index == word_count) // no "potion", this is a nothing sentence, i.e. invalid
                 {
                     return -1;
                 }
-                if (words[curr_index] != "potion")
+                if (!is_valid_potion_name(2, curr_index - 1))
                 {
                     return -1;
                 }
@@ -557,6 +732,7 @@ namespace Utils
                     {
                         return -1;
                     }
+                    command.potion_knowledge.potion = join_words(2, curr_index - 1);
                     return 4;
                 }
                 else if (words[curr_index + 1] == "consists" && words[curr_index + 2] == "of") // possible potion recipe
@@ -565,19 +741,22 @@ namespace Utils
                     {
                         return -1;
                     }
+                    command.potion_recipe.potion = join_words(2, curr_index - 1);
                     return 5;
                 }
             }
-        }
-        else if (words[1] == "encounters" && words[2] == "a") // possible encounter sentence
-        {
-            if (!is_valid_encounter())
+            return -1;
+
+        case Keyword::Encounters: // possible encounter sentence
+            if (words[2] != "a" || !is_valid_encounter())
             {
                 return -1;
             }
             return 6;
+
+        default:
+            return -1;
         }
-        return -1;
     }
 
     /**
@@ -587,7 +766,6 @@ namespace Utils
      * Does the validity checks by words, word_counts, valid name checks, valid number checks etc. Returns
      * type or -1 if invalid.
      *
-     * @param line The line of text to be checked.
      * @return int The type of question:
      *            -1: Invalid question
      *            0: Total ingredient count
@@ -599,61 +777,73 @@ namespace Utils
      *      6: Monster knowledge
      *     7: Potion formula knowledge
      *
-     * @note This function does not modify any global state.
+     * @note On success the parsed arguments are stored in the parser's command.
      */
-    int detect_question_type(const std::string &line)
+    int Parser::detect_question_type()
     {
-        if (words[0] == "Total" && words[1] == "ingredient") // possible total ingredient or specific ingredient
+        if (leading[0] == Keyword::Total)
         {
-            if (words[2] != "?" && word_count == 4) // specific ingredient
+            switch (leading[1])
             {
-                if (!is_alphabetical(words[2]))
+            case Keyword::Ingredient: // possible total ingredient or specific ingredient
+                if (words[2] != "?" && word_count == 4) // specific ingredient
                 {
-                    return -1;
+                    if (!is_alphabetical(words[2]))
+                    {
+                        return -1;
+                    }
+                    command.query.name = words[2];
+                    return 0;
                 }
-                return 0;
-            }
-            if (words[2] == "?" && word_count == 3) // total ingredient
-            {
-                return 1;
-            }
-        }
-        if (words[0] == "Total" && words[1] == "potion") // possible total potion or specific potion
-        {
-            if (word_count == 3 && words[2] == "?") // total potion
-            {
-                return 3;
-            }
+                if (words[2] == "?" && word_count == 3) // total ingredient
+                {
+                    return 1;
+                }
+                return -1;
 
-            // if specific construct potion name
-            std::string potion_name = "";
+            case Keyword::Potion: // possible total potion or specific potion
+                if (word_count == 3 && words[2] == "?") // total potion
+                {
+                    return 3;
+                }
 
-            if (!is_valid_potion_name(line, 2, word_count - 2))
-            {
-                return -1;
-            }
-            if (words[word_count - 1] != "?")
-            {
-                return -1;
-            }
-            return 2;
-        }
-        if (words[0] == "Total" && words[1] == "trophy") // possible total trophy or specific trophy
-        {
-            if (word_count == 3 && words[2] == "?") // total trophy
-            {
-                return 5;
-            }
-            if (word_count == 4 && is_alphabetical(words[2])) // specific trophy
-            {
+                // if specific check the potion name
+                if (!is_valid_potion_name(2, word_count - 2))
+                {
+                    return -1;
+                }
                 if (words[word_count - 1] != "?")
                 {
                     return -1;
                 }
-                return 4;
+                command.query.name = join_words(2, word_count - 2);
+                return 2;
+
+            case Keyword::Trophy: // possible total trophy or specific trophy
+                if (word_count == 3 && words[2] == "?") // total trophy
+                {
+                    return 5;
+                }
+                if (word_count == 4 && is_alphabetical(words[2])) // specific trophy
+                {
+                    if (words[word_count - 1] != "?")
+                    {
+                        return -1;
+                    }
+                    command.query.name = words[2];
+                    return 4;
+                }
+                return -1;
+
+            default:
+                return -1;
             }
         }
-        if (words[0] == "What" && words[1] == "is" && words[2] == "effective" && words[3] == "against") // monster knowledge question
+        if (leading[0] != Keyword::What || leading[1] != Keyword::Is)
+        {
+            return -1;
+        }
+        if (words[2] == "effective" && words[3] == "against") // monster knowledge question
         {
             if (word_count != 6)
             {
@@ -663,22 +853,17 @@ namespace Utils
             {
                 return -1;
             }
+            command.query.name = words[4];
             return 6;
         }
-        if (words[0] == "What" && words[1] == "is" && words[2] == "in") // potion formula knowledge question
+        if (words[2] == "in") // potion formula knowledge question
         {
-            std::string potion_name = "";
             int curr_index = 3;
             while (words[curr_index] != "?" && curr_index < word_count)
             {
-                potion_name += words[curr_index];
-                if (words[curr_index + 1] != "?")
-                {
-                    potion_name += " ";
-                }
                 curr_index++;
             }
-            if (!is_valid_potion_name(line, 3, curr_index - 1))
+            if (!is_valid_potion_name(3, curr_index - 1))
             {
                 return -1;
             }
@@ -688,9 +873,138 @@ namespace Utils
             }
             if (word_count == curr_index + 1)
             {
+                command.query.name = join_words(3, curr_index - 1);
                 return 7;
             }
         }
         return -1;
     }
-};
\ No newline at end of file
+
+    /**
+     * @brief Tokenizes, classifies and validates a line in a single pass.
+     *
+     * This is the only parse stage a line goes through. Lines may_be_valid rejects are invalid right away, without
+     * being tokenized, and so are lines with a stray byte, without going through the validators, except learns
+     * sentences, whose potion knowledge rule leaves some words unchecked. For the others
+     * the counts are converted to integers and the potion names are taken from the line while
+     * the line is validated, and the result is returned as a typed command that the inventory can execute without
+     * looking at the words again.
+     *
+     * @param line The line to be parsed. It must outlive the returned command.
+     * @return The parsed command, valid until the next call. Its type is CommandType::Invalid if the line
+     *         doesn't follow the grammar.
+     */
+    Command &Parser::parse(std::string_view line)
+    {
+        // detect_sentence_type and detect_question_type codes, in order
+        static const CommandType sentence_types[] = {
+            CommandType::Loot, CommandType::Trade, CommandType::Brew, CommandType::SignKnowledge,
+            CommandType::PotionKnowledge, CommandType::PotionRecipe, CommandType::Encounter, CommandType::BrewBatch};
+        static const CommandType question_types[] = {
+            CommandType::IngredientCount, CommandType::TotalIngredients, CommandType::PotionCount,
+            CommandType::TotalPotions, CommandType::TrophyCount, CommandType::TotalTrophies,
+            CommandType::MonsterKnowledge, CommandType::PotionFormula};
+
+        command.type = CommandType::Invalid;
+        if (!may_be_valid(line))
+        {
+            return command;
+        }
+        split_line(line);
+        // every token of a valid line is a keyword, a name, a count or a separator, except that a potion
+        // knowledge sentence only compares its monster with the last word, leaving the words between unchecked
+        if (stray_bytes && leading[1] != Keyword::Learns)
+        {
+            return command;
+        }
+
+        int type = detect_type();
+        if (type == 2)
+        {
+            command.type = CommandType::Exit;
+        }
+        else if (type == 1)
+        {
+            int question_type = detect_question_type();
+            if (question_type != -1)
+            {
+                command.type = question_types[question_type];
+            }
+        }
+        else if (type == 0)
+        {
+            int sentence_type = detect_sentence_type();
+            if (sentence_type != -1)
+            {
+                command.type = sentence_types[sentence_type];
+            }
+        }
+        return command;
+    }
+
+    /**
+     * @brief Looks up the ids of all names in a parsed command.
+     *
+     * Names a command can add to the inventory or the bestiary are interned. Names that only have to be found,
+     * such as the trophies given in a trade, the potion to brew, the monster encountered and the subjects of
+     * questions, are only looked up, so they are SymbolTable::none if the name was never seen.
+     *
+     * @param command The command returned by Parser::parse.
+     * @param symbols The table of the session the command will be executed in.
+     *
+     * @note This function modifies the ids in the command and may add names to the table.
+     */
+    void resolve_names(Command &command, SymbolTable &symbols)
+    {
+        switch (command.type)
+        {
+        case CommandType::Loot:
+            for (Item &item : command.loot.ingredients)
+            {
+                item.id = symbols.intern(item.name);
+            }
+            break;
+        case CommandType::Trade:
+            for (Item &item : command.trade.trophies)
+            {
+                item.id = symbols.find(item.name);
+            }
+            for (Item &item : command.trade.ingredients)
+            {
+                item.id = symbols.intern(item.name);
+            }
+            break;
+        case CommandType::Brew:
+        case CommandType::BrewBatch:
+            command.brew.potion_id = symbols.find(command.brew.potion);
+            break;
+        case CommandType::SignKnowledge:
+            command.sign_knowledge.sign_id = symbols.intern(command.sign_knowledge.sign);
+            command.sign_knowledge.monster_id = symbols.intern(command.sign_knowledge.monster);
+            break;
+        case CommandType::PotionKnowledge:
+            command.potion_knowledge.potion_id = symbols.intern(command.potion_knowledge.potion);
+            command.potion_knowledge.monster_id = symbols.intern(command.potion_knowledge.monster);
+            break;
+        case CommandType::PotionRecipe:
+            command.potion_recipe.potion_id = symbols.intern(command.potion_recipe.potion);
+            for (Item &item : command.potion_recipe.ingredients)
+            {
+                item.id = symbols.intern(item.name);
+            }
+            break;
+        case CommandType::Encounter:
+            command.encounter.monster_id = symbols.find(command.encounter.monster);
+            break;
+        case CommandType::IngredientCount:
+        case CommandType::PotionCount:
+        case CommandType::TrophyCount:
+        case CommandType::MonsterKnowledge:
+        case CommandType::PotionFormula:
+            command.query.id = symbols.find(command.query.name);
+            break;
+        default:
+            break;
+        }
+    }
+};
@@ -6,26 +6,61 @@
  * It includes logic for splitting input into tokens, verifying syntax and grammar rules,
  * and detecting the type of input (sentence, question, or exit command).
  *
- * These functions do not modify the inventory state. They operate solely on the global
- * `words` vector and `word_count` variable to assist in pre-validation and classification
- * before any action is executed.
+ * These functions do not modify the inventory state. The tokens of the current line and the
+ * Command parsed from them are owned by a Parser object, so independent parsers can be used
+ * at the same time, e.g. one per thread.
+ * The words are views into the line passed to split_line, so that line must outlive them.
  */
 
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include "Command.h"
+#include "Keywords.h"
+#include "SymbolTable.h"
 
 namespace Utils
 {
-    extern std::vector<std::string> words;
-    extern int word_count;
+    bool may_be_valid(std::string_view line);
+    bool is_alphabetical(std::string_view str);
+    bool is_integer(std::string_view str);
+    int to_integer(std::string_view str);
+    void resolve_names(Command &command, SymbolTable &symbols);
 
-    void split_line(const std::string &line);
-    bool is_alphabetical(const std::string &str);
-    bool is_integer(const std::string &str);
-    int detect_type();
-    int detect_sentence_type(const std::string &line);
-    bool is_valid_potion_name(const std::string &line, int start_index, int end_index);
+    /**
+     * @class Parser
+     * @brief Tokenizes one line at a time and turns it into a typed Command.
+     *
+     * The parser keeps the words of the last line given to split_line. detect_type,
+     * detect_sentence_type and detect_question_type then classify and validate that line,
+     * and store its counts and names in `command` as they go. parse runs all of these steps.
+     */
+    class Parser
+    {
+    public:
+        std::vector<std::string_view> words; // tokens of the current line, followed by a few empty sentinels
+        int word_count = 0;                  // number of real tokens in words
+        Keyword leading[2] = {};             // keywords of the first two tokens, which pick the grammar rule
+        bool stray_bytes = false;            // true if a word has a byte other than a letter or a digit
+        Command command;                     // the typed form of the current line
 
-    int detect_question_type(const std::string &line);
+        Command &parse(std::string_view line);
+        void split_line(std::string_view line);
+        int detect_type() const;
+        int detect_sentence_type();
+        int detect_question_type();
+        bool is_valid_potion_name(int start_index, int end_index) const;
+        std::string_view join_words(int start_index, int end_index);
+
+    private:
+        std::string joined_name; // reusable buffer for potion names not single-spaced in the line, keeps its capacity
+
+        bool is_valid_loot();
+        bool is_valid_trade();
+        bool is_valid_sign_knowledge();
+        bool is_valid_potion_knowledge(int curr_index);
+        bool is_valid_potion_recipe(int curr_index);
+        bool is_valid_encounter();
+    };
 }
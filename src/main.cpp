@@ -2,144 +2,330 @@
  * @file main.cpp
  * @brief Entry point for the Witcher Tracker system.
  *
- * Reads user input lines, classifies them as sentence-type or question-type commands,
- * and delegates them to the Inventory system for processing. The system runs in a loop
- * until an "Exit" command or EOF is received.
+ * Reads user input lines and hands them to a Session, which classifies them as sentence-type
+ * or question-type commands and delegates them to its Inventory for processing. The system
+ * runs in a loop until an "Exit" command or EOF is received.
+ *
+ * Responses go through an OutputSink on the standard output. In the default interactive mode
+ * a ">> " prompt is printed before every line and the sink is flushed with it, so every
+ * response is visible before the next line is read. With --batch no prompt is printed and the
+ * output is only written in bulk, which suits piped input.
+ *
+ * With --input the lines are read from a memory-mapped file instead of the standard input, in
+ * batch mode. Lines are handed to the session as views into the mapping, and a line without a
+ * final '\n' or an "Exit" line ends the run exactly as in the interactive loop.
+ *
+ * With --snapshot the session is saved to the given file when the run ends, and with
+ * --snapshot-every also after every N executed lines. With --restore the session starts from a
+ * snapshot instead of an empty inventory; the input is expected to be the same log again, and the
+ * lines the snapshot already covers are skipped without printing anything for them.
+ *
+ * With --journal every state-changing command is appended to a binary journal, with group
+ * commit. With --replay a journal is applied before the input, after --restore if both are
+ * given, without printing its responses; the lines it covers are skipped as well. A journal can
+ * be replayed and then appended to by passing it to both options.
+ *
+ * With --threads and --input the lines go through a Pipeline instead: that many threads parse
+ * batches of lines ahead of a single thread executing them in order, and another one writes the
+ * responses.
+ *
+ * With --stats, in a build with WITCHER_STATS (make STATS=on), the counters and latency
+ * histograms of the session are written to the given file as JSON when the run ends, and after
+ * the current line whenever the process receives SIGUSR1.
+ *
+ * Usage: witchertracker [--batch] [--input <file>] [--threads <parsers>] [--restore <file>]
+ *                       [--snapshot <file>] [--snapshot-every <lines>] [--replay <file>] [--journal <file>]
+ *                       [--stats <file>]
  */
 
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <string>
-#include "Inventory.h"
-#include "Utils.h"
+#include <string_view>
+#include "Journal.h"
+#include "LineReader.h"
+#include "MappedFile.h"
+#include "OutputSink.h"
+#include "Pipeline.h"
+#include "Session.h"
 
-Inventory inventory;
+#ifdef WITCHER_STATS
+static std::string stats_path;                      // where the statistics are written, if anywhere
+static volatile std::sig_atomic_t stats_requested = 0; // set by SIGUSR1, cleared once they are written
 
 /**
- * @brief Parse and execute a single user command related to inventory state or knowledge.
- *
- * This function is responsible for interpreting and executing a line of input from the user.
- * It first splits the line into words and determines the type of command (question or action).
- * Based on the command type, it calls the appropriate methods on the inventory object.
- *
- * @param line The input line to execute.
- * @return void
+ * @brief Asks for the statistics to be written after the current line.
  */
-void execute_line(const std::string &line)
+static void request_stats(int)
 {
-    Utils::split_line(line);
-    Utils::word_count = Utils::words.size();
+    stats_requested = 1;
+}
 
-    int type = Utils::detect_type();
+/**
+ * @brief Writes the statistics file if SIGUSR1 asked for it since the last time.
+ *
+ * @param session The session whose statistics are written.
+ */
+static void poll_stats(const Session &session)
+{
+    if (stats_requested && !stats_path.empty())
+    {
+        stats_requested = 0;
+        if (!session.write_stats_file(stats_path))
+        {
+            std::cerr << "witchertracker: cannot write stats " << stats_path << "\n";
+        }
+    }
+}
+#endif
 
-    if (type == 2) // Exit command, finish the run
+/**
+ * @brief Executes every line of a file as the interactive loop would, without copying the lines.
+ *
+ * @param path The file to read the lines from.
+ * @param session The session the lines are executed in.
+ * @param skip The number of lines at the start that a restored snapshot already covers.
+ * @param pipeline The pipeline to execute the lines with, or null to execute them on this thread.
+ * @return true if the file could be mapped, false otherwise.
+ */
+static bool run_mapped(const std::string &path, Session &session, uint64_t skip, Pipeline *pipeline)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        std::cerr << "witchertracker: cannot open " << path << "\n";
+        return false;
+    }
+    if (pipeline != nullptr)
     {
-        exit(0);
+        pipeline->run(file.contents(), skip);
+        return true;
     }
+    LineReader reader(file.contents());
+    std::string_view line;
+    while (reader.next(line))
+    {
+        if (line == "Exit")
+            break;
+
+        if (skip > 0)
+        {
+            skip--;
+            continue;
+        }
+        if (!session.execute_line(line))
+            break;
+        WITCHER_STATS_ONLY(poll_stats(session));
+    }
+    return true;
+}
+
+/**
+ * @brief Prints the usage of the program.
+ * @return The exit status for a bad command line.
+ */
+static int usage()
+{
+    std::cerr << "Usage: witchertracker [--batch] [--input <file>] [--threads <parsers>] [--restore <file>]\n"
+                 "                      [--snapshot <file>] [--snapshot-every <lines>] [--replay <file>] [--journal <file>]\n"
+                 "                      [--stats <file>]\n";
+    return 1;
+}
 
-    if (type == 1) // Question command
+int main(int argc, char **argv)
+{
+    bool batch = false;
+    std::string input_path;
+    std::string restore_path;
+    std::string snapshot_path;
+    uint64_t snapshot_every = 0;
+    std::string replay_path;
+    std::string journal_path;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i)
     {
-        int question_type = Utils::detect_question_type(line);
-        if (question_type == -1)
+        std::string_view arg = argv[i];
+        if (arg == "--batch")
         {
-            std::cout << "INVALID" << "\n";
-            return;
+            batch = true;
         }
-        switch (question_type)
+        else if (arg == "--input" && i + 1 < argc)
         {
-        case 0: // specific ingredient count
+            input_path = argv[++i];
+        }
+        else if (arg == "--restore" && i + 1 < argc)
         {
-            int cnt = inventory.get_ingredient_count(Utils::words[2]);
-            std::cout << cnt << "\n";
-            break;
+            restore_path = argv[++i];
         }
-        case 1: // total ingredient count
-            inventory.print_ingredients();
-            break;
-        case 2: // specific potion count
+        else if (arg == "--snapshot" && i + 1 < argc)
         {
-            std::cout << inventory.get_potion_count() << "\n";
-            break;
+            snapshot_path = argv[++i];
         }
-        case 3: // total potion count
-            inventory.print_potions();
-            break;
-        case 4: // specific trophy count
+        else if (arg == "--replay" && i + 1 < argc)
         {
-            int cnt = inventory.get_trophy_count(Utils::words[2]);
-            std::cout << cnt << "\n";
-            break;
+            replay_path = argv[++i];
         }
-        case 5: // total trophy count
-            inventory.print_trophies();
-            break;
-        case 6: // specific monster knowledge
-            inventory.print_monster_knowledge(Utils::words[4]);
-            break;
-        case 7: // potion formula
-            inventory.print_potion_formula();
-            break;
-        default:
-            std::cout << "INVALID" << "\n";
-            break;
+        else if (arg == "--journal" && i + 1 < argc)
+        {
+            journal_path = argv[++i];
+        }
+        else if (arg == "--stats" && i + 1 < argc)
+        {
+#ifdef WITCHER_STATS
+            stats_path = argv[++i];
+#else
+            std::cerr << "witchertracker: --stats needs a build with STATS=on\n";
+            return 1;
+#endif
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+            if (threads <= 0)
+            {
+                return usage();
+            }
+        }
+        else if (arg == "--snapshot-every" && i + 1 < argc)
+        {
+            char *end = nullptr;
+            snapshot_every = std::strtoull(argv[++i], &end, 10);
+            if (*end != '\0' || snapshot_every == 0)
+            {
+                return usage();
+            }
+        }
+        else
+        {
+            return usage();
         }
     }
-    else if (type == 0) // Candidate sentence type command
+    if ((snapshot_every > 0 && snapshot_path.empty()) || (threads > 0 && input_path.empty()))
+    {
+        return usage();
+    }
+
+#ifdef WITCHER_STATS
+    if (!stats_path.empty())
+    {
+        // restarted reads, so a request while the interactive loop waits for a line doesn't end the input
+        struct sigaction action = {};
+        action.sa_handler = request_stats;
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, nullptr);
+    }
+#endif
+
+    // responses never go through std::cout, so std::cin needn't be synchronized or tied to it
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+
+    OutputSink out(1);
+
+    // in a pipeline the session writes to a string, which the writer thread then hands to out
+    std::string staged;
+    OutputSink staging(staged);
+    OutputSink &session_out = threads > 0 ? staging : out;
+    Session session(session_out);
+    if (!restore_path.empty() && !session.restore_snapshot_file(restore_path))
+    {
+        std::cerr << "witchertracker: cannot restore " << restore_path << "\n";
+        return 1;
+    }
+    if (!replay_path.empty())
     {
-        int sentence_type = Utils::detect_sentence_type(line);
-        if (sentence_type == -1)
+        // the responses of the journaled lines were printed by the run that journaled them
+        session_out.set_muted(true);
+        bool replayed = session.replay_journal_file(replay_path);
+        session_out.set_muted(false);
+        if (!replayed)
         {
-            std::cout << "INVALID" << "\n";
-            return;
+            std::cerr << "witchertracker: cannot replay " << replay_path << "\n";
+            return 1;
         }
-        switch (sentence_type)
+    }
+    Journal journal;
+    if (!journal_path.empty())
+    {
+        if (!journal.open(journal_path))
         {
-        case 0: // loot
-            inventory.handle_loot();
-            break;
-        case 1: // trade
-            inventory.handle_trade();
-            break;
-        case 2: // brew
-            inventory.handle_brew();
-            break;
-        case 3: // sign knowledge
-            inventory.handle_sign_knowledge();
-            break;
-        case 4: // potion knowledge
-            inventory.handle_potion_knowledge();
-            break;
-        case 5: // potion recipe
-            inventory.handle_potion_recipe();
-            break;
-        case 6: // encounter
-            inventory.handle_encounter();
-            break;
-        default:
-            std::cout << "INVALID" << "\n";
-            break;
+            std::cerr << "witchertracker: cannot open journal " << journal_path << "\n";
+            return 1;
         }
+        session.set_journal(&journal);
     }
-    else
+    uint64_t skip = session.lines_executed();
+    if (snapshot_every > 0)
     {
-        std::cout << "INVALID" << "\n";
+        session.set_auto_snapshot(snapshot_path, snapshot_every);
+    }
+
+    // the final snapshot is written once every response of the run is out
+    auto finish = [&](int status) {
+        session_out.flush();
+        out.flush();
+        if (!journal.commit())
+        {
+            std::cerr << "witchertracker: cannot write journal " << journal_path << "\n";
+            status = 1;
+        }
+        if (status == 0 && !snapshot_path.empty() && !session.save_snapshot_file(snapshot_path))
+        {
+            std::cerr << "witchertracker: cannot write snapshot " << snapshot_path << "\n";
+            return 1;
+        }
+#ifdef WITCHER_STATS
+        if (!stats_path.empty() && !session.write_stats_file(stats_path))
+        {
+            std::cerr << "witchertracker: cannot write stats " << stats_path << "\n";
+            status = 1;
+        }
+#endif
+        return status;
+    };
+
+    if (!input_path.empty())
+    {
+        if (threads > 0)
+        {
+            Pipeline pipeline(session, staging, staged, out, threads);
+            return finish(run_mapped(input_path, session, skip, &pipeline) ? 0 : 1);
+        }
+        return finish(run_mapped(input_path, session, skip, nullptr) ? 0 : 1);
     }
-}
 
-int main()
-{
     std::string line;
 
     // Continuously read and execute commands until EOF or "Exit"
     while (true)
     {
-        std::cout << ">> ";
+        if (!batch && skip == 0)
+        {
+            // nothing else will be recorded until the user answers, so the group is committed now
+            if (!journal.commit())
+            {
+                std::cerr << "witchertracker: cannot write journal " << journal_path << "\n";
+                return finish(1);
+            }
+            out << ">> ";
+            out.flush();
+        }
         std::getline(std::cin, line);
 
         if (std::cin.eof() || line == "Exit")
             break;
 
-        execute_line(line);
+        if (skip > 0)
+        {
+            skip--;
+            continue;
+        }
+        if (!session.execute_line(line))
+            break;
+        WITCHER_STATS_ONLY(poll_stats(session));
     }
 
-    return 0;
+    return finish(0);
 }
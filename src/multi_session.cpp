@@ -0,0 +1,124 @@
+/**
+ * @file multi_session.cpp
+ * @brief Runs many independent Witcher Tracker sessions inside one process.
+ *
+ * Every input file is an independent session log. The files are shared out to a pool of worker
+ * threads, each file is executed by its own Session, and its responses are written to a file
+ * with the same name in the output folder. Input files are memory-mapped and their lines handed
+ * to the session as views, exactly as the --input mode of main.cpp handles them.
+ *
+ * Usage: witchertracker-multi [-j <threads>] -o <output_folder> <input_file>...
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LineReader.h"
+#include "MappedFile.h"
+#include "Session.h"
+
+/**
+ * @brief Executes one session log and writes its responses.
+ *
+ * @param input_path The session log to execute.
+ * @param output_path The file the responses are written to.
+ * @return true if both files could be opened, false otherwise.
+ */
+static bool run_session(const std::filesystem::path &input_path, const std::filesystem::path &output_path)
+{
+    MappedFile input;
+    if (!input.open(input_path.string()))
+    {
+        std::cerr << "witchertracker-multi: cannot open " << input_path.string() << "\n";
+        return false;
+    }
+    int fd = ::open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "witchertracker-multi: cannot create " << output_path.string() << "\n";
+        return false;
+    }
+
+    {
+        OutputSink output(fd);
+        Session session(output);
+        LineReader reader(input.contents());
+        std::string_view line;
+        while (reader.next(line))
+        {
+            if (line == "Exit")
+                break;
+
+            if (!session.execute_line(line))
+                break;
+        }
+    } // the sink flushes here, before the file is closed
+    ::close(fd);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    std::filesystem::path output_folder;
+    std::vector<std::filesystem::path> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "-o" && i + 1 < argc)
+        {
+            output_folder = argv[++i];
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+    if (output_folder.empty() || inputs.empty())
+    {
+        std::cerr << "Usage: witchertracker-multi [-j <threads>] -o <output_folder> <input_file>...\n";
+        return 1;
+    }
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+    std::filesystem::create_directories(output_folder);
+
+    // workers take the next unprocessed file until none are left
+    std::atomic<size_t> next{0};
+    std::atomic<int> failures{0};
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < inputs.size(); i = next++)
+        {
+            if (!run_session(inputs[i], output_folder / inputs[i].filename()))
+            {
+                failures++;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads && t < inputs.size(); ++t)
+    {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    return failures == 0 ? 0 : 1;
+}
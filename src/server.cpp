@@ -0,0 +1,82 @@
+/**
+ * @file server.cpp
+ * @brief Runs the Witcher Tracker as a long-running server for many worlds, see Server.h.
+ *
+ * Requests are read from the standard input and responses written to the standard output,
+ * unless --listen is given, in which case clients connect to a Unix socket at that path instead.
+ * Every request line is "<world>\t<line>" and every response line "<world>\t<response>".
+ * --shards sets the number of shard threads the worlds are spread over.
+ *
+ * Without --listen the server ends at the end of its input, once every response is written.
+ * With it, the server runs until it receives SIGINT or SIGTERM, and then answers the lines it
+ * already read before it ends.
+ *
+ * Usage: witchertracker-server [--shards <threads>] [--listen <socket>]
+ */
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include "Server.h"
+
+static Server *running_server = nullptr; // the server the signal handler stops
+
+/**
+ * @brief Stops the running server.
+ */
+static void request_stop(int)
+{
+    running_server->stop();
+}
+
+int main(int argc, char **argv)
+{
+    int shards = std::thread::hardware_concurrency();
+    std::string listen_path;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        if (arg == "--shards" && i + 1 < argc)
+        {
+            shards = std::atoi(argv[++i]);
+        }
+        else if (arg == "--listen" && i + 1 < argc)
+        {
+            listen_path = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: witchertracker-server [--shards <threads>] [--listen <socket>]\n";
+            return 1;
+        }
+    }
+    if (shards <= 0)
+    {
+        shards = 1;
+    }
+
+    // a client that goes away shows up as EPIPE on its connection instead
+    std::signal(SIGPIPE, SIG_IGN);
+
+    Server server(shards);
+    if (listen_path.empty())
+    {
+        server.add_connection(STDIN_FILENO, STDOUT_FILENO);
+    }
+    else if (!server.listen(listen_path))
+    {
+        return 1;
+    }
+
+    running_server = &server;
+    struct sigaction action = {};
+    action.sa_handler = request_stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    server.run();
+    return 0;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file charclass_test.cpp
+ * @brief Differential test for the character class kernels described in CharClass.h.
+ *
+ * Every kernel set the CPU can run, and the inline wrappers, must give the same answers as a
+ * byte-by-byte reference on random ranges. The ranges have every length up to a few vectors and
+ * start at random offsets of a buffer, so the overlapping last vector and the table path for short
+ * ranges are both covered. Their bytes are drawn mostly from letters, digits and whitespace, so
+ * that ranges passing the checks are common, with single bytes of any other value mixed in. In
+ * the buffer every range is followed by a space and letters, so a kernel reading past its end
+ * would get a different answer.
+ *
+ * Usage: charclass_test
+ */
+
+#include "../src/CharClass.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Reference for the "C" locale letter check: 'a' to 'z' and 'A' to 'Z'.
+ */
+static bool reference_alpha(const std::string &s)
+{
+    for (char c : s)
+    {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reference for the digit check.
+ */
+static bool reference_digit(const std::string &s)
+{
+    for (char c : s)
+    {
+        if (!(c >= '0' && c <= '9'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reference for the potion name span check: letters and whitespace, no "  ".
+ */
+static bool reference_name_span(const std::string &s)
+{
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        char c = s[i];
+        bool space = c == ' ' || (c >= '\t' && c <= '\r');
+        if (!space && !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')))
+        {
+            return false;
+        }
+        if (c == ' ' && i + 1 < s.size() && s[i + 1] == ' ')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Draws a random range that passes one of the checks and then perhaps breaks it in one byte.
+ *
+ * @param length The length of the range.
+ * @param rng The random generator.
+ * @return The range.
+ */
+static std::string random_range(size_t length, std::mt19937 &rng)
+{
+    static const std::string letters = "abcxyzABCXYZ";
+    static const std::string digits = "0123456789";
+    static const std::string name = "abcXYZ \t\r";
+    const std::string &alphabet = rng() % 3 == 0 ? letters : rng() % 2 == 0 ? digits : name;
+    std::string s(length, 'a');
+    for (char &c : s)
+    {
+        c = alphabet[rng() % alphabet.size()];
+    }
+    if (length > 0 && rng() % 2 == 0)
+    {
+        // one byte of any value, including the ones next to the class bounds and above 0x7f
+        static const char edges[] = {'@', '[', '`', '{', '/', ':', ' ', '\x08', '\x0e', '\x1f', '\x7f', '\x80',
+                                     '\xc1', '\xe1', '\xff', '\0'};
+        char c = rng() % 2 == 0 ? edges[rng() % sizeof(edges)] : (char)rng();
+        s[rng() % length] = c;
+    }
+    if (length > 1 && rng() % 4 == 0)
+    {
+        size_t at = rng() % (length - 1);
+        s[at] = ' ';
+        s[at + 1] = ' ';
+    }
+    return s;
+}
+
+int main()
+{
+    size_t kernel_count = 0;
+    const CharClass::Kernels *const *kernels = CharClass::supported(kernel_count);
+    if (kernel_count == 0 || kernels[0] != CharClass::active ||
+        std::string(kernels[kernel_count - 1]->name) != "scalar")
+    {
+        std::cerr << "the active kernels aren't the best supported ones\n";
+        return 1;
+    }
+
+    std::vector<char> buffer(4096, 'a');
+    std::mt19937 rng(23);
+    long checked = 0;
+    for (size_t length = 0; length <= 100; ++length)
+    {
+        for (int round = 0; round < 300; ++round)
+        {
+            std::string s = random_range(length, rng);
+            size_t offset = rng() % 2 == 0 ? buffer.size() - length - 1 - rng() % 64 : rng() % 64;
+            std::fill(buffer.begin(), buffer.end(), 'a');
+            buffer[offset + length] = ' ';
+            std::copy(s.begin(), s.end(), buffer.begin() + offset);
+            const char *first = buffer.data() + offset;
+
+            bool alpha = reference_alpha(s);
+            bool digit = reference_digit(s);
+            bool name = reference_name_span(s);
+            bool wrappers_agree = CharClass::all_alpha(first, length) == alpha &&
+                                  CharClass::all_digit(first, length) == digit &&
+                                  CharClass::is_name_span(first, length) == name;
+            if (!wrappers_agree)
+            {
+                std::cerr << "the wrappers disagree with the reference on '" << s << "'\n";
+                return 1;
+            }
+            for (size_t k = 0; k < kernel_count; ++k)
+            {
+                if (kernels[k]->all_alpha(first, length) != alpha || kernels[k]->all_digit(first, length) != digit ||
+                    kernels[k]->is_name_span(first, length) != name)
+                {
+                    std::cerr << kernels[k]->name << " disagrees with the reference on '" << s << "' of length "
+                              << length << "\n";
+                    return 1;
+                }
+            }
+            checked++;
+        }
+    }
+
+    std::cout << "charclass_test: " << checked << " ranges checked with";
+    for (size_t k = 0; k < kernel_count; ++k)
+    {
+        std::cout << " " << kernels[k]->name;
+    }
+    std::cout << " kernels, " << CharClass::active->name << " active\n";
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file count_store_test.cpp
+ * @brief Differential test for the count storage engines in CountStore.h.
+ *
+ * Both DenseCountStore and HashCountStore are driven with the same random sequence of updates
+ * and compared after every step against a std::map, which keeps the semantics the inventory had
+ * before the engines were introduced: entries are erased once their count drops to zero or below,
+ * and decreasing a missing entry does nothing. The sorted traversal is compared too, so the lazy
+ * index is checked both right after a change and when it is reused.
+ *
+ * Usage: count_store_test
+ */
+
+#include "../src/CountStore.h"
+#include "../src/SymbolTable.h"
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Compares a store against the reference counts.
+ *
+ * @param store The store under test.
+ * @param expected The reference counts, keyed on name so they iterate in sorted order.
+ * @param symbols The table the ids were interned in.
+ * @return true if both hold the same entries, false otherwise.
+ */
+template <typename Store>
+static bool same_contents(Store &store, const std::map<std::string, int> &expected, const SymbolTable &symbols)
+{
+    if (store.size() != expected.size())
+    {
+        return false;
+    }
+    const std::vector<Id> &ids = store.sorted_ids(symbols);
+    size_t i = 0;
+    for (const auto &pair : expected)
+    {
+        if (ids[i] >= symbols.size() || symbols.name(ids[i]) != pair.first || store.get(ids[i]) != pair.second)
+        {
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs a random sequence of updates on a store and checks it after each one.
+ *
+ * @param name The name of the engine, used in the messages.
+ * @param seed The seed of the update sequence.
+ * @return true if the store always matched the reference, false otherwise.
+ */
+template <typename Store>
+static bool run(const char *name, unsigned seed)
+{
+    SymbolTable symbols;
+    Store store;
+    std::map<std::string, int> expected;
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, 299); // enough names to make the hash table grow
+    std::uniform_int_distribution<int> delta(-6, 8);
+    for (int step = 0; step < 50000; ++step)
+    {
+        std::string key = "Name" + std::to_string(pick(rng));
+        Id id = symbols.intern(key);
+        int d = delta(rng);
+
+        auto it = expected.find(key);
+        if (it != expected.end())
+        {
+            it->second += d;
+            if (it->second <= 0)
+            {
+                expected.erase(it);
+            }
+        }
+        else if (d > 0)
+        {
+            expected[key] = d;
+        }
+        store.add(id, d);
+
+        if (store.get(id) != (expected.count(key) ? expected[key] : 0) ||
+            store.get(SymbolTable::none) != 0 ||
+            ((step % 7 == 0) && !same_contents(store, expected, symbols)))
+        {
+            std::cerr << name << ": mismatch at step " << step << " (seed " << seed << ")\n";
+            return false;
+        }
+    }
+    return same_contents(store, expected, symbols);
+}
+
+int main()
+{
+    int failures = 0;
+    for (unsigned seed = 1; seed <= 5; ++seed)
+    {
+        failures += !run<DenseCountStore>("DenseCountStore", seed);
+        failures += !run<HashCountStore>("HashCountStore", seed);
+    }
+    if (failures > 0)
+    {
+        std::cerr << failures << " runs failed\n";
+        return 1;
+    }
+    std::cout << "count_store_test: both engines match the reference\n";
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file journal_test.cpp
+ * @brief Crash-recovery test for the command journal described in Journal.h.
+ *
+ * Every file in the test-cases folder is executed once without interruption, keeping where the
+ * responses of each line end. It is then executed again with a journal using small groups, and
+ * the run is cut off at several points, keeping only what the journal had committed, sometimes
+ * with the last record cut short as well. A new session replays the journal, optionally on top
+ * of a snapshot taken earlier, and executes the rest of the file from the line the journal
+ * ended at. The responses the first run printed up to that line, followed by those of the
+ * recovered run, must be the responses of the uninterrupted run, and both runs must end in the
+ * same state.
+ *
+ * Usage: journal_test <test_cases_folder>
+ */
+
+#include "../src/Journal.h"
+#include "../src/OutputSink.h"
+#include "../src/Session.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The uninterrupted run of a file.
+ */
+struct Reference
+{
+    std::string responses;    // everything the run printed
+    std::vector<size_t> ends; // ends[i] is the length of the responses after i lines
+    std::string state;        // snapshot of the session at the end
+    size_t executed = 0;      // number of lines executed before the run ended
+};
+
+/**
+ * @brief Executes lines in a session the way the interactive loop does.
+ *
+ * @param session The session to execute the lines in.
+ * @param lines The lines of the file.
+ * @param first The index of the first line to execute.
+ * @param last The index one past the last line to execute.
+ * @return The index of the line the run stopped at.
+ */
+static size_t run(Session &session, const std::vector<std::string> &lines, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; ++i)
+    {
+        if (lines[i] == "Exit" || !session.execute_line(lines[i]))
+        {
+            return i;
+        }
+    }
+    return last;
+}
+
+/**
+ * @brief Executes a file without interruption.
+ *
+ * @param lines The lines of the file.
+ * @return The responses, where they end after each line, and the final state.
+ */
+static Reference run_reference(const std::vector<std::string> &lines)
+{
+    Reference reference;
+    OutputSink out(reference.responses);
+    Session session(out);
+    reference.ends.push_back(0);
+    for (const std::string &line : lines)
+    {
+        if (line == "Exit" || !session.execute_line(line))
+        {
+            break;
+        }
+        out.flush();
+        reference.ends.push_back(reference.responses.size());
+    }
+    out.flush();
+    reference.executed = reference.ends.size() - 1;
+    session.save_snapshot(reference.state);
+    return reference;
+}
+
+/**
+ * @brief Runs a file with a journal until a crash, recovers, and compares with the reference.
+ *
+ * @param lines The lines of the file.
+ * @param reference The uninterrupted run of the file.
+ * @param crash The number of lines executed before the crash.
+ * @param snapshot_at The number of lines after which a snapshot is taken, or -1 for none.
+ * @param torn The number of bytes of the committed journal lost in the crash.
+ * @return true if the recovered run matches the reference, false otherwise.
+ */
+static bool check_crash(const std::vector<std::string> &lines, const Reference &reference, size_t crash,
+                        long snapshot_at, size_t torn)
+{
+    std::string journaled;
+    std::string snapshot;
+    {
+        std::string ignored;
+        OutputSink out(ignored);
+        Session session(out);
+        Journal journal;
+        journal.open_in_memory(journaled, 5);
+        session.set_journal(&journal);
+        if (snapshot_at >= 0)
+        {
+            run(session, lines, 0, snapshot_at);
+            session.save_snapshot(snapshot);
+        }
+        run(session, lines, snapshot_at >= 0 ? snapshot_at : 0, crash);
+
+        // the crash loses the pending group, which the destructor of the journal would commit
+        std::string committed = journaled;
+        session.set_journal(nullptr);
+        journal.commit();
+        journaled = committed;
+    }
+    if (journaled.size() > Journal::magic.size() + 4)
+    {
+        journaled.resize(journaled.size() - std::min(torn, journaled.size() - Journal::magic.size() - 4));
+    }
+
+    std::string responses;
+    OutputSink out(responses);
+    Session recovered(out);
+    out.set_muted(true);
+    if ((snapshot_at >= 0 && !recovered.restore_snapshot(snapshot)) || !recovered.replay_journal(journaled))
+    {
+        return false;
+    }
+    out.set_muted(false);
+
+    size_t resumed = recovered.lines_executed();
+    if (resumed > crash || (snapshot_at >= 0 && resumed < (size_t)snapshot_at))
+    {
+        return false;
+    }
+    run(recovered, lines, resumed, lines.size());
+    out.flush();
+
+    std::string state;
+    recovered.save_snapshot(state);
+    return reference.responses.substr(0, reference.ends[resumed]) + responses == reference.responses &&
+           state == reference.state;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: journal_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    std::mt19937 rng(18);
+    int files = 0;
+    int checks = 0;
+    int failures = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().filename().string().rfind("input", 0) != 0)
+        {
+            continue;
+        }
+        std::ifstream file(entry.path());
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            lines.push_back(line);
+        }
+        files++;
+
+        Reference reference = run_reference(lines);
+        size_t n = reference.executed;
+        for (int k = 0; k < 40; ++k)
+        {
+            size_t crash = k == 0 ? n : std::uniform_int_distribution<size_t>(0, n)(rng);
+            long snapshot_at = k % 3 == 0 ? -1 : (long)std::uniform_int_distribution<size_t>(0, crash)(rng);
+            size_t torn = k % 2 == 0 ? 0 : std::uniform_int_distribution<size_t>(1, 40)(rng);
+            checks++;
+            if (!check_crash(lines, reference, crash, snapshot_at, torn))
+            {
+                std::cerr << entry.path().filename().string() << ": recovery after a crash at line " << crash
+                          << " (snapshot at " << snapshot_at << ", " << torn << " bytes torn) differs\n";
+                failures++;
+            }
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " of " << checks << " recoveries failed\n";
+        return 1;
+    }
+    std::cout << "journal_test: " << checks << " recoveries in " << files << " files matched the uninterrupted runs\n";
+    return 0;
+}
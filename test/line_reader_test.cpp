@@ -0,0 +1,114 @@
+/**
+ * @file line_reader_test.cpp
+ * @brief Differential test for the newline scanner behind the --input batch mode.
+ *
+ * The interactive loop reads lines with std::getline and stops as soon as the stream reports
+ * EOF. This test keeps that loop as a reference and checks that LineReader returns the same
+ * lines for every file in the test-cases folder, and for random buffers whose newlines fall at
+ * every offset of the 16-byte blocks the SIMD scanner compares at once.
+ *
+ * Usage: line_reader_test <test_cases_folder>
+ */
+
+#include "../src/LineReader.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Reference splitter, the getline loop of main.cpp.
+ *
+ * @param text The bytes to split.
+ * @return The lines the interactive loop would execute.
+ */
+static std::vector<std::string> getline_split(const std::string &text)
+{
+    std::istringstream input(text);
+    std::vector<std::string> lines;
+    std::string line;
+    while (true)
+    {
+        std::getline(input, line);
+        if (input.eof())
+            break;
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/**
+ * @brief Compares both splitters on a buffer and reports any difference.
+ *
+ * @param text The bytes to split.
+ * @param origin A short description of where the buffer comes from, used in the error message.
+ * @return true if both splitters agree, false otherwise.
+ */
+static bool check_text(const std::string &text, const std::string &origin)
+{
+    std::vector<std::string> expected = getline_split(text);
+    LineReader reader(text);
+    std::string_view line;
+    size_t i = 0;
+    bool same = true;
+    while (same && reader.next(line))
+    {
+        same = i < expected.size() && line == expected[i];
+        i++;
+    }
+    same = same && i == expected.size();
+    if (!same)
+    {
+        std::cerr << "Line mismatch in " << origin << "\n";
+    }
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: line_reader_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    int buffers = 0;
+    int failures = 0;
+
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        buffers++;
+        failures += !check_text(text, entry.path().filename().string());
+    }
+
+    // random buffers where newlines are frequent enough to land at every block offset
+    const std::string alphabet("ab \r\n\n\0", 7);
+    std::mt19937 rng(230);
+    std::uniform_int_distribution<int> length(0, 100);
+    std::uniform_int_distribution<int> pick(0, alphabet.size() - 1);
+    for (int k = 0; k < 20000; ++k)
+    {
+        std::string text;
+        int len = length(rng);
+        for (int i = 0; i < len; ++i)
+        {
+            text += alphabet[pick(rng)];
+        }
+        buffers++;
+        failures += !check_text(text, "random buffer " + std::to_string(k));
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " of " << buffers << " buffers split differently\n";
+        return 1;
+    }
+    std::cout << "line_reader_test: " << buffers << " buffers split identically\n";
+    return 0;
+}
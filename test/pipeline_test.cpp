@@ -0,0 +1,199 @@
+/**
+ * @file pipeline_test.cpp
+ * @brief Differential test for the pipelined execution in Pipeline.h.
+ *
+ * Inputs are executed once line by line in a Session, as the --input loop does, and once through
+ * a Pipeline with several numbers of parser threads and batch sizes. The responses must be the
+ * same. The inputs are the files in the test-cases folder, all of them joined without their exit
+ * lines, so the potion names and counts of one file meet the state of the others, and the joined
+ * input with exit commands placed at random lines, so the pipeline has to stop in the middle of
+ * a batch while the parsers are still ahead.
+ *
+ * The joined input is also run with a periodic snapshot, which the writer stage writes. Restoring
+ * the last one and executing the lines after it must give the rest of the responses, so the
+ * snapshot holds exactly the state of the lines it claims.
+ *
+ * Usage: pipeline_test <test_cases_folder>
+ */
+
+#include "../src/LineReader.h"
+#include "../src/OutputSink.h"
+#include "../src/Pipeline.h"
+#include "../src/Session.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Executes an input line by line on the calling thread, as the --input loop does.
+ *
+ * @param input The lines, each ending in '\n'.
+ * @return The responses.
+ */
+static std::string run_sequential(std::string_view input)
+{
+    std::string responses;
+    OutputSink out(responses);
+    Session session(out);
+    LineReader reader(input);
+    std::string_view line;
+    while (reader.next(line) && line != "Exit" && session.execute_line(line))
+    {
+    }
+    out.flush();
+    return responses;
+}
+
+/**
+ * @brief Executes an input through a pipeline.
+ *
+ * @param input The lines, each ending in '\n'.
+ * @param parsers The number of parser threads.
+ * @param batch_lines The number of lines per batch.
+ * @return The responses.
+ */
+static std::string run_pipelined(std::string_view input, int parsers, size_t batch_lines)
+{
+    std::string responses;
+    OutputSink destination(responses);
+    std::string staged;
+    OutputSink staging(staged);
+    Session session(staging);
+    Pipeline pipeline(session, staging, staged, destination, parsers, batch_lines);
+    pipeline.run(input);
+    destination.flush();
+    return responses;
+}
+
+/**
+ * @brief Runs an input through a pipeline with periodic snapshots and resumes from the last one.
+ *
+ * @param input The lines, each ending in '\n', without an exit command.
+ * @param expected The responses of the whole input, executed line by line.
+ * @param path The snapshot file, removed afterwards.
+ * @return true if the responses before the snapshot and after it add up to the expected ones.
+ */
+static bool resume_pipelined(std::string_view input, const std::string &expected, const std::string &path)
+{
+    std::string responses;
+    OutputSink destination(responses);
+    std::string staged;
+    OutputSink staging(staged);
+    Session session(staging);
+    session.set_auto_snapshot(path, 37);
+    Pipeline pipeline(session, staging, staged, destination, 3, 16);
+    pipeline.run(input);
+    destination.flush();
+
+    std::string resumed;
+    OutputSink resumed_out(resumed);
+    Session restored(resumed_out);
+    bool read = restored.restore_snapshot_file(path);
+    std::remove(path.c_str());
+    if (!read || responses != expected)
+    {
+        return false;
+    }
+    LineReader reader(input);
+    std::string_view line;
+    std::string before;
+    OutputSink before_out(before);
+    Session prefix(before_out);
+    for (uint64_t i = 0; i < restored.lines_executed() && reader.next(line); ++i)
+    {
+        prefix.execute_line(line);
+    }
+    while (reader.next(line))
+    {
+        restored.execute_line(line);
+    }
+    before_out.flush();
+    resumed_out.flush();
+    return restored.lines_executed() > 0 && before + resumed == expected;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: pipeline_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    std::vector<std::string> inputs;
+    std::vector<std::string> names;
+    std::string joined;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().filename().string().rfind("input", 0) != 0)
+        {
+            continue;
+        }
+        std::ifstream file(entry.path());
+        std::stringstream contents;
+        contents << file.rdbuf();
+        inputs.push_back(contents.str());
+        names.push_back(entry.path().filename().string());
+
+        std::string line;
+        while (std::getline(contents, line))
+        {
+            if (line != "Exit")
+            {
+                joined += line + "\n";
+            }
+        }
+    }
+    inputs.push_back(joined);
+    names.push_back("joined test cases");
+
+    // the joined input with an exit command at a random line, written so the parser classifies it
+    std::mt19937 rng(19);
+    for (int k = 0; k < 4; ++k)
+    {
+        size_t position = std::uniform_int_distribution<size_t>(0, joined.size() - 1)(rng);
+        position = joined.find('\n', position) + 1;
+        inputs.push_back(joined.substr(0, position) + (k % 2 == 0 ? "  Exit\n" : "Exit\n") + joined.substr(position));
+        names.push_back("joined test cases with an exit at byte " + std::to_string(position));
+    }
+
+    int runs = 0;
+    int failures = 0;
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        std::string expected = run_sequential(inputs[i]);
+        for (int parsers : {1, 2, 3, 7})
+        {
+            for (size_t batch_lines : {1, 2, 5, 256})
+            {
+                runs++;
+                if (run_pipelined(inputs[i], parsers, batch_lines) != expected)
+                {
+                    std::cerr << names[i] << ": " << parsers << " parsers with batches of " << batch_lines
+                              << " lines gave different responses\n";
+                    failures++;
+                }
+            }
+        }
+    }
+
+    runs++;
+    if (!resume_pipelined(joined, run_sequential(joined), "pipeline_test.snap"))
+    {
+        std::cerr << "resuming from a snapshot the pipeline wrote gave different responses\n";
+        failures++;
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " of " << runs << " pipelined runs differed\n";
+        return 1;
+    }
+    std::cout << "pipeline_test: " << runs << " pipelined runs matched the sequential ones\n";
+    return 0;
+}
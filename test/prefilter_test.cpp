@@ -0,0 +1,172 @@
+/**
+ * @file prefilter_test.cpp
+ * @brief Differential test for the fast rejection of invalid lines.
+ *
+ * Every line the Utils::may_be_valid prefilter rejects, and every line other than a learns sentence
+ * that split_line finds a stray byte in, must also be rejected by the full grammar path, split_line
+ * followed by detect_type and detect_sentence_type or detect_question_type. parse, which takes both shortcuts, must give every
+ * line the type the full path gives it. The lines are those of every file in the test-cases
+ * folder, and random edits of them: bytes inserted, replaced or removed, with commas, question
+ * marks, whitespace and bytes outside the grammar over-represented, and the first word moved.
+ *
+ * Usage: prefilter_test <test_cases_folder>
+ */
+
+#include "../src/Utils.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static Utils::Parser parser; // the parser under test
+
+/**
+ * @brief Checks if the full grammar path rejects a line, without the prefilter.
+ *
+ * @param line The line.
+ * @return true if the line is invalid, false otherwise.
+ */
+static bool full_path_rejects(const std::string &line)
+{
+    parser.split_line(line);
+    int type = parser.detect_type();
+    if (type == 0)
+    {
+        return parser.detect_sentence_type() == -1;
+    }
+    if (type == 1)
+    {
+        return parser.detect_question_type() == -1;
+    }
+    return type == -1;
+}
+
+/**
+ * @brief Compares the shortcuts and parse with the full path on a single line.
+ *
+ * @param line The line.
+ * @param rejected Incremented if the prefilter rejects the line.
+ * @param stray Incremented if the prefilter passes the line but it has a stray byte.
+ * @return true if they agree, false otherwise.
+ */
+static bool check_line(const std::string &line, int &rejected, int &stray)
+{
+    bool invalid = full_path_rejects(line);
+    bool has_stray = parser.stray_bytes && parser.leading[1] != Utils::Keyword::Learns;
+    bool passes = Utils::may_be_valid(line);
+    rejected += !passes;
+    stray += passes && has_stray;
+    if ((!passes || has_stray) && !invalid)
+    {
+        std::cerr << (passes ? "a stray byte rejects" : "prefilter rejects") << " a valid line: '" << line << "'\n";
+        return false;
+    }
+    if ((parser.parse(line).type == CommandType::Invalid) != invalid)
+    {
+        std::cerr << "parse and the full path disagree on: '" << line << "'\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies a few random edits to a line.
+ *
+ * @param line The line to edit.
+ * @param rng The random generator.
+ * @return The edited line.
+ */
+static std::string mutate(std::string line, std::mt19937 &rng)
+{
+    static const std::string alphabet = "aZ7 ,,??\t\r-.'_\x80\xc3";
+    int edits = 1 + rng() % 3;
+    for (int e = 0; e < edits; ++e)
+    {
+        size_t at = line.empty() ? 0 : rng() % (line.size() + 1);
+        char c = alphabet[rng() % alphabet.size()];
+        switch (rng() % 4)
+        {
+        case 0:
+            line.insert(line.begin() + at, c);
+            break;
+        case 1:
+            if (at < line.size())
+            {
+                line[at] = c;
+            }
+            break;
+        case 2:
+            if (at < line.size())
+            {
+                line.erase(at, 1);
+            }
+            break;
+        default:
+        {
+            // move the first word to the end, which keeps the bytes but breaks the order
+            size_t space = line.find(' ');
+            if (space != std::string::npos)
+            {
+                line = line.substr(space + 1) + " " + line.substr(0, space);
+            }
+            break;
+        }
+        }
+    }
+    return line;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: prefilter_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    std::vector<std::string> lines;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().filename().string().rfind("input", 0) != 0)
+        {
+            continue;
+        }
+        std::ifstream file(entry.path());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            lines.push_back(line);
+        }
+    }
+    for (const char *line : {"", "Exit", " Exit \t", "Exit ?", "Exit,", "Geralt", "Total ?", "What?", "What is in X??",
+                             "Geralt learns X potion is effective against M $$ M"})
+    {
+        lines.push_back(line);
+    }
+
+    int checked = 0;
+    int rejected = 0;
+    int stray = 0;
+    std::mt19937 rng(22);
+    for (const std::string &line : lines)
+    {
+        checked++;
+        if (!check_line(line, rejected, stray))
+        {
+            return 1;
+        }
+        for (int k = 0; k < 20; ++k)
+        {
+            checked++;
+            if (!check_line(mutate(line, rng), rejected, stray))
+            {
+                return 1;
+            }
+        }
+    }
+    std::cout << "prefilter_test: " << checked << " lines, " << rejected << " rejected by the prefilter and " << stray
+              << " for a stray byte, all of them invalid\n";
+    return 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file preparedness_index_test.cpp
+ * @brief Differential test for the incremental encounter preparedness index in PreparednessIndex.h.
+ *
+ * Random signs and potions are learned against random monsters and random potion counts are
+ * changed, the way the inventory does it. After every step the index is compared against
+ * deciding from the bestiary directly, which is how encounters used to decide: a monster is
+ * fought successfully if a sign against it is known or one of its effective potions is in stock.
+ *
+ * Usage: preparedness_index_test
+ */
+
+#include "../src/CountStore.h"
+#include "../src/PreparednessIndex.h"
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+
+int main()
+{
+    const Id id_count = 30; // signs, potions and monsters share one id space, as in the symbol table
+
+    std::mt19937 rng(230);
+    std::uniform_int_distribution<int> pick(0, id_count - 1);
+    std::uniform_int_distribution<int> amount(1, 3);
+    std::uniform_int_distribution<int> action(0, 9);
+
+    CountStore potion_counts;
+    PreparednessIndex index;
+    std::map<Id, std::set<Id>> signs;    // known signs of each monster
+    std::map<Id, std::set<Id>> potions;  // known effective potions of each monster
+
+    for (int step = 0; step < 100000; ++step)
+    {
+        int a = action(rng);
+        if (a == 0)
+        {
+            Id monster = pick(rng);
+            if (signs[monster].insert(pick(rng)).second)
+            {
+                index.sign_learned(monster);
+            }
+        }
+        else if (a <= 2)
+        {
+            Id monster = pick(rng);
+            Id potion = pick(rng);
+            if (potions[monster].insert(potion).second)
+            {
+                index.potion_learned(monster, potion, potion_counts);
+            }
+        }
+        else
+        {
+            Id potion = pick(rng);
+            int delta = a < 6 ? amount(rng) : -amount(rng);
+            int before = potion_counts.get(potion);
+            potion_counts.add(potion, delta);
+            index.stock_changed(potion, before, potion_counts.get(potion));
+        }
+
+        for (Id monster = 0; monster < id_count; ++monster)
+        {
+            int in_stock = 0;
+            for (Id potion : potions[monster])
+            {
+                in_stock += potion_counts.get(potion) > 0;
+            }
+            bool prepared = !signs[monster].empty() || in_stock > 0;
+            if (index.is_prepared(monster) != prepared || index.potions_in_stock(monster) != in_stock)
+            {
+                std::cerr << "preparedness mismatch for monster " << monster << " at step " << step << "\n";
+                return 1;
+            }
+        }
+    }
+    if (index.is_prepared(SymbolTable::none))
+    {
+        std::cerr << "unknown monster reported as prepared\n";
+        return 1;
+    }
+    std::cout << "preparedness_index_test: index matches the bestiary\n";
+    return 0;
+}
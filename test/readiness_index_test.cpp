@@ -0,0 +1,115 @@
+/**
+ * @file readiness_index_test.cpp
+ * @brief Differential test for the incremental brewability index in ReadinessIndex.h.
+ *
+ * Random formulas are learned and random ingredient counts are changed, the way the inventory
+ * does it. After every step the index is compared against checking each formula entry against
+ * the counts directly, which is how brewing used to decide, and the listener is checked to have
+ * been called exactly for the potions that went from not brewable to brewable.
+ *
+ * Usage: readiness_index_test
+ */
+
+#include "../src/CountStore.h"
+#include "../src/ReadinessIndex.h"
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+int main()
+{
+    const Id ingredient_count = 20; // ids 0..19 are ingredients, 20..59 potions
+    const Id potion_count = 40;
+
+    std::mt19937 rng(230);
+    std::uniform_int_distribution<int> pick_ingredient(0, ingredient_count - 1);
+    std::uniform_int_distribution<int> pick_potion(ingredient_count, ingredient_count + potion_count - 1);
+    std::uniform_int_distribution<int> amount(1, 6);
+    std::uniform_int_distribution<int> formula_size(1, 5);
+    std::uniform_int_distribution<int> action(0, 9);
+
+    CountStore stock;
+    ReadinessIndex index;
+    std::map<Id, std::vector<std::pair<Id, int>>> formulas;
+    std::set<Id> reported;
+    index.set_listener([&reported](Id potion)
+                       { reported.insert(potion); });
+
+    auto brute_force = [&](Id potion)
+    {
+        auto it = formulas.find(potion);
+        if (it == formulas.end())
+        {
+            return false;
+        }
+        for (const auto &pair : it->second)
+        {
+            if (stock.get(pair.first) < pair.second)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (int step = 0; step < 100000; ++step)
+    {
+        std::set<Id> brewable_before;
+        for (Id p = ingredient_count; p < ingredient_count + potion_count; ++p)
+        {
+            if (brute_force(p))
+            {
+                brewable_before.insert(p);
+            }
+        }
+        reported.clear();
+
+        int a = action(rng);
+        if (a == 0)
+        {
+            Id potion = pick_potion(rng);
+            if (formulas.count(potion) == 0)
+            {
+                std::vector<std::pair<Id, int>> formula;
+                int size = formula_size(rng);
+                for (int i = 0; i < size; ++i)
+                {
+                    formula.push_back({(Id)pick_ingredient(rng), amount(rng)}); // may repeat an ingredient
+                }
+                formulas[potion] = formula;
+                Formula entries;
+                entries.assign(formula.begin(), formula.end());
+                index.add_formula(potion, entries, stock);
+            }
+        }
+        else
+        {
+            Id ingredient = pick_ingredient(rng);
+            int delta = a < 6 ? amount(rng) : -amount(rng);
+            int before = stock.get(ingredient);
+            stock.add(ingredient, delta);
+            index.stock_changed(ingredient, before, stock.get(ingredient));
+        }
+
+        for (Id p = ingredient_count; p < ingredient_count + potion_count; ++p)
+        {
+            bool expected = brute_force(p);
+            bool became = expected && brewable_before.count(p) == 0;
+            if (index.is_brewable(p) != expected || (reported.count(p) != 0) != became)
+            {
+                std::cerr << "readiness mismatch for potion " << p << " at step " << step << "\n";
+                return 1;
+            }
+        }
+    }
+    if (index.is_brewable(SymbolTable::none))
+    {
+        std::cerr << "unknown potion reported as brewable\n";
+        return 1;
+    }
+    std::cout << "readiness_index_test: index matches the formulas\n";
+    return 0;
+}
@@ -0,0 +1,390 @@
+/**
+ * @file regress.cpp
+ * @brief Native regression runner: checks many recorded sessions against their expected outputs in parallel.
+ *
+ * Every folder given is searched for input*.txt files, each paired with the output*.txt file of
+ * the same name, as grader.py pairs them. The cases are shared out to a pool of threads, and each
+ * case is executed by its own Session inside this process, so no process is started per case.
+ *
+ * A case is judged as checker.py judges the output of the interactive loop: every input line up
+ * to an "Exit" or "exit" line is executed, a last line without '\n' included, and the responses
+ * are compared line by line with the expected output, ignoring blank lines and runs of
+ * whitespace. The comparison follows the execution line by line, and a case stops at its first
+ * mismatch, or when the responses run out, and reports it. A case passes when every expected line
+ * was matched; responses past the end of the expected output are ignored, as the checker ignores
+ * them.
+ *
+ * The time every case took is measured. The slowest cases are listed after the summary, and so
+ * is every case that took more than ten times the median time per line, so performance outliers
+ * show up even among cases of very different lengths. --timings writes the time of every case to
+ * a CSV file.
+ *
+ * Usage: regress [-j <threads>] [--slowest <cases>] [--timings <file>] <test_cases_folder>...
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../src/LineReader.h"
+#include "../src/MappedFile.h"
+#include "../src/OutputSink.h"
+#include "../src/Session.h"
+
+/**
+ * @brief A pair of files to check and, once checked, what came out.
+ */
+struct Case
+{
+    std::filesystem::path input;
+    std::filesystem::path expected;
+    bool passed = false;
+    size_t lines = 0;       // input lines executed
+    double seconds = 0;     // time taken to execute and compare them
+    std::string mismatch;   // what went wrong, if the case failed
+};
+
+/**
+ * @brief Takes the next line off a range, also a last line without '\n', as Python's readlines returns it.
+ *
+ * @param rest The rest of the range, the line and its '\n' are removed from it.
+ * @param line Set to the line, without its '\n'.
+ * @return false if the range is empty.
+ */
+static bool next_line(std::string_view &rest, std::string_view &line)
+{
+    if (rest.empty())
+    {
+        return false;
+    }
+    const char *newline = LineReader::find_newline(rest.data(), rest.data() + rest.size());
+    size_t length = newline - rest.data();
+    line = rest.substr(0, length);
+    rest.remove_prefix(std::min(length + 1, rest.size()));
+    return true;
+}
+
+/**
+ * @brief Checks if a byte is whitespace to Python's str.split.
+ *
+ * @param c The byte.
+ * @return true for spaces, tabs, line breaks and the vertical tab and form feed.
+ */
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * @brief Compares two lines as checker.py does, with every run of whitespace as one space and none at the ends.
+ *
+ * @param a One line.
+ * @param b The other line.
+ * @return true if the words of both lines are the same.
+ */
+static bool same_words(std::string_view a, std::string_view b)
+{
+    size_t i = 0;
+    size_t j = 0;
+    while (true)
+    {
+        while (i < a.size() && is_space(a[i]))
+        {
+            i++;
+        }
+        while (j < b.size() && is_space(b[j]))
+        {
+            j++;
+        }
+        if (i == a.size() || j == b.size())
+        {
+            return i == a.size() && j == b.size();
+        }
+        while (i < a.size() && j < b.size() && !is_space(a[i]) && a[i] == b[j])
+        {
+            i++;
+            j++;
+        }
+        bool a_ends = i == a.size() || is_space(a[i]);
+        bool b_ends = j == b.size() || is_space(b[j]);
+        if (!a_ends || !b_ends)
+        {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Takes the next line that isn't blank off a range.
+ *
+ * @param rest The rest of the range.
+ * @param line Set to the line.
+ * @return false if only blank lines were left.
+ */
+static bool next_nonblank(std::string_view &rest, std::string_view &line)
+{
+    while (next_line(rest, line))
+    {
+        if (!same_words(line, ""))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Executes a case and compares its responses with the expected output as they come.
+ *
+ * @param check The case, its result is filled in.
+ */
+static void run_case(Case &check)
+{
+    auto start = std::chrono::steady_clock::now();
+    MappedFile input;
+    MappedFile expected;
+    if (!input.open(check.input.string()) || !expected.open(check.expected.string()))
+    {
+        check.mismatch = "cannot open the input or the expected output";
+        return;
+    }
+
+    std::string responses;
+    OutputSink out(responses, 4096);
+    Session session(out);
+    std::string_view lines = input.contents();
+    std::string_view wanted = expected.contents();
+    std::string_view line;
+    std::string_view expected_line;
+    size_t compared = 0; // expected lines matched so far
+    bool running = true;
+    while (running && next_line(lines, line))
+    {
+        if (line == "Exit" || line == "exit")
+        {
+            break;
+        }
+        check.lines++;
+        running = session.execute_line(line);
+        out.flush();
+
+        std::string_view produced = responses;
+        std::string_view response;
+        while (next_line(produced, response))
+        {
+            if (same_words(response, ""))
+            {
+                continue;
+            }
+            if (!next_nonblank(wanted, expected_line))
+            {
+                break; // responses past the expected output are ignored
+            }
+            if (!same_words(response, expected_line))
+            {
+                check.mismatch = "line " + std::to_string(compared + 1) + " after input line " +
+                                 std::to_string(check.lines) + ": output is '" + std::string(response) +
+                                 "' but expected '" + std::string(expected_line) + "'";
+                check.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                return;
+            }
+            compared++;
+        }
+        responses.clear();
+    }
+    if (next_nonblank(wanted, expected_line))
+    {
+        check.mismatch = "output ended after " + std::to_string(compared) + " lines, expected '" +
+                         std::string(expected_line) + "' next";
+    }
+    else
+    {
+        check.passed = true;
+    }
+    check.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    size_t slowest = 5;
+    std::string timings_path;
+    std::vector<std::filesystem::path> folders;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--slowest" && i + 1 < argc)
+        {
+            slowest = std::atoi(argv[++i]);
+        }
+        else if (arg == "--timings" && i + 1 < argc)
+        {
+            timings_path = argv[++i];
+        }
+        else
+        {
+            folders.push_back(arg);
+        }
+    }
+    if (folders.empty())
+    {
+        std::cerr << "Usage: regress [-j <threads>] [--slowest <cases>] [--timings <file>] <test_cases_folder>...\n";
+        return 1;
+    }
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+
+    std::vector<Case> cases;
+    for (const std::filesystem::path &folder : folders)
+    {
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(folder, error))
+        {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("input", 0) != 0)
+            {
+                continue;
+            }
+            // every "input" in the name becomes "output", as grader.py's str.replace does
+            std::string output_name;
+            for (size_t at = 0; at < name.size();)
+            {
+                if (name.compare(at, 5, "input") == 0)
+                {
+                    output_name += "output";
+                    at += 5;
+                }
+                else
+                {
+                    output_name += name[at++];
+                }
+            }
+            Case check;
+            check.input = entry.path();
+            check.expected = folder / output_name;
+            cases.push_back(std::move(check));
+        }
+        if (error)
+        {
+            std::cerr << "regress: cannot read " << folder.string() << ": " << error.message() << "\n";
+            return 1;
+        }
+    }
+    std::sort(cases.begin(), cases.end(), [](const Case &a, const Case &b)
+              { return a.input < b.input; });
+
+    // workers take the next unchecked case until none are left
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < cases.size(); i = next++)
+        {
+            run_case(cases[i]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads && t < cases.size(); ++t)
+    {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    size_t lines = 0;
+    double busy = 0;
+    std::vector<double> per_line;
+    for (const Case &check : cases)
+    {
+        if (!check.passed)
+        {
+            std::cout << "FAIL " << check.input.string() << ": " << check.mismatch << "\n";
+            failed++;
+        }
+        lines += check.lines;
+        busy += check.seconds;
+        if (check.lines > 0)
+        {
+            per_line.push_back(check.seconds / check.lines);
+        }
+    }
+    std::cout << std::fixed << std::setprecision(3) << "regress: " << cases.size() << " cases, "
+              << cases.size() - failed << " passed, " << failed << " failed, " << lines << " lines in " << wall
+              << " s on " << std::min<size_t>(threads, cases.size()) << " threads (" << busy << " s in cases)\n";
+
+    std::vector<const Case *> by_time;
+    for (const Case &check : cases)
+    {
+        by_time.push_back(&check);
+    }
+    std::sort(by_time.begin(), by_time.end(), [](const Case *a, const Case *b)
+              { return a->seconds > b->seconds; });
+    double median = 0;
+    if (!per_line.empty())
+    {
+        std::nth_element(per_line.begin(), per_line.begin() + per_line.size() / 2, per_line.end());
+        median = per_line[per_line.size() / 2];
+    }
+    auto print_case = [](const Case &check)
+    {
+        std::cout << "  " << std::setw(10) << check.seconds * 1e3 << " ms " << std::setw(8) << check.lines
+                  << " lines " << std::setw(9) << (check.lines > 0 ? check.seconds * 1e6 / check.lines : 0.0)
+                  << " us/line  " << check.input.string() << "\n";
+    };
+    if (slowest > 0 && !by_time.empty())
+    {
+        std::cout << "slowest cases:\n";
+        for (size_t i = 0; i < slowest && i < by_time.size(); ++i)
+        {
+            print_case(*by_time[i]);
+        }
+    }
+    bool any_outlier = false;
+    for (const Case *check : by_time)
+    {
+        if (check->lines > 0 && check->seconds / check->lines > 10 * median)
+        {
+            if (!any_outlier)
+            {
+                std::cout << "outliers, over 10x the median of " << median * 1e6 << " us/line:\n";
+                any_outlier = true;
+            }
+            print_case(*check);
+        }
+    }
+
+    if (!timings_path.empty())
+    {
+        std::ofstream timings(timings_path);
+        timings << "case,lines,microseconds,passed\n";
+        for (const Case &check : cases)
+        {
+            timings << check.input.string() << "," << check.lines << "," << check.seconds * 1e6 << ","
+                    << (check.passed ? 1 : 0) << "\n";
+        }
+        if (!timings)
+        {
+            std::cerr << "regress: cannot write " << timings_path << "\n";
+            return 1;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
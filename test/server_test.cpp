@@ -0,0 +1,349 @@
+/**
+ * @file server_test.cpp
+ * @brief Differential test for the sharded multi-world server in Server.h.
+ *
+ * Every world gets one or two of the files in the test-cases folder, each up to its exit line,
+ * so a world that gets two ends after the first and starts again under the same id. The lines
+ * of all worlds are interleaved in a random order and sent over a socket pair by a writer
+ * thread while the server runs with several numbers of shards. The responses of every world,
+ * picked out by their tag, must be what a Session executing its files one after the other
+ * writes.
+ *
+ * Then the server listens on a Unix socket: one client starts some worlds and disconnects, a
+ * second one continues them once the first got all its responses, and stop ends the server.
+ * The worlds must carry on across the two connections.
+ *
+ * Usage: server_test <test_cases_folder>
+ */
+
+#include "../src/LineReader.h"
+#include "../src/OutputSink.h"
+#include "../src/Server.h"
+#include "../src/Session.h"
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Executes an input line by line in a new Session, as the --input loop does.
+ *
+ * @param input The lines, each ending in '\n'.
+ * @return The responses.
+ */
+static std::string run_sequential(std::string_view input)
+{
+    std::string responses;
+    OutputSink out(responses);
+    Session session(out);
+    LineReader reader(input);
+    std::string_view line;
+    while (reader.next(line) && line != "Exit" && session.execute_line(line))
+    {
+    }
+    out.flush();
+    return responses;
+}
+
+/**
+ * @brief Writes all of a string to a descriptor.
+ *
+ * @param fd The descriptor.
+ * @param data The string.
+ * @return true if everything was written, false otherwise.
+ */
+static bool write_all(int fd, const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n <= 0)
+        {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads from a descriptor until the end of its input.
+ *
+ * @param fd The descriptor.
+ * @return Everything read.
+ */
+static std::string read_all(int fd)
+{
+    std::string data;
+    char chunk[4096];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) > 0)
+    {
+        data.append(chunk, n);
+    }
+    return data;
+}
+
+/**
+ * @brief Splits tagged responses by world.
+ *
+ * @param tagged The response lines, each "<world>\t<response>\n".
+ * @param worlds Set to the responses of every world, without their tag.
+ * @return false if a line has no tag, true otherwise.
+ */
+static bool split_by_world(const std::string &tagged, std::map<std::string, std::string> &worlds)
+{
+    std::istringstream lines(tagged);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos)
+        {
+            return false;
+        }
+        worlds[line.substr(0, tab)] += line.substr(tab + 1) + "\n";
+    }
+    return true;
+}
+
+/**
+ * @brief Connects to a Unix socket.
+ *
+ * @param path The path of the socket.
+ * @return The connected descriptor, or -1.
+ */
+static int connect_to(const std::string &path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Gets the tagged request lines of one world.
+ *
+ * @param world The world id.
+ * @param input The lines, each ending in '\n'.
+ * @return The requests.
+ */
+static std::string tag_lines(const std::string &world, const std::string &input)
+{
+    std::string tagged;
+    std::istringstream lines(input);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        tagged += world + "\t" + line + "\n";
+    }
+    return tagged;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: server_test <test_cases_folder>\n";
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // every test case up to and including its exit line
+    std::vector<std::string> cases;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().filename().string().rfind("input", 0) != 0)
+        {
+            continue;
+        }
+        std::ifstream file(entry.path());
+        std::string input;
+        std::string line;
+        while (std::getline(file, line) && line != "Exit")
+        {
+            input += line + "\n";
+        }
+        cases.push_back(input + "Exit\n");
+    }
+
+    std::mt19937 rng(25);
+    std::vector<std::string> ids;
+    std::vector<std::vector<std::string>> lines; // the lines of every world, in order
+    std::map<std::string, std::string> expected;
+    for (int w = 0; w < 60; ++w)
+    {
+        ids.push_back("world-" + std::to_string(w));
+        lines.emplace_back();
+        for (int part = 0; part < (w % 3 == 0 ? 2 : 1); ++part)
+        {
+            const std::string &input = cases[rng() % cases.size()];
+            expected[ids.back()] += run_sequential(input);
+            std::istringstream stream(input);
+            std::string line;
+            while (std::getline(stream, line))
+            {
+                lines.back().push_back(line);
+            }
+        }
+    }
+
+    // the lines of all worlds in a random order, keeping the order within every world
+    std::string requests;
+    std::vector<size_t> next(ids.size(), 0);
+    std::vector<size_t> open(ids.size());
+    for (size_t w = 0; w < ids.size(); ++w)
+    {
+        open[w] = w;
+    }
+    while (!open.empty())
+    {
+        size_t pick = rng() % open.size();
+        size_t w = open[pick];
+        requests += ids[w] + "\t" + lines[w][next[w]++] + "\n";
+        if (next[w] == lines[w].size())
+        {
+            open[pick] = open.back();
+            open.pop_back();
+        }
+    }
+
+    int failures = 0;
+    for (int shards : {1, 2, 5})
+    {
+        int pair[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+        {
+            std::cerr << "cannot create a socket pair\n";
+            return 1;
+        }
+        std::thread writer([&]
+                           { write_all(pair[0], requests);
+                             ::shutdown(pair[0], SHUT_WR); });
+        std::string tagged;
+        std::thread reader([&]
+                           { tagged = read_all(pair[0]); });
+
+        Server server(shards);
+        server.add_connection(pair[1], pair[1]);
+        server.run();
+        ::close(pair[1]);
+        writer.join();
+        reader.join();
+        ::close(pair[0]);
+
+        std::map<std::string, std::string> responses;
+        if (!split_by_world(tagged, responses))
+        {
+            std::cerr << shards << " shards: a response without a world id\n";
+            failures++;
+            continue;
+        }
+        for (const std::string &id : ids)
+        {
+            if (responses[id] != expected[id])
+            {
+                std::cerr << shards << " shards: " << id << " gave different responses\n";
+                failures++;
+            }
+        }
+        if (server.world_count() != 0)
+        {
+            std::cerr << shards << " shards: " << server.world_count() << " worlds are left after their exit\n";
+            failures++;
+        }
+    }
+
+    // two clients in turn on a listening socket, the second continuing the worlds of the first
+    std::string path = (std::filesystem::temp_directory_path() / ("server_test." + std::to_string(::getpid()))).string();
+    Server server(3);
+    if (!server.listen(path))
+    {
+        return 1;
+    }
+    std::thread serving([&]
+                        { server.run(); });
+    std::map<std::string, std::string> responses;
+    size_t worlds_started = 0;
+    for (int client = 0; client < 2; ++client)
+    {
+        std::string sent;
+        std::string answers;
+        for (size_t w = 0; w < ids.size(); w += 7)
+        {
+            // the first client sends everything before the exit of the world's first file
+            std::string first;
+            std::string rest;
+            std::istringstream stream(cases[w % cases.size()]);
+            std::string line;
+            bool done = false;
+            while (std::getline(stream, line))
+            {
+                done = done || line == "Exit";
+                (done ? rest : first) += line + "\n";
+            }
+            sent += tag_lines(ids[w], client == 0 ? first : rest);
+            if (client == 0)
+            {
+                expected["socket-" + ids[w]] = run_sequential(first + rest);
+                worlds_started++;
+            }
+        }
+        int fd = connect_to(path);
+        if (fd < 0 || !write_all(fd, sent))
+        {
+            std::cerr << "cannot send to " << path << "\n";
+            return 1;
+        }
+        ::shutdown(fd, SHUT_WR);
+        split_by_world(read_all(fd), responses);
+        ::close(fd);
+        if (client == 0 && server.world_count() != worlds_started)
+        {
+            std::cerr << server.world_count() << " worlds exist between the clients instead of " << worlds_started
+                      << "\n";
+            failures++;
+        }
+    }
+    server.stop();
+    serving.join();
+    for (size_t w = 0; w < ids.size(); w += 7)
+    {
+        if (responses[ids[w]] != expected["socket-" + ids[w]])
+        {
+            std::cerr << ids[w] << " gave different responses across two connections\n";
+            failures++;
+        }
+    }
+    if (std::filesystem::exists(path))
+    {
+        std::cerr << path << " is left after the server ended\n";
+        failures++;
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " server checks failed\n";
+        return 1;
+    }
+    std::cout << "server_test: " << ids.size() << " interleaved worlds matched with 1, 2 and 5 shards, "
+              << worlds_started << " worlds carried across two connections\n";
+    return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file small_vector_test.cpp
+ * @brief Differential test for the inline small vectors in SmallVector.h.
+ *
+ * A SmallVector used as a sorted set is driven with a random sequence of insertions and compared
+ * after every step against a std::set, which is what Monster kept its signs and potions in before.
+ * Another one is appended to and compared against a std::vector. The lists are copied and moved
+ * along the way, both while their values are in place and after they spilled to the heap, and
+ * every copy must hold the same values as its source while staying independent of it.
+ *
+ * Usage: small_vector_test
+ */
+
+#include "../src/SmallVector.h"
+#include "../src/Monster.h"
+#include "../src/Potion.h"
+#include <iostream>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Compares a list with the values of a reference container.
+ *
+ * @param list The list under test.
+ * @param expected The reference, iterated in the order the list must have.
+ * @return true if both hold the same values in the same order.
+ */
+template <typename List, typename Reference>
+static bool same_values(const List &list, const Reference &expected)
+{
+    return list.size() == expected.size() && std::equal(list.begin(), list.end(), expected.begin());
+}
+
+int main()
+{
+    std::mt19937 rng(29);
+    int failures = 0;
+    size_t steps = 0;
+    for (int round = 0; round < 200; ++round)
+    {
+        SmallVector<Id, 4> sorted;
+        std::set<Id> reference;
+        SmallVector<std::pair<Id, int>, 4> appended;
+        std::vector<std::pair<Id, int>> appended_reference;
+        int length = rng() % 24; // up to six times the values kept in place
+        for (int i = 0; i < length; ++i, ++steps)
+        {
+            Id id = rng() % 16;
+            if (sorted.insert_sorted(id) != reference.insert(id).second)
+            {
+                std::cerr << "insert_sorted disagrees with std::set about " << id << "\n";
+                failures++;
+            }
+            if (!same_values(sorted, reference) || !sorted.contains_sorted(id))
+            {
+                std::cerr << "the sorted list differs from std::set after " << i + 1 << " insertions\n";
+                failures++;
+            }
+            appended.push_back({id, (int)i});
+            appended_reference.push_back({id, (int)i});
+
+            if (rng() % 4 == 0)
+            {
+                size_t grown = sorted.contains_sorted(100) ? 0 : 1;
+                SmallVector<Id, 4> copy(sorted);
+                SmallVector<Id, 4> moved(std::move(copy));
+                copy = moved;
+                moved.insert_sorted(100); // must not reach the list it was copied to
+                bool independent = copy.size() == sorted.size() && moved.size() == sorted.size() + grown;
+                copy = std::move(moved);
+                if (!independent || !same_values(sorted, reference) || copy.size() != sorted.size() + grown ||
+                    !copy.contains_sorted(100) || !moved.empty())
+                {
+                    std::cerr << "copying or moving a list of " << sorted.size() << " values went wrong\n";
+                    failures++;
+                }
+                sorted = copy;
+                reference.insert(100);
+            }
+        }
+        SmallVector<std::pair<Id, int>, 4> assigned;
+        assigned.assign(appended_reference.begin(), appended_reference.end());
+        if (!same_values(appended, appended_reference) || !same_values(assigned, appended_reference))
+        {
+            std::cerr << "the appended list differs from std::vector after " << length << " values\n";
+            failures++;
+        }
+        appended.clear();
+        if (!appended.empty())
+        {
+            std::cerr << "clear left values behind\n";
+            failures++;
+        }
+    }
+
+    if (sizeof(SmallVector<Id, 4>) != 24)
+    {
+        std::cerr << "SmallVector<Id, 4> takes " << sizeof(SmallVector<Id, 4>) << " bytes instead of 24\n";
+        failures++;
+    }
+    if (failures > 0)
+    {
+        std::cerr << failures << " small vector checks failed\n";
+        return 1;
+    }
+    std::cout << "small_vector_test: " << steps << " steps matched std::set and std::vector, a Monster takes "
+              << sizeof(Monster) << " bytes and a Potion " << sizeof(Potion) << "\n";
+    return 0;
+}
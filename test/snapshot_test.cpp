@@ -0,0 +1,202 @@
+/**
+ * @file snapshot_test.cpp
+ * @brief Round-trip test for the session snapshots described in Snapshot.h.
+ *
+ * Every file in the test-cases folder is executed once from start to end. It is then executed
+ * again, interrupted at several points: the session is saved to a snapshot, the snapshot is
+ * restored into a new session, and the new session executes the rest of the file. The responses
+ * of both halves together must be the responses of the uninterrupted run, and saving a restored
+ * session must give back the same bytes.
+ *
+ * Damaged snapshots must be rejected: every truncation, every single flipped byte, a snapshot
+ * of another version and a restore into a session that already executed a line.
+ *
+ * Usage: snapshot_test <test_cases_folder>
+ */
+
+#include "../src/OutputSink.h"
+#include "../src/Session.h"
+#include "../src/Snapshot.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Executes lines in a session the way the interactive loop does.
+ *
+ * @param session The session to execute the lines in.
+ * @param lines The lines of the file.
+ * @param first The index of the first line to execute.
+ * @param last The index one past the last line to execute.
+ * @return false if the run ended before last, true otherwise.
+ */
+static bool run(Session &session, const std::vector<std::string> &lines, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; ++i)
+    {
+        if (lines[i] == "Exit" || !session.execute_line(lines[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that a damaged snapshot is rejected.
+ *
+ * @param data The damaged snapshot.
+ * @return true if a new session refuses to restore it.
+ */
+static bool rejected(const std::string &data)
+{
+    std::string ignored;
+    OutputSink out(ignored);
+    Session session(out);
+    return !session.restore_snapshot(data);
+}
+
+/**
+ * @brief Interrupts a file at one point and checks that resuming from a snapshot changes nothing.
+ *
+ * @param lines The lines of the file.
+ * @param split The number of lines executed before the snapshot.
+ * @param expected The responses of the uninterrupted run.
+ * @param snapshot Set to the snapshot taken at the split.
+ * @return true if the resumed run matches, false otherwise.
+ */
+static bool check_split(const std::vector<std::string> &lines, size_t split, const std::string &expected,
+                        std::string &snapshot)
+{
+    std::string responses;
+    {
+        OutputSink out(responses);
+        Session first(out);
+        if (!run(first, lines, 0, split))
+        {
+            return true; // the file ended before the split, nothing to resume
+        }
+        first.save_snapshot(snapshot);
+    }
+
+    std::string resaved;
+    {
+        OutputSink out(responses);
+        Session second(out);
+        if (!second.restore_snapshot(snapshot) || second.lines_executed() != split)
+        {
+            return false;
+        }
+        second.save_snapshot(resaved);
+        run(second, lines, split, lines.size());
+    }
+    return responses == expected && resaved == snapshot;
+}
+
+/**
+ * @brief Runs every check on one file.
+ *
+ * @param lines The lines of the file.
+ * @param origin The name of the file, used in error messages.
+ * @return The number of failed checks.
+ */
+static int check_file(const std::vector<std::string> &lines, const std::string &origin)
+{
+    std::string expected;
+    {
+        OutputSink out(expected);
+        Session session(out);
+        run(session, lines, 0, lines.size());
+    }
+
+    int failures = 0;
+    std::string snapshot;
+    size_t n = lines.size();
+    for (size_t split : {(size_t)0, (size_t)1, n / 4, n / 2, 3 * n / 4, n > 0 ? n - 1 : 0, n})
+    {
+        if (!check_split(lines, split, expected, snapshot))
+        {
+            std::cerr << origin << ": resuming after " << split << " lines changed the responses\n";
+            failures++;
+        }
+    }
+
+    // snapshot now holds the state after the whole file, the damaged copies are made from it
+    for (size_t size = 0; size < snapshot.size(); ++size)
+    {
+        if (!rejected(snapshot.substr(0, size)))
+        {
+            std::cerr << origin << ": snapshot truncated to " << size << " bytes was accepted\n";
+            failures++;
+        }
+    }
+    for (size_t i = 0; i < snapshot.size(); ++i)
+    {
+        std::string damaged = snapshot;
+        damaged[i] ^= 0x20;
+        if (!rejected(damaged))
+        {
+            std::cerr << origin << ": snapshot with byte " << i << " flipped was accepted\n";
+            failures++;
+        }
+    }
+
+    // another version with a valid checksum
+    std::string other = snapshot.substr(0, snapshot.size() - 4);
+    other[Snapshot::magic.size()]++;
+    SnapshotWriter(other).u32(Snapshot::checksum(other));
+    if (!rejected(other))
+    {
+        std::cerr << origin << ": snapshot of another version was accepted\n";
+        failures++;
+    }
+
+    std::string ignored;
+    OutputSink out(ignored);
+    Session used(out);
+    used.execute_line("Total ingredient ?");
+    if (used.restore_snapshot(snapshot))
+    {
+        std::cerr << origin << ": snapshot was restored into a session that already executed a line\n";
+        failures++;
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: snapshot_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    int files = 0;
+    int failures = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().filename().string().rfind("input", 0) != 0)
+        {
+            continue;
+        }
+        std::ifstream file(entry.path());
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            lines.push_back(line);
+        }
+        files++;
+        failures += check_file(lines, entry.path().filename().string());
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " snapshot checks failed\n";
+        return 1;
+    }
+    std::cout << "snapshot_test: " << files << " files resumed identically from snapshots\n";
+    return 0;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file stats_test.cpp
+ * @brief Test for the counters and latency histograms described in Stats.h.
+ *
+ * The buckets of LatencyHistogram must tile the whole 64-bit range without gaps, and the
+ * percentiles it reports for random latencies must be within the precision of a bucket above the
+ * exact percentiles of the same values. Every file in the test-cases folder is then executed in
+ * a Session, and the number of lines it counted and timed per command type must be the number a
+ * separate parser finds in the file. The JSON must carry the same totals.
+ *
+ * Built with WITCHER_STATS regardless of the STATS setting.
+ *
+ * Usage: stats_test <test_cases_folder>
+ */
+
+#include "../src/OutputSink.h"
+#include "../src/Session.h"
+#include "../src/Stats.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Checks that consecutive buckets cover consecutive values and that values land in their bucket.
+ *
+ * @return true if the buckets are consistent, false otherwise.
+ */
+static bool check_buckets()
+{
+    for (int bucket = 0; bucket + 1 < LatencyHistogram::bucket_count; ++bucket)
+    {
+        if (LatencyHistogram::highest_in(bucket) + 1 != LatencyHistogram::lowest_in(bucket + 1) ||
+            LatencyHistogram::bucket_of(LatencyHistogram::lowest_in(bucket)) != bucket ||
+            LatencyHistogram::bucket_of(LatencyHistogram::highest_in(bucket)) != bucket)
+        {
+            std::cerr << "bucket " << bucket << " doesn't meet the next one\n";
+            return false;
+        }
+    }
+    if (LatencyHistogram::bucket_of(UINT64_MAX) != LatencyHistogram::bucket_count - 1 ||
+        LatencyHistogram::highest_in(LatencyHistogram::bucket_count - 1) != UINT64_MAX)
+    {
+        std::cerr << "the last bucket doesn't end at the largest value\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Compares the percentiles of a histogram with the exact ones for random latencies.
+ *
+ * @param rng The random generator.
+ * @return true if every percentile is within a bucket of the exact one, false otherwise.
+ */
+static bool check_percentiles(std::mt19937_64 &rng)
+{
+    for (int round = 0; round < 20; ++round)
+    {
+        LatencyHistogram histogram;
+        std::vector<uint64_t> values(1 + rng() % 5000);
+        std::uniform_real_distribution<double> magnitude(0, 30);
+        for (uint64_t &value : values)
+        {
+            value = (uint64_t)std::exp2(magnitude(rng));
+            histogram.record(value);
+        }
+        std::sort(values.begin(), values.end());
+
+        if (histogram.count() != values.size() || histogram.min() != values.front() ||
+            histogram.max() != values.back())
+        {
+            std::cerr << "round " << round << ": count, min or max differ\n";
+            return false;
+        }
+        for (double percentile : {0.0, 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0})
+        {
+            size_t rank = std::max<size_t>(1, (size_t)std::ceil(percentile / 100.0 * values.size()));
+            uint64_t exact = values[std::min(rank, values.size()) - 1];
+            uint64_t reported = histogram.value_at_percentile(percentile);
+            if (reported < exact || reported > exact + exact / LatencyHistogram::sub_buckets)
+            {
+                std::cerr << "round " << round << ": p" << percentile << " is " << reported << ", exactly "
+                          << exact << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Executes a file and compares the counters of the session with the types of its lines.
+ *
+ * @param path The file.
+ * @return true if the counters and the JSON match the file, false otherwise.
+ */
+static bool check_file(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+
+    std::string ignored;
+    OutputSink out(ignored);
+    Session session(out);
+    Utils::Parser parser;
+    uint64_t expected[Stats::type_count] = {};
+    uint64_t total = 0;
+    for (const std::string &l : lines)
+    {
+        if (l == "Exit")
+        {
+            break;
+        }
+        CommandType type = parser.parse(l).type;
+        expected[(int)type]++;
+        total++;
+        if (!session.execute_line(l))
+        {
+            break;
+        }
+    }
+
+    const Stats &stats = session.statistics();
+    for (int type = 0; type < Stats::type_count; ++type)
+    {
+        uint64_t handled = type == (int)CommandType::Exit ? 0 : expected[type];
+        if (stats.executed((CommandType)type) != expected[type] ||
+            stats.line((CommandType)type).count() != expected[type] ||
+            stats.handler((CommandType)type).count() != handled)
+        {
+            std::cerr << path.filename().string() << ": type " << type << " counted "
+                      << stats.executed((CommandType)type) << " times, expected " << expected[type] << "\n";
+            return false;
+        }
+    }
+
+    std::string json;
+    stats.write_json(json);
+    std::string head = "{\"lines\":" + std::to_string(total) + ",\"invalid\":" +
+                       std::to_string(expected[(int)CommandType::Invalid]) + ",";
+    if (json.compare(0, head.size(), head) != 0 || std::count(json.begin(), json.end(), '{') !=
+                                                           std::count(json.begin(), json.end(), '}'))
+    {
+        std::cerr << path.filename().string() << ": JSON doesn't start with " << head << "\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: stats_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    std::mt19937_64 rng(21);
+    if (!check_buckets() || !check_percentiles(rng))
+    {
+        return 1;
+    }
+
+    int files = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().filename().string().rfind("input", 0) != 0)
+        {
+            continue;
+        }
+        files++;
+        if (!check_file(entry.path()))
+        {
+            return 1;
+        }
+    }
+    std::cout << "stats_test: histograms within a bucket, counters of " << files << " files match\n";
+    return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file tokenizer_test.cpp
+ * @brief Differential test for the hand-written tokenizer in Utils::split_line.
+ *
+ * The original tokenizer matched every line against the `[^\s,?]+|[?,]` regular expression.
+ * This test keeps that implementation as a reference and checks that Utils::split_line produces
+ * the same token stream for every line of every file in the test-cases folder, and for a set of
+ * randomly generated lines built from the characters the grammar cares about. The keywords it
+ * gives the first two tokens must be those a linear search over the keyword list finds.
+ * The potion names parsed from a few lines must be single-spaced, and views into the line
+ * whenever the line spells them that way.
+ *
+ * Usage: tokenizer_test <test_cases_folder>
+ */
+
+#include "../src/Utils.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+static Utils::Parser parser; // the tokenizer under test
+
+/**
+ * @brief Reference tokenizer, the regex based implementation split_line replaced.
+ *
+ * @param line The line of text to be split.
+ * @return The tokens found in the line.
+ */
+static std::vector<std::string> regex_split(const std::string &line)
+{
+    static const std::regex pattern(R"([^\s,?]+|[?,])");
+    std::vector<std::string> tokens;
+    auto begin = std::sregex_iterator(line.begin(), line.end(), pattern);
+    auto end = std::sregex_iterator();
+    for (auto it = begin; it != end; ++it)
+    {
+        tokens.push_back(it->str());
+    }
+    return tokens;
+}
+
+/**
+ * @brief Reference classifier, a linear search over the keywords the perfect hash is built from.
+ *
+ * @param word The token to be classified.
+ * @return The keyword the token is, or Keyword::None.
+ */
+static Utils::Keyword linear_classify(std::string_view word)
+{
+    for (const Utils::keyword_table::Entry &entry : Utils::keyword_table::entries)
+    {
+        if (entry.text == word)
+        {
+            return entry.keyword;
+        }
+    }
+    return Utils::Keyword::None;
+}
+
+/**
+ * @brief Compares both tokenizers on a single line and reports any difference.
+ *
+ * @param line The line to be tokenized.
+ * @param origin A short description of where the line comes from, used in the error message.
+ * @return true if both tokenizers agree, false otherwise.
+ */
+static bool check_line(const std::string &line, const std::string &origin)
+{
+    std::vector<std::string> expected = regex_split(line);
+    parser.split_line(line);
+
+    bool same = parser.word_count == (int)expected.size();
+    for (size_t i = 0; same && i < expected.size(); ++i)
+    {
+        same = parser.words[i] == expected[i];
+    }
+    for (int i = 0; same && i < 2; ++i)
+    {
+        same = parser.leading[i] == linear_classify(i < (int)expected.size() ? expected[i] : "");
+    }
+    if (!same)
+    {
+        std::cerr << "Token mismatch in " << origin << ": '" << line << "'\n";
+    }
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: tokenizer_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    int lines = 0;
+    int failures = 0;
+
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        std::ifstream file(entry.path());
+        std::string line;
+        int line_number = 0;
+        while (std::getline(file, line))
+        {
+            line_number++;
+            lines++;
+            if (!check_line(line, entry.path().filename().string() + ":" + std::to_string(line_number)))
+            {
+                failures++;
+            }
+        }
+    }
+
+    // every keyword, and words one edit away from one, as the first and second token
+    for (const Utils::keyword_table::Entry &entry : Utils::keyword_table::entries)
+    {
+        std::string keyword(entry.text);
+        std::vector<std::string> variants = {keyword, keyword + "s", keyword.substr(1), keyword.substr(0, keyword.size() - 1)};
+        for (size_t i = 0; i < keyword.size(); ++i)
+        {
+            std::string changed = keyword;
+            changed[i] ^= 0x20;
+            variants.push_back(changed);
+        }
+        for (const std::string &variant : variants)
+        {
+            lines += 2;
+            failures += !check_line(variant + " x", "keyword variant") + !check_line("Geralt " + variant, "keyword variant");
+        }
+    }
+
+    // random lines over an alphabet rich in separators, so that edge cases around them are covered
+    const std::string alphabet = "ab Z09,? \t\r\v\f-.'";
+    std::mt19937 rng(230);
+    std::uniform_int_distribution<int> length(0, 40);
+    std::uniform_int_distribution<int> pick(0, alphabet.size() - 1);
+    for (int k = 0; k < 20000; ++k)
+    {
+        std::string line;
+        int len = length(rng);
+        for (int i = 0; i < len; ++i)
+        {
+            line += alphabet[pick(rng)];
+        }
+        lines++;
+        if (!check_line(line, "random line " + std::to_string(k)))
+        {
+            failures++;
+        }
+    }
+
+    // potion names are single-spaced, and are viewed in the line unless another separator must be joined away
+    struct NameCase
+    {
+        std::string line;
+        std::string name;
+        bool in_line;
+    };
+    const std::vector<NameCase> names = {
+        {"Geralt brews Black Blood", "Black Blood", true},
+        {"Geralt brews 3 Black  Blood", "", false},
+        {"Geralt brews Black\tBlood", "Black Blood", false},
+        {"  Geralt learns Black Blood potion consists of 2 Rebis", "Black Blood", true},
+        {"Geralt learns Black Blood potion is effective against Ghoul", "Black Blood", true},
+        {"Geralt learns Black \tBlood potion is effective against Ghoul", "Black Blood", false},
+        {"What is in Tawny Owl ?", "Tawny Owl", true},
+        {"Total potion Swallow ?", "Swallow", true},
+    };
+    for (const NameCase &expected : names)
+    {
+        lines++;
+        const Command &command = parser.parse(expected.line);
+        std::string_view name;
+        switch (command.type)
+        {
+        case CommandType::Brew:
+        case CommandType::BrewBatch:
+            name = command.brew.potion;
+            break;
+        case CommandType::PotionRecipe:
+            name = command.potion_recipe.potion;
+            break;
+        case CommandType::PotionKnowledge:
+            name = command.potion_knowledge.potion;
+            break;
+        case CommandType::PotionCount:
+        case CommandType::PotionFormula:
+            name = command.query.name;
+            break;
+        default:
+            break;
+        }
+        bool in_line = !name.empty() && name.data() >= expected.line.data() &&
+                       name.data() + name.size() <= expected.line.data() + expected.line.size();
+        if (name != expected.name || in_line != expected.in_line)
+        {
+            std::cerr << "the potion name of '" << expected.line << "' is '" << name << "'"
+                      << (in_line ? " in the line" : "") << ", expected '" << expected.name << "'\n";
+            failures++;
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " of " << lines << " lines tokenized differently\n";
+        return 1;
+    }
+    std::cout << "tokenizer_test: " << lines << " lines tokenized identically\n";
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file totals_cache_test.cpp
+ * @brief Differential test for the segmented totals rendering in TotalsCache.h.
+ *
+ * A CountStore is driven with random updates over enough names to make segments split and
+ * disappear, every update is reported to a TotalsCache the way the inventory reports it, and
+ * the cached answer is compared against rendering a std::map of the same counts from scratch,
+ * which is how the totals questions used to be answered. The runs the cache publishes for views
+ * are joined and compared the same way, and some are kept and compared again at the end, as a
+ * run shared with later publishes must never change.
+ *
+ * Usage: totals_cache_test
+ */
+
+#include "../src/CountStore.h"
+#include "../src/OutputSink.h"
+#include "../src/SymbolTable.h"
+#include "../src/TotalsCache.h"
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Renders counts the way the totals questions were answered before the cache.
+ *
+ * @param counts The counts, keyed on name so they iterate in alphabetical order.
+ * @return The expected answer.
+ */
+static std::string render_all(const std::map<std::string, int> &counts)
+{
+    if (counts.empty())
+    {
+        return "None\n";
+    }
+    std::string text;
+    for (const auto &pair : counts)
+    {
+        if (!text.empty())
+        {
+            text += ", ";
+        }
+        text += std::to_string(pair.second) + " " + pair.first;
+    }
+    return text + "\n";
+}
+
+/**
+ * @brief Joins published runs into the answer a view writes from them.
+ *
+ * @param runs The runs of one publish.
+ * @return The answer.
+ */
+static std::string join_runs(const std::vector<std::shared_ptr<const TotalsCache::Run>> &runs)
+{
+    std::string text;
+    for (const auto &run : runs)
+    {
+        for (const auto &segment : *run)
+        {
+            text += (text.empty() ? "" : ", ") + *segment;
+        }
+    }
+    return text.empty() ? "None\n" : text + "\n";
+}
+
+int main()
+{
+    SymbolTable symbols;
+    CountStore store;
+    TotalsCache cache(symbols);
+    std::map<std::string, int> expected;
+    std::vector<std::pair<std::vector<std::shared_ptr<const TotalsCache::Run>>, std::string>> kept;
+
+    std::mt19937 rng(230);
+    std::uniform_int_distribution<int> pick(0, 1999);
+    std::uniform_int_distribution<int> delta(-4, 6);
+    std::uniform_int_distribution<int> ask(0, 49);
+    for (int step = 0; step < 200000; ++step)
+    {
+        std::string name = "Name" + std::to_string(pick(rng));
+        Id id = symbols.intern(name);
+        int d = delta(rng);
+
+        int before = store.get(id);
+        store.add(id, d);
+        cache.changed(id, before, store.get(id));
+        if (store.get(id) > 0)
+        {
+            expected[name] = store.get(id);
+        }
+        else
+        {
+            expected.erase(name);
+        }
+
+        if (ask(rng) == 0)
+        {
+            std::string answer;
+            {
+                OutputSink out(answer);
+                cache.write(out, store);
+            }
+            if (answer != render_all(expected))
+            {
+                std::cerr << "totals mismatch at step " << step << "\n";
+                return 1;
+            }
+            std::vector<std::shared_ptr<const TotalsCache::Run>> runs;
+            cache.publish(runs, store);
+            if (join_runs(runs) != answer)
+            {
+                std::cerr << "published totals mismatch at step " << step << "\n";
+                return 1;
+            }
+            if (step % 97 == 0)
+            {
+                kept.emplace_back(std::move(runs), answer);
+            }
+        }
+    }
+    for (const auto &old : kept)
+    {
+        if (join_runs(old.first) != old.second)
+        {
+            std::cerr << "published totals changed after a later update\n";
+            return 1;
+        }
+    }
+    std::cout << "totals_cache_test: cached and published answers match, " << kept.size() << " kept runs unchanged\n";
+    return 0;
+}
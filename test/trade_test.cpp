@@ -0,0 +1,201 @@
+/**
+ * @file trade_test.cpp
+ * @brief Differential test for the merged trade deltas in TradeDelta.h and the batch trade API.
+ *
+ * Random item lists, with ids repeated often, are merged into a TradeDelta and compared with the
+ * sums a std::map keeps of the same items. Then three inventories get the same random encounters
+ * and trades: one handles every trade with handle_trade, one hands them to handle_trades in
+ * batches of random size, and a std::map of trophy counts decides what each trade must answer,
+ * a trophy named twice needing both counts. The responses of all three and the totals the two
+ * inventories end up with must be the same.
+ *
+ * Usage: trade_test
+ */
+
+#include "../src/Inventory.h"
+#include "../src/OutputSink.h"
+#include "../src/SymbolTable.h"
+#include "../src/TradeDelta.h"
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char *monster_names[] = {"Harpy", "Ghoul", "Wraith", "Nekker", "Griffin", "Leshen"};
+static const char *ingredient_names[] = {"Rebis", "Vitriol", "Aether", "Quebrith", "Sol", "Caelum"};
+
+/**
+ * @brief Draws a list of items from the first few ids, so that ids repeat.
+ *
+ * @param ids The ids to draw from.
+ * @param rng The random generator.
+ * @param huge Whether some counts may be close to the largest int.
+ * @return The items.
+ */
+static std::vector<Item> random_items(const std::vector<Id> &ids, std::mt19937 &rng, bool huge)
+{
+    std::vector<Item> items(1 + rng() % 4);
+    for (Item &item : items)
+    {
+        item.id = ids[rng() % ids.size()];
+        item.count = 1 + rng() % (huge && rng() % 8 == 0 ? 2000000000 : 4);
+    }
+    return items;
+}
+
+/**
+ * @brief Compares merged deltas with the sums of a std::map.
+ *
+ * @param rng The random generator.
+ * @return true if every delta matches, false otherwise.
+ */
+static bool check_merge(std::mt19937 &rng)
+{
+    std::vector<Id> ids = {7, 3, 3, 12, 0, 5};
+    TradeDelta delta;
+    for (int round = 0; round < 20000; ++round)
+    {
+        std::vector<Item> items = random_items(ids, rng, true);
+        if (round % 2 == 0)
+        {
+            delta.assign(items);
+        }
+        else
+        {
+            // split into two appends, as a batch merges the items of several trades
+            delta.clear();
+            std::vector<Item> head(items.begin(), items.begin() + items.size() / 2);
+            std::vector<Item> tail(items.begin() + items.size() / 2, items.end());
+            delta.append(head);
+            delta.append(tail);
+            delta.merge();
+        }
+
+        std::map<Id, int64_t> expected;
+        for (const Item &item : items)
+        {
+            expected[item.id] += item.count;
+        }
+        auto it = expected.begin();
+        bool same = delta.entries().size() == expected.size();
+        for (size_t i = 0; same && i < delta.entries().size(); ++i, ++it)
+        {
+            same = delta.entries()[i].id == it->first && delta.entries()[i].count == it->second;
+        }
+        if (!same)
+        {
+            std::cerr << "round " << round << ": the merged delta differs from the sums\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    std::mt19937 rng(24);
+    if (!check_merge(rng))
+    {
+        return 1;
+    }
+
+    SymbolTable symbols;
+    std::vector<Id> monsters;
+    std::vector<Id> ingredients;
+    for (const char *name : monster_names)
+    {
+        monsters.push_back(symbols.intern(name));
+    }
+    for (const char *name : ingredient_names)
+    {
+        ingredients.push_back(symbols.intern(name));
+    }
+
+    std::string one_text;
+    std::string batch_text;
+    std::string expected_text;
+    OutputSink one_out(one_text);
+    OutputSink batch_out(batch_text);
+    Inventory one(symbols, one_out);
+    Inventory batched(symbols, batch_out);
+    std::map<Id, int64_t> stock; // trophies the reference expects
+    for (size_t m = 0; m < monsters.size(); ++m)
+    {
+        SignKnowledgeCmd sign{"Igni", monster_names[m], symbols.intern("Igni"), monsters[m]};
+        one.handle_sign_knowledge(sign);
+        batched.handle_sign_knowledge(sign);
+    }
+    one_out.flush();
+    batch_out.flush();
+    one_text.clear();
+    batch_text.clear();
+
+    int trades = 0;
+    int accepted = 0;
+    for (int round = 0; round < 2000; ++round)
+    {
+        // a few encounters, each of which the sign wins a trophy from
+        for (int e = rng() % 6; e > 0; --e)
+        {
+            size_t m = rng() % monsters.size();
+            EncounterCmd encounter{monster_names[m], monsters[m]};
+            one.handle_encounter(encounter);
+            batched.handle_encounter(encounter);
+            expected_text += "Geralt defeats " + std::string(monster_names[m]) + "\n";
+            stock[monsters[m]]++;
+        }
+
+        std::vector<TradeCmd> batch(1 + rng() % 20);
+        int accepted_before = accepted;
+        for (TradeCmd &trade : batch)
+        {
+            trade.trophies = random_items(monsters, rng, true);
+            trade.ingredients = random_items(ingredients, rng, false); // the stock must not overflow
+            one.handle_trade(trade);
+
+            std::map<Id, int64_t> wanted;
+            bool covered = true;
+            for (const Item &item : trade.trophies)
+            {
+                wanted[item.id] += item.count;
+                covered = covered && stock[item.id] >= wanted[item.id];
+            }
+            if (covered)
+            {
+                for (const auto &pair : wanted)
+                {
+                    stock[pair.first] -= pair.second;
+                }
+                accepted++;
+            }
+            expected_text += covered ? "Trade successful\n" : "Not enough trophies\n";
+        }
+        int successful = batched.handle_trades(batch);
+        trades += batch.size();
+        one_out.flush();
+        batch_out.flush();
+        if (one_text != expected_text || batch_text != expected_text || successful != accepted - accepted_before)
+        {
+            std::cerr << "round " << round << ": the responses differ from the reference\n";
+            return 1;
+        }
+    }
+
+    one.print_trophies();
+    one.print_ingredients();
+    batched.print_trophies();
+    batched.print_ingredients();
+    one_out.flush();
+    batch_out.flush();
+    std::string one_totals = one_text.substr(expected_text.size());
+    std::string batch_totals = batch_text.substr(expected_text.size());
+    if (one_totals != batch_totals)
+    {
+        std::cerr << "the batched inventory ends with\n" << batch_totals << "instead of\n" << one_totals;
+        return 1;
+    }
+    std::cout << "trade_test: merged deltas match, " << accepted << " of " << trades
+              << " trades accepted alike one by one and in batches\n";
+    return 0;
+}
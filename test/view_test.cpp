@@ -0,0 +1,400 @@
+/**
+ * @file view_test.cpp
+ * @brief Differential test for the published inventory views in InventoryView.h.
+ *
+ * The files in the test-cases folder are joined without their exit lines and executed line by
+ * line. Questions about every name the lines mention, and the totals questions, are asked both
+ * of the session and of a view it publishes now and then, and must be answered alike. Some of
+ * the views are kept and asked again at the end, after the session moved on, so a part shared
+ * with a later view must not have changed under them.
+ *
+ * The same is done with generated lines over thousands of names, so the counts, lines and names
+ * of the views span many pages and the totals answers many blocks, and each view published shares
+ * most of them with the previous one while the pages it changed must not show in the kept views.
+ *
+ * Then a writer thread executes the same lines and publishes a view after every one, while
+ * reader threads answer questions from whatever view is current. Every answer is checked
+ * afterwards against a session that executed as many lines as the epoch of its view.
+ *
+ * Usage: view_test <test_cases_folder>
+ */
+
+#include "../src/InventoryView.h"
+#include "../src/OutputSink.h"
+#include "../src/Session.h"
+#include "../src/Utils.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Answers questions from a view.
+ *
+ * @param view The view.
+ * @param parser The parser of the calling thread.
+ * @param questions The questions.
+ * @param picked The indexes of the questions to ask.
+ * @return The answers.
+ */
+static std::string ask_view(const InventoryView &view, Utils::Parser &parser, const std::vector<std::string> &questions,
+                            const std::vector<size_t> &picked)
+{
+    std::string answers;
+    OutputSink out(answers);
+    for (size_t i : picked)
+    {
+        view.answer(parser.parse(questions[i]), out);
+    }
+    out.flush();
+    return answers;
+}
+
+/**
+ * @brief Asks questions of a session itself.
+ *
+ * @param session The session.
+ * @param answers The string the session's sink appends to, empty.
+ * @param out The sink of the session.
+ * @param questions The questions.
+ * @param picked The indexes of the questions to ask.
+ * @return The answers.
+ */
+static std::string ask_session(Session &session, std::string &answers, OutputSink &out,
+                               const std::vector<std::string> &questions, const std::vector<size_t> &picked)
+{
+    for (size_t i : picked)
+    {
+        session.execute_line(questions[i]);
+    }
+    out.flush();
+    std::string asked = answers;
+    answers.clear();
+    return asked;
+}
+
+/**
+ * @brief Spells a number in letters, since names can't hold digits.
+ *
+ * @param number The number.
+ * @return The number in base 26, with a for 0 and z for 25.
+ */
+static std::string letters(size_t number)
+{
+    std::string spelled;
+    do
+    {
+        spelled.insert(spelled.begin(), char('a' + number % 26));
+        number /= 26;
+    } while (number > 0);
+    return spelled;
+}
+
+/**
+ * @brief Collects the names a command mentions.
+ *
+ * @param command The parsed command.
+ * @param names The set the names are added to.
+ */
+static void collect_names(const Command &command, std::set<std::string> &names)
+{
+    switch (command.type)
+    {
+    case CommandType::Loot:
+        for (const Item &item : command.loot.ingredients)
+        {
+            names.emplace(item.name);
+        }
+        break;
+    case CommandType::Trade:
+        for (const Item &item : command.trade.trophies)
+        {
+            names.emplace(item.name);
+        }
+        for (const Item &item : command.trade.ingredients)
+        {
+            names.emplace(item.name);
+        }
+        break;
+    case CommandType::SignKnowledge:
+        names.emplace(command.sign_knowledge.monster);
+        break;
+    case CommandType::PotionKnowledge:
+        names.emplace(command.potion_knowledge.potion);
+        names.emplace(command.potion_knowledge.monster);
+        break;
+    case CommandType::PotionRecipe:
+        names.emplace(command.potion_recipe.potion);
+        for (const Item &item : command.potion_recipe.ingredients)
+        {
+            names.emplace(item.name);
+        }
+        break;
+    case CommandType::Encounter:
+        names.emplace(command.encounter.monster);
+        break;
+    default:
+        break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: view_test <test_cases_folder>\n";
+        return 1;
+    }
+
+    std::vector<std::string> lines;
+    std::set<std::string> names;
+    Utils::Parser parser;
+    for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (entry.path().filename().string().rfind("input", 0) != 0)
+        {
+            continue;
+        }
+        std::ifstream file(entry.path());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line != "Exit")
+            {
+                lines.push_back(line);
+                collect_names(parser.parse(line), names);
+            }
+        }
+    }
+
+    std::vector<std::string> questions = {"Total ingredient ?", "Total potion ?", "Total trophy ?", "Total  ?"};
+    for (const std::string &name : names)
+    {
+        for (const char *kind : {"ingredient", "potion", "trophy"})
+        {
+            questions.push_back("Total " + std::string(kind) + " " + name + " ?");
+        }
+        questions.push_back("What is effective against " + name + " ?");
+        questions.push_back("What is in " + name + " ?");
+    }
+    std::vector<size_t> every(questions.size());
+    for (size_t i = 0; i < every.size(); ++i)
+    {
+        every[i] = i;
+    }
+
+    // views published along the way answer like the session, then and after it moved on
+    std::string answers;
+    OutputSink out(answers);
+    Session session(out);
+    struct Kept
+    {
+        std::shared_ptr<const InventoryView> view;
+        std::string answers;
+    };
+    std::vector<Kept> kept;
+    int failures = 0;
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        session.execute_line(lines[i]);
+        out.flush();
+        answers.clear();
+        if (i % 13 != 0 && i + 1 != lines.size())
+        {
+            continue;
+        }
+        std::shared_ptr<const InventoryView> view = session.publish_view();
+        std::string expected = ask_session(session, answers, out, questions, every);
+        std::string viewed = ask_view(*view, parser, questions, every);
+        if (viewed != expected)
+        {
+            std::cerr << "the view after line " << i + 1 << " answers differently from the session\n";
+            failures++;
+        }
+        if (kept.size() < 16 && i % 7 == 0)
+        {
+            kept.push_back({view, viewed});
+        }
+    }
+    for (const Kept &old : kept)
+    {
+        if (ask_view(*old.view, parser, questions, every) != old.answers)
+        {
+            std::cerr << "the view of epoch " << old.view->epoch() << " changed after it was published\n";
+            failures++;
+        }
+    }
+
+    // views over thousands of names share most pages with the previous one, none under the kept views
+    std::mt19937 rng(260);
+    const size_t herbs = 3000, beasts = 700;
+    std::vector<std::string> generated;
+    for (int i = 0; i < 6000; ++i)
+    {
+        std::string herb = "Herb" + letters(rng() % herbs);
+        std::string beast = "Beast" + letters(rng() % beasts);
+        std::string brew = "Brew" + letters(rng() % beasts);
+        switch (rng() % 6)
+        {
+        case 0:
+        case 1:
+            generated.push_back("Geralt loots " + std::to_string(1 + rng() % 9) + " " + herb + ", 2 Herb" +
+                                letters(rng() % herbs));
+            break;
+        case 2:
+            generated.push_back("Geralt learns " + brew + " potion consists of 1 " + herb + ", 1 Herb" +
+                                letters(rng() % herbs));
+            break;
+        case 3:
+            generated.push_back("Geralt brews " + brew);
+            break;
+        case 4:
+            generated.push_back("Geralt learns " + brew + " potion is effective against " + beast);
+            break;
+        default:
+            generated.push_back(rng() % 2 ? "Geralt encounters a " + beast
+                                          : "Geralt learns Igni sign is effective against " + beast);
+            break;
+        }
+    }
+    std::vector<std::string> many = {"Total ingredient ?", "Total potion ?", "Total trophy ?"};
+    for (size_t i = 0; i < herbs; i += 7)
+    {
+        many.push_back("Total ingredient Herb" + letters(i) + " ?");
+    }
+    for (size_t i = 0; i < beasts; i += 3)
+    {
+        many.push_back("Total potion Brew" + letters(i) + " ?");
+        many.push_back("Total trophy Beast" + letters(i) + " ?");
+        many.push_back("What is effective against Beast" + letters(i) + " ?");
+        many.push_back("What is in Brew" + letters(i) + " ?");
+    }
+    std::vector<size_t> all_many(many.size());
+    for (size_t i = 0; i < all_many.size(); ++i)
+    {
+        all_many[i] = i;
+    }
+    Session large(out);
+    std::vector<Kept> kept_large;
+    for (size_t i = 0; i < generated.size(); ++i)
+    {
+        large.execute_line(generated[i]);
+        out.flush();
+        answers.clear();
+        if (i % 250 != 0 && i + 1 != generated.size())
+        {
+            continue;
+        }
+        std::shared_ptr<const InventoryView> view = large.publish_view();
+        std::string expected = ask_session(large, answers, out, many, all_many);
+        std::string viewed = ask_view(*view, parser, many, all_many);
+        if (viewed != expected)
+        {
+            std::cerr << "the view after generated line " << i + 1 << " answers differently from the session\n";
+            failures++;
+        }
+        if (i % 1000 == 0)
+        {
+            kept_large.push_back({view, viewed});
+        }
+    }
+    for (const Kept &old : kept_large)
+    {
+        if (ask_view(*old.view, parser, many, all_many) != old.answers)
+        {
+            std::cerr << "the view of generated epoch " << old.view->epoch() << " changed after it was published\n";
+            failures++;
+        }
+    }
+
+    // readers answer from the current view while the writer executes and publishes
+    std::string written;
+    OutputSink writer_out(written);
+    Session writer(writer_out);
+    writer.publish_view();
+    std::atomic<bool> done{false};
+    struct Sample
+    {
+        uint64_t epoch;
+        std::vector<size_t> picked;
+        std::string answers;
+    };
+    std::vector<std::vector<Sample>> samples(3);
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < samples.size(); ++r)
+    {
+        readers.emplace_back([&, r]
+                             {
+            Utils::Parser reader_parser;
+            std::mt19937 rng(26 + r);
+            while (!done.load() && samples[r].size() < 400)
+            {
+                std::shared_ptr<const InventoryView> view = writer.view();
+                Sample sample{view->epoch(), std::vector<size_t>(1 + rng() % 40), ""};
+                for (size_t &pick : sample.picked)
+                {
+                    pick = rng() % questions.size();
+                }
+                sample.answers = ask_view(*view, reader_parser, questions, sample.picked);
+                samples[r].push_back(std::move(sample));
+                std::this_thread::yield();
+            } });
+    }
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        writer.execute_line(lines[i]);
+        writer.publish_view();
+        if (i % 16 == 0)
+        {
+            std::this_thread::yield(); // let the readers in on a single core too
+        }
+    }
+    done.store(true);
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    std::multimap<uint64_t, const Sample *> by_epoch;
+    for (const std::vector<Sample> &reader : samples)
+    {
+        for (const Sample &sample : reader)
+        {
+            by_epoch.emplace(sample.epoch, &sample);
+        }
+    }
+    std::string checked;
+    OutputSink checked_out(checked);
+    Session reference(checked_out);
+    uint64_t executed = 0;
+    for (const auto &entry : by_epoch)
+    {
+        while (executed < entry.first)
+        {
+            reference.execute_line(lines[executed++]);
+        }
+        checked_out.flush();
+        checked.clear();
+        if (ask_session(reference, checked, checked_out, questions, entry.second->picked) != entry.second->answers)
+        {
+            std::cerr << "a reader's answers from the view of epoch " << entry.first << " are wrong\n";
+            failures++;
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " view checks failed\n";
+        return 1;
+    }
+    std::cout << "view_test: " << questions.size() << " questions answered alike from views, " << many.size()
+              << " over generated names, " << by_epoch.size()
+              << " concurrent reads checked\n";
+    return 0;
+}